@@ -138,4 +138,13 @@ const struct cargo_t cargo_types[] = {
         "l",
         512
     }
-};
\ No newline at end of file
+};
+
+
+cargo_index_t cargo_index(cargo_handle_t cargo_type) {
+    if (cargo_type >= MAX_CARGO_TYPES) {
+        errorac(ERR_CARGO_BAD_TYPE, CARGO_INDEX_NONE, "cargo_index");
+    }
+
+    return (cargo_index_t) cargo_type;
+}
@@ -11,13 +11,15 @@
 #ifndef CARGO_H
 #define CARGO_H
 
+#include "m_error.h"
+
 #include <stddef.h>
 
 
 /**
  * @brief The maximum number of cargo types.
  */
-#define MAX_CARGO_TYPES 64;
+#define MAX_CARGO_TYPES 64
 
 
 /**
@@ -63,5 +65,33 @@ extern const struct cargo_t cargo_types[];
  */
 typedef size_t cargo_handle_t;
 
+/**
+ * @brief A compact index to a cargo type, for storing in tables.
+ *
+ * The narrowest unsigned type holding every index below MAX_CARGO_TYPES,
+ * with the all-ones value left over as CARGO_INDEX_NONE. Handles are
+ * still passed around as cargo_handle_t; narrow them with cargo_index.
+ */
+#if MAX_CARGO_TYPES < 0xFF
+typedef unsigned char cargo_index_t;
+#elif MAX_CARGO_TYPES < 0xFFFF
+typedef unsigned short cargo_index_t;
+#else
+typedef unsigned int cargo_index_t;
+#endif
+
+/**
+ * @brief Denotes the absence of a cargo type, in a cargo_index_t.
+ */
+#define CARGO_INDEX_NONE ((cargo_index_t) -1)
+
+/**
+ * @brief Narrows a handle to a cargo type into a compact index.
+ *
+ * @param cargo_type The handle to narrow.
+ * @return cargo_index_t The index, or CARGO_INDEX_NONE if out of range.
+ */
+cargo_index_t cargo_index(cargo_handle_t cargo_type);
+
 
 #endif // CARGO_H
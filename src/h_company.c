@@ -11,28 +11,23 @@
 #include <string.h>
 
 #include "m_error.h"
+#include "m_trace.h"
+#include "m_util.h"
 #include "h_company.h"
 
 
 static struct company_t companies[MAX_COMPANIES];
 size_t num_companies = 0;
 float max_loan = DEFAULT_MAX_LOAN;
+int loan_interest = DEFAULT_LOAN_INTEREST;
 
-company_handle_t company_found_company(const char *const name, float initial_loan) {
-    const company_handle_t company = num_companies++;
-
-    strcpy(companies[company].name, name);
-
-    companies[company].balance = 0.0;
-    companies[company].debt = 0.0;
-    companies[company].num_chairmen = 0;
-
-    if (initial_loan > 0) {
-        company_loan(company, initial_loan);
-    }
-
-    return company;
-}
+/**
+ * @brief The growth of debt over any number of periods.
+ *
+ * Rebuilt whenever loan_interest changes.
+ */
+static struct decay_table_t company_interest;
+static int company_interest_built = 0;
 
 static error_return_t _company_check_index(company_handle_t company) {
     if (company >= num_companies) {
@@ -42,18 +37,30 @@ static error_return_t _company_check_index(company_handle_t company) {
     return 0;
 }
 
+company_index_t company_index(company_handle_t company) {
+    if (company >= MAX_COMPANIES) {
+        errorac(ERR_COMPANY_BAD_INDEX, COMPANY_INDEX_NONE, "company_index");
+    }
+
+    return (company_index_t) company;
+}
+
 error_return_t company_add_chairman(company_handle_t company, unsigned int player_num) {
     static int index;
 
     errcli(_company_check_index(company));
 
+    if (player_num >= MAX_PLAYERS) {
+        errori(ERR_COMPANY_BAD_PLAYER);
+    }
+
     if (company_has_chairman(company, player_num) > 0) {
         errori(ERR_COMPANY_ALREADY_HAS_CHAIRMAN);
     }
 
     index = companies[company].num_chairmen++;
 
-    companies[company].chairmen[index] = player_num;
+    companies[company].chairmen[index] = (player_index_t) player_num;
 
     return 0;
 }
@@ -115,13 +122,7 @@ static void _company_check_healthy(company_handle_t company) {
     }
 }
 
-static void _company_charge_interest(company_handle_t company) {
-    if (companies[company].debt > 0) {
-        company_add_to_balance(company, -companies[company].debt * DEFAULT_LOAN_INTEREST);
-    }
-}
-
-error_return_t company_add_to_balance(company_handle_t company, float amount) {
+static error_return_t _company_add_to_balance(company_handle_t company, float amount) {
     errcli(_company_check_index(company));
 
     companies[company].balance += amount;
@@ -133,7 +134,13 @@ error_return_t company_add_to_balance(company_handle_t company, float amount) {
     return 0;
 }
 
-error_return_t company_loan(company_handle_t company, float amount) {
+error_return_t company_add_to_balance(company_handle_t company, float amount) {
+    trace_call(TRACE_COMPANY_ADD_TO_BALANCE, company, amount);
+
+    return _company_add_to_balance(company, amount);
+}
+
+static error_return_t _company_loan(company_handle_t company, float amount) {
     errcli(_company_check_index(company));
 
     if (amount > 0) {
@@ -142,9 +149,9 @@ error_return_t company_loan(company_handle_t company, float amount) {
             amount = max_loan - companies[company].debt;
         }
 
-        if (amount == 0.0) {
+        if (amount <= 0.0) {
             // amount cannot be loaned
-            // (debt is already at max_loan)
+            // (debt is already at max_loan, or past it from interest)
             codei(ERR_COMPANY_LOAN_MAXED_OUT);
         }
 
@@ -175,3 +182,52 @@ error_return_t company_loan(company_handle_t company, float amount) {
 
     return 0;
 }
+
+error_return_t company_loan(company_handle_t company, float amount) {
+    trace_call(TRACE_COMPANY_LOAN, company, amount);
+
+    return _company_loan(company, amount);
+}
+
+error_return_t company_charge_interest(company_handle_t company, unsigned int periods) {
+    // rounded to nearest, so that e.g. 5% is not charged as 4.9985%
+    const fixed_t rate = FIXED_ONE + (int_to_fixed(loan_interest) + 50) / 100;
+
+    trace_call(TRACE_COMPANY_CHARGE_INTEREST, company, periods);
+
+    errcli(_company_check_index(company));
+
+    if (companies[company].debt <= 0 || periods == 0) {
+        return 0;
+    }
+
+    if (!company_interest_built || company_interest.rate != rate) {
+        decay_table_build(&company_interest, rate);
+        company_interest_built = 1;
+    }
+
+    // unpaid interest joins the debt, and bears interest in turn
+    companies[company].debt += companies[company].debt * (decay_table_factor(&company_interest, periods) - FIXED_ONE) / FIXED_ONE;
+
+    _company_check_healthy(company);
+
+    return 0;
+}
+
+company_handle_t company_found_company(const char *const name, float initial_loan) {
+    const company_handle_t company = num_companies++;
+
+    trace_call(TRACE_COMPANY_FOUND_COMPANY, name, initial_loan);
+
+    strcpy(companies[company].name, name);
+
+    companies[company].balance = 0.0;
+    companies[company].debt = 0.0;
+    companies[company].num_chairmen = 0;
+
+    if (initial_loan > 0) {
+        _company_loan(company, initial_loan);
+    }
+
+    return company;
+}
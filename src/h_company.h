@@ -26,6 +26,11 @@
  */
 #define MAX_COMPANIES 64
 
+/**
+ * @brief The maximum number of players in a game.
+ */
+#define MAX_PLAYERS 64
+
 /**
  * @brief The initial maximum amount that can be owed to the bank.
  */
@@ -33,10 +38,23 @@
 
 /**
  * @brief The initial interest rate of loans taken from the bank.
+ *
+ * In percent of the debt, per period.
  */
 #define DEFAULT_LOAN_INTEREST 5
 
 
+/**
+ * @brief A compact PlayerNumber, for storing in tables.
+ */
+#if MAX_PLAYERS < 0xFF
+typedef unsigned char player_index_t;
+#elif MAX_PLAYERS < 0xFFFF
+typedef unsigned short player_index_t;
+#else
+typedef unsigned int player_index_t;
+#endif
+
 /**
  * @brief A company.
  */
@@ -72,7 +90,7 @@ struct company_t {
      * multiplayer game, this must be updated manually when players
      * join and leave.
      */
-    unsigned int chairmen[MAX_CHAIRMEN_PER_COMPANY];
+    player_index_t chairmen[MAX_CHAIRMEN_PER_COMPANY];
 
     /**
      * @brief The number of managing players.
@@ -92,11 +110,44 @@ extern size_t num_companies;
  */
 extern float max_loan;
 
+/**
+ * @brief The interest rate of loans taken from the bank, in percent per period.
+ */
+extern int loan_interest;
+
 /**
  * @brief An index to a company.
  */
 typedef const size_t company_handle_t;
 
+/**
+ * @brief A compact index to a company, for storing in tables.
+ *
+ * The narrowest unsigned type holding every index below MAX_COMPANIES,
+ * with the all-ones value left over as COMPANY_INDEX_NONE. Handles are
+ * still passed around as company_handle_t; narrow them with company_index.
+ */
+#if MAX_COMPANIES < 0xFF
+typedef unsigned char company_index_t;
+#elif MAX_COMPANIES < 0xFFFF
+typedef unsigned short company_index_t;
+#else
+typedef unsigned int company_index_t;
+#endif
+
+/**
+ * @brief Denotes the absence of a company, in a company_index_t.
+ */
+#define COMPANY_INDEX_NONE ((company_index_t) -1)
+
+/**
+ * @brief Narrows a handle to a company into a compact index.
+ *
+ * @param company The handle to narrow.
+ * @return company_index_t The index, or COMPANY_INDEX_NONE if out of range.
+ */
+company_index_t company_index(company_handle_t company);
+
 /**
  * @brief Founds a new company.
  *
@@ -166,5 +217,26 @@ error_return_t company_add_to_balance(company_handle_t company, float amount);
  */
 error_return_t company_loan(company_handle_t company, float amount);
 
+/**
+ * @brief Charges interest on the debt of a company.
+ *
+ * Interest is added to the debt, at loan_interest percent of it per
+ * period, so that interest left unpaid bears interest in turn. Charging
+ * several periods at once thus leaves the same debt as charging them
+ * one by one. The balance is untouched; the interest is paid back with
+ * the rest of the debt, through company_loan. A company whose debt
+ * grows past its balance by more than max_loan is dissolved, as usual.
+ *
+ * The compounded rate comes from a table, rather than from pow, so
+ * this takes at most a few fixed-point multiplications, however many
+ * periods are charged. Past the point where the compounded rate no
+ * longer fits a fixed_t (about 32768 times the debt), it saturates.
+ *
+ * @param company The company to charge.
+ * @param periods The number of periods to charge interest for.
+ * @return error_return_t 0 if successful, an error code otherwise.
+ */
+error_return_t company_charge_interest(company_handle_t company, unsigned int periods);
+
 
 #endif // COMPANY_H
@@ -0,0 +1,166 @@
+/**
+ * @file h_harvest.c
+ * @author Gustavo Rehermann (rehermann6046@gmail.com)
+ * @brief Harvest logic and monster yields.
+ * @version added in 0.1
+ * @date 2021-03-16
+ *
+ * @copyright Copyright (c)Gustavo Ramos Rehermann 2021. The MIT License.
+ */
+
+#include <string.h>
+
+#include "h_harvest.h"
+
+
+const cargo_handle_t harvest_cargos[NUM_HARVEST_CARGOS] = {
+    0, // Flesh
+    1, // Bones
+    2, // Brains
+    3, // Hooves
+    5  // Blood
+};
+
+/**
+ * @brief All monster yields in the game.
+ *
+ * Yields are in Cargo Units of, in order: Flesh, Bones, Brains, Hooves
+ * and Blood.
+ */
+const struct harvest_class_t harvest_classes[NUM_HARVEST_CLASSES] = {
+    // humans are small, but brainy
+    { "ZombieMan",        {  60.0,  12.0,  1.4,   0.0,   5.0 } },
+    { "ShotgunGuy",       {  65.0,  12.0,  1.4,   0.0,   5.0 } },
+    { "ChaingunGuy",      {  80.0,  14.0,  1.4,   0.0,   6.0 } },
+
+    // demons proper
+    { "DoomImp",          {  55.0,  10.0,  0.4,   0.0,   4.0 } },
+    { "Demon",            { 140.0,  25.0,  0.3,   6.0,  10.0 } },
+    { "Spectre",          { 140.0,  25.0,  0.3,   6.0,  10.0 } },
+    { "LostSoul",         {   0.0,   4.0,  0.0,   0.0,   0.0 } }, // all skull, no meat
+    { "Cacodemon",        { 320.0,   0.0,  0.8,   0.0,  30.0 } }, // no bones to speak of
+    { "HellKnight",       { 250.0,  45.0,  0.6,  12.0,  18.0 } },
+    { "BaronOfHell",      { 300.0,  55.0,  0.7,  14.0,  22.0 } },
+    { "Arachnotron",      { 180.0,   0.0,  2.5,   0.0,   8.0 } }, // mostly machine
+    { "PainElemental",    { 340.0,   0.0,  0.6,   0.0,  32.0 } },
+    { "Revenant",         {   0.0,  40.0,  0.0,   0.0,   0.0 } },
+    { "Fatso",            { 600.0,  50.0,  0.5,   0.0,  40.0 } },
+    { "Archvile",         {  90.0,  18.0,  1.0,   8.0,   7.0 } },
+    { "Cyberdemon",       { 900.0, 140.0,  1.2,  30.0,  70.0 } },
+    { "SpiderMastermind", { 250.0,   0.0, 12.0,   0.0,  20.0 } }  // mostly brain
+};
+
+
+/**
+ * @brief The yields harvested into each station since the last flush.
+ */
+static float harvest_pending[MAX_STATIONS][NUM_HARVEST_CARGOS];
+
+/**
+ * @brief The stations harvested into since the last flush.
+ *
+ * @note Only items up to (harvest_num_touched - 1) should be iterated.
+ */
+static station_index_t harvest_touched[MAX_STATIONS];
+static int harvest_num_touched = 0;
+
+/**
+ * @brief Whether each station is listed in harvest_touched.
+ */
+static unsigned char harvest_is_touched[MAX_STATIONS];
+
+/**
+ * @brief The generation of the station each pending yield is for.
+ *
+ * Yields of a station removed since, whose index may have been taken
+ * by another, are dropped rather than handed to the new station.
+ */
+static unsigned int harvest_generation[MAX_STATIONS];
+
+
+harvest_class_handle_t harvest_find_class(const char *class_name) {
+    harvest_class_handle_t monster_class;
+
+    for (monster_class = 0; monster_class < NUM_HARVEST_CLASSES; monster_class++) {
+        if (strcmp(harvest_classes[monster_class].class_name, class_name) == 0) {
+            return monster_class;
+        }
+    }
+
+    return -1;
+}
+
+error_return_t harvest_kill_at(station_handle_t ind_station, harvest_class_handle_t monster_class) {
+    int i;
+
+    if (!station_is_active(ind_station)) {
+        erroric(ERR_STATION_BAD_INDEX, "harvest_kill_at");
+    }
+
+    if (monster_class < 0 || monster_class >= NUM_HARVEST_CLASSES) {
+        // not a harvestable monster
+        return 0;
+    }
+
+    if (!harvest_is_touched[ind_station]) {
+        harvest_is_touched[ind_station] = 1;
+        harvest_touched[harvest_num_touched++] = ind_station;
+    }
+
+    else if (harvest_generation[ind_station] != station_get_generation(ind_station)) {
+        // left over from a removed station
+        for (i = 0; i < NUM_HARVEST_CARGOS; i++) {
+            harvest_pending[ind_station][i] = 0.0;
+        }
+    }
+
+    harvest_generation[ind_station] = station_get_generation(ind_station);
+
+    for (i = 0; i < NUM_HARVEST_CARGOS; i++) {
+        harvest_pending[ind_station][i] += harvest_classes[monster_class].yield[i];
+    }
+
+    return 0;
+}
+
+error_return_t harvest_kill(harvest_class_handle_t monster_class, float x, float y) {
+    const station_handle_t ind_station = station_find_nearest(x, y);
+
+    if (ind_station == (station_handle_t) -1) {
+        // no station to harvest into; the corpse goes to waste
+        return 0;
+    }
+
+    return harvest_kill_at(ind_station, monster_class);
+}
+
+error_return_t harvest_flush(void) {
+    station_handle_t ind_station;
+    error_return_t result = 0;
+    int i, j, kept = 0;
+
+    for (i = 0; i < harvest_num_touched; i++) {
+        ind_station = harvest_touched[i];
+
+        // a station removed since is simply cleared; there is nowhere
+        // left to harvest into
+        if (harvest_generation[ind_station] == station_get_generation(ind_station)) {
+            iferr(station_add_cargo_batch(ind_station, -1, harvest_cargos, harvest_pending[ind_station], NUM_HARVEST_CARGOS)) {
+                // nothing was added; keep it pending for the next flush
+                harvest_touched[kept++] = ind_station;
+                result = _err;
+                continue;
+            }
+        }
+
+        for (j = 0; j < NUM_HARVEST_CARGOS; j++) {
+            harvest_pending[ind_station][j] = 0.0;
+        }
+
+        harvest_is_touched[ind_station] = 0;
+    }
+
+    harvest_num_touched = kept;
+
+    return result;
+}
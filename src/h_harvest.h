@@ -0,0 +1,119 @@
+/**
+ * @file h_harvest.h
+ * @author Gustavo Rehermann (rehermann6046@gmail.com)
+ * @brief Harvesting cargo from killed monsters.
+ * @version added in 0.1
+ * @date 2021-03-16
+ *
+ * Every monster killed yields some cargo, such as Flesh or Blood, at
+ * the station nearest to it. How much of each depends on the class of
+ * the monster.
+ *
+ * A death trap can kill a whole horde within a single tic, so yields
+ * are not deposited right away; they are summed per station and cargo
+ * type over the tic instead, and flushed at its end as one batched
+ * deposit per station. A mass kill thus costs in proportion to the
+ * number of stations touched, rather than to the number of corpses.
+ *
+ * @copyright Copyright (c)Gustavo Ramos Rehermann 2021. The MIT License.
+ */
+
+#ifndef HARVEST_H
+#define HARVEST_H
+
+#include "m_error.h"
+#include "h_cargo.h"
+#include "h_station.h"
+
+
+/**
+ * @brief The number of distinct cargo types harvested from monsters.
+ */
+#define NUM_HARVEST_CARGOS 5
+
+/**
+ * @brief The number of known monster classes.
+ */
+#define NUM_HARVEST_CLASSES 17
+
+
+/**
+ * @brief The yield of a monster class.
+ */
+struct harvest_class_t {
+    /**
+     * @brief The actor class name of the monster.
+     */
+    char class_name[64];
+
+    /**
+     * @brief The amount of each harvested cargo, in Cargo Units.
+     *
+     * Each item's cargo type is the corresponding harvest_cargos item.
+     */
+    float yield[NUM_HARVEST_CARGOS];
+};
+
+/**
+ * @brief The cargo types harvested from monsters.
+ */
+extern const cargo_handle_t harvest_cargos[NUM_HARVEST_CARGOS];
+
+/**
+ * @brief The yields of all known monster classes.
+ */
+extern const struct harvest_class_t harvest_classes[NUM_HARVEST_CLASSES];
+
+/**
+ * @brief An index into harvest_classes.
+ *
+ * Negative values denote an unknown monster class.
+ */
+typedef int harvest_class_handle_t;
+
+/**
+ * @brief Looks up a monster class by actor class name.
+ *
+ * Meant to be called once per monster, such as when it spawns, rather
+ * than once per kill.
+ *
+ * @param class_name The actor class name of the monster.
+ * @return harvest_class_handle_t The monster class, or -1 if unknown.
+ */
+harvest_class_handle_t harvest_find_class(const char *class_name);
+
+/**
+ * @brief Harvests a killed monster into the station nearest to it.
+ *
+ * @param monster_class The class of the killed monster.
+ * @param x X location of the kill.
+ * @param y Y location of the kill.
+ * @return error_return_t 0 if successful, an error code otherwise.
+ */
+error_return_t harvest_kill(harvest_class_handle_t monster_class, float x, float y);
+
+/**
+ * @brief Harvests a killed monster into a specific station.
+ *
+ * @param ind_station The station to harvest into.
+ * @param monster_class The class of the killed monster.
+ * @return error_return_t 0 if successful, an error code otherwise.
+ */
+error_return_t harvest_kill_at(station_handle_t ind_station, harvest_class_handle_t monster_class);
+
+/**
+ * @brief Deposits all yields harvested since the last flush.
+ *
+ * Should be called once at the end of every tic. Yields that could not
+ * be deposited, e.g. at a station with no room for more loads, are kept
+ * pending for the next flush. Yields pending for stations removed since
+ * are lost along with the station, and never go to a station that may
+ * take its index later.
+ *
+ * @return error_return_t 0 if successful, else the error code of the
+ * last station that could not be deposited into.
+ */
+error_return_t harvest_flush(void);
+
+
+#endif // HARVEST_H
@@ -12,15 +12,169 @@
 
 #include "h_industry.h"
 #include "m_error.h"
+#include "m_trace.h"
+#include "m_vec.h"
 
 
-static struct industry_t industries[MAX_INDUSTRIES];
-int num_industries;
+static M_SIM_STATE struct industry_t industries[MAX_INDUSTRIES];
+M_SIM_STATE int num_industries;
+
+/**
+ * @brief Total of all material accumulated in each industry.
+ *
+ * The ungrouped total of all material accumulated in each industry,
+ * in Material Units. Kept apart from industries, alongside
+ * industry_boost_threshold, so that boosts can be checked in a single
+ * sweep over both.
+ */
+static M_SIM_STATE float industry_material_tot[MAX_INDUSTRIES];
+
+/**
+ * @brief The boost threshold of each industry.
+ *
+ * Copied from the industry's type when it is made; types of other
+ * supply types than ISUPTYPE_BOOST get INDUSTRY_NEVER_BOOSTED instead.
+ */
+static M_SIM_STATE float industry_boost_threshold[MAX_INDUSTRIES];
+
+/**
+ * @brief A boost threshold no material total ever reaches.
+ */
+#define INDUSTRY_NEVER_BOOSTED 3.0e38
+
+/**
+ * @brief The material slots of all industries, in Material Units.
+ *
+ * @see industry_t.first_material
+ */
+static M_SIM_STATE float industry_material[MAX_INDUS_SLOTS];
+static M_SIM_STATE size_t industry_num_material = 0;
+
+/**
+ * @brief The supply slots of all industries.
+ *
+ * @see industry_t.first_supply
+ */
+static M_SIM_STATE float industry_produced[MAX_INDUS_SLOTS];
+static M_SIM_STATE float industry_transported[MAX_INDUS_SLOTS];
+static M_SIM_STATE size_t industry_num_supply = 0;
+
+/**
+ * @brief Which industries may reach each place grid tile.
+ */
+static M_SIM_STATE industry_set_t industry_coverage[PLACE_GRID_TILES];
+
+/**
+ * @brief The place grid version industry_coverage was built for.
+ */
+static M_SIM_STATE unsigned int industry_coverage_grid = 0;
+
+/**
+ * @brief Bumped every time industry_coverage changes.
+ */
+static M_SIM_STATE unsigned int industry_coverage_version = 1;
+
+/**
+ * @brief The number of industries already in industry_coverage.
+ *
+ * New industries are only added in on the next lookup, so that
+ * worlds that never look coverage up never pay for it.
+ */
+static M_SIM_STATE int industry_num_covered = 0;
+
+/**
+ * @brief The cargo types accepted and supplied by all industry types.
+ *
+ * Each industry type's accepted cargo types are packed here, followed
+ * by its supplied ones; the type then only refers to its range.
+ */
+M_SIM_TUNABLE struct industry_mat_t industry_mats[] = {
+    // Flesh Exsanguiner accepts
+    { 0 /* Flesh */, 1.0 },
+
+    // Flesh Exsanguiner supplies
+    { 5 /* Blood */, 0.7 },
+
+    // Hoof Smeltery accepts
+    { 3 /* Hooves */, 0.8 },
+    { 10 /* Energy */, 2.0 },
+
+    // Hoof Smeltery supplies
+    { 7 /* Steel */, 1.1 },
+    { 5 /* Blood */, 0.15 },
+
+    // Wart Fields accepts
+    { 9 /*Fertilizer */, 1.0 },
+
+    // Wart Fields supplies
+    { 4 /* Wart */, 5.0 },
+
+    // Neural Exciter accepts
+    { 2 /* Brains */, 0.4 },
+    { 6 /* Bottled Pain */, 1.2 },
+
+    // Neural Exciter supplies
+    { 11 /* Bottled Pride */, 2.0 },
+
+    // Bonesteel Refinery accepts
+    { 7 /* Steel */, 0.6 },
+    { 1 /* Bones */, 0.4 },
+
+    // Bonesteel Refinery supplies
+    { 8 /* Bonesteel */, 0.3 },
+
+    // Brewery accepts
+    { 11 /* Bottled Pride */, 1.2 },
+    { 4 /* Wart */, 0.8 },
+    { 0 /* Flesh */, 0.3 },
+
+    // Brewery supplies
+    { 9 /* Fertilizer */, 1.1 },
+    { 12  /* Hate Ale */, 0.4 },
+
+    // Fermenting Pit accepts
+    { 6 /* Bottled Pain */, 1.1 },
+    { 5 /* Blood */, 0.8 },
+    { 0 /* Flesh */, 0.3 },
+
+    // Fermenting Pit supplies
+    { 9 /* Fertilizer */, 3.0 },
+    { 13 /* Gas */, 8.0 },
+
+    // Gas Furnace accepts
+    { 13 /* Gas */, 1.0 },
+
+    // Gas Furnace supplies
+    { 10 /* Energy */, 0.2 },
+
+    // Artisan Workshop accepts
+    { 8 /* Bonesteel */, 0.5 },
+    { 12 /* Hate Ale */, 1.8 },
+    { 16 /* Microchips */, 1.1 },
+
+    // Artisan Workshop supplies
+    { 14 /* Goods */, 1.5 },
+
+    // Silicon Furnace accepts
+    { 1 /* Bonesteel */, 0.5 },
+    { 13 /* Gas */, 1.25 },
+
+    // Silicon Furnace supplies
+    { 15 /* Silicon */, 0.8 },
+
+    // Semiconductor Factory accepts
+    { 15 /* Silicon */, 0.5 },
+    { 2 /* Brains */, 1.0 },
+    { 10 /* Energy */, 0.5 },
+
+    // Semiconductor Factory supplies
+    { 16 /* Microchips */, 2.5 }
+};
 
 /**
  * @brief All definitions of industry types in the game.
  */
-const struct industry_type_t industry_types[MAX_INDUS_TYPES] = {
+M_SIM_TUNABLE struct industry_type_t industry_types[MAX_INDUS_TYPES] = {
     { // Flesh Exsanguiner
         ISUPTYPE_CONVERT, // supply_type
         "Flesh Exsanguiner", // label
@@ -32,12 +186,10 @@ const struct industry_type_t industry_types[MAX_INDUS_TYPES] = {
         512.0, // reach
 
         // accept
-        1, { 0 /* Flesh */ },
-        { 1.0 },
+        0, 1,
 
         // supply
-        1, { 5 /* Blood */ },
-        { 0.7, }
+        1, 1
     },
 
     { // Hoof Smeltery
@@ -51,12 +203,10 @@ const struct industry_type_t industry_types[MAX_INDUS_TYPES] = {
         512.0, // reach
 
         // accept
-        2, { 3 /* Hooves */, 10 /* Energy */ },
-        { 0.8, 2.0, 0, 0 },
+        2, 2,
 
         // supply
-        2, { 7 /* Steel */, 5 /* Blood */ },
-        { 1.1, 0.15 }
+        4, 2
     },
 
     { // Wart Fields
@@ -70,12 +220,10 @@ const struct industry_type_t industry_types[MAX_INDUS_TYPES] = {
         1200.0, // reach
 
         // accept
-        1, { 9 /*Fertilizer */ },
-        { 1.0 },
+        6, 1,
 
         // supply
-        1, { 4 /* Wart */ },
-        { 5.0 }
+        7, 1
     },
 
     { // Neural Exciter
@@ -89,12 +237,10 @@ const struct industry_type_t industry_types[MAX_INDUS_TYPES] = {
         600.0, // reach
 
         // accept
-        2, { 2 /* Brains */, 6 /* Bottled Pain */ },
-        { 0.4, 1.2 },
+        8, 2,
 
         // supply
-        1, { 11 /* Bottled Pride */ },
-        { 2.0 }
+        10, 1
     },
 
     { // Bonesteel Refinery
@@ -108,12 +254,10 @@ const struct industry_type_t industry_types[MAX_INDUS_TYPES] = {
         700.0, // reach
 
         // accept
-        2, { 7 /* Steel */, 1 /* Bones */ },
-        { 0.6, 0.4 },
+        11, 2,
 
         // supply
-        1, { 8 /* Bonesteel */ },
-        { 0.3 }
+        13, 1
     },
 
     { // Brewery
@@ -127,12 +271,10 @@ const struct industry_type_t industry_types[MAX_INDUS_TYPES] = {
         512.0, // reach
 
         // accept
-        3, { 11 /* Bottled Pride */, 4 /* Wart */, 0 /* Flesh */ },
-        { 1.2, 0.8, 0.3 },
+        14, 3,
 
         // supply
-        2, { 9 /* Fertilizer */, 12  /* Hate Ale */ },
-        { 1.1, 0.4 }
+        17, 2
     },
 
     { // Fermenting Pit
@@ -146,12 +288,10 @@ const struct industry_type_t industry_types[MAX_INDUS_TYPES] = {
         768.0, // reach
 
         // accept
-        3, { 6 /* Bottled Pain */, 5 /* Blood */, 0 /* Flesh */ },
-        { 1.1, 0.8, 0.3 },
+        19, 3,
 
         // supply
-        2, { 9 /* Fertilizer */, 13 /* Gas */ },
-        { 3.0, 8.0 }
+        22, 2
     },
 
     { // Gas Furnace
@@ -164,11 +304,9 @@ const struct industry_type_t industry_types[MAX_INDUS_TYPES] = {
         0.0,
         768.0,
 
-        1, { 13 /* Gas */ },
-        { 1.0 },
+        24, 1,
 
-        1, { 10 /* Energy */ },
-        { 0.2 }
+        25, 1
     },
 
     { // Artisan Workshop
@@ -181,11 +319,9 @@ const struct industry_type_t industry_types[MAX_INDUS_TYPES] = {
         0.0,
         512.0,
 
-        3, { 8 /* Bonesteel */, 12 /* Hate Ale */, 16 /* Microchips */ },
-        { 0.5, 1.8, 1.1 },
+        26, 3,
 
-        1, { 14 /* Goods */ },
-        { 1.5 }
+        29, 1
     },
 
     { // Silicon Furnace
@@ -198,11 +334,9 @@ const struct industry_type_t industry_types[MAX_INDUS_TYPES] = {
         0.0,
         512.0,
 
-        2, { 1 /* Bonesteel */, 13 /* Gas */ },
-        { 0.5, 1.25 },
+        30, 2,
 
-        1, { 15 /* Silicon */ },
-        { 0.8 }
+        32, 1
     },
 
     { // Semiconductor Factory
@@ -215,17 +349,15 @@ const struct industry_type_t industry_types[MAX_INDUS_TYPES] = {
         0.0,
         768.0,
 
-        3, { 15 /* Silicon */, 2 /* Brains */, 10 /* Energy */ },
-        { 0.5, 1.0, 0.5 },
+        33, 3,
 
-        1, { 16 /* Microchips */ },
-        { 2.5 }
+        36, 1
     }
 };
 
 
 static error_return_t _industry_check_index(industry_handle_t ind_industry, const char *const ctx) {
-    if (ind_industry >= num_industries || industries[ind_industry].type == -1) {
+    if (ind_industry >= num_industries || industries[ind_industry].type == INDUSTRY_TYPE_INDEX_NONE) {
         erroric(ERR_INDUSTRY_BAD_INDEX, ctx);
     }
 
@@ -239,28 +371,240 @@ static error_return_t _industry_check_index(industry_handle_t ind_industry, cons
 static error_return_t _industry_check_index_and_accept(industry_handle_t ind_industry, size_t accept, const char *const ctx) {
     errcli(_industry_check_index(ind_industry, ctx));
 
-    if (accept >= industry_types[industries[ind_industry].type].num_accepts || industry_types[industries[ind_industry].type].accepts[accept] == -1) {
+    if (accept >= industry_types[industries[ind_industry].type].num_accepts) {
         erroric(ERR_INDUSTRY_BAD_ACCEPT, ctx);
     }
 
     return 0;
 }
 
-error_return_t industry_make_production(industry_handle_t ind_industry, float amount) {
+/**
+ * @brief Adds an industry to the coverage of every tile its reach touches.
+ */
+static void _industry_cover(industry_handle_t ind_industry) {
+    const struct industry_t *const indus = &industries[ind_industry];
+    const float reach = industry_types[indus->type].reach;
+    float dx, dy, left, top;
+    int tile_x, tile_y, tile;
+
+    for (tile_y = 0; tile_y < PLACE_GRID_WIDTH; tile_y++) {
+        top = (float) (place_grid_y + tile_y) * SPOT_TILE_WIDTH;
+
+        // distance from the industry to the nearest point of the tile
+        dy = indus->pos_y < top ? top - indus->pos_y : (indus->pos_y > top + SPOT_TILE_WIDTH ? indus->pos_y - top - SPOT_TILE_WIDTH : 0.0);
+
+        if (dy > reach) {
+            continue;
+        }
+
+        for (tile_x = 0; tile_x < PLACE_GRID_WIDTH; tile_x++) {
+            left = (float) (place_grid_x + tile_x) * SPOT_TILE_WIDTH;
+            dx = indus->pos_x < left ? left - indus->pos_x : (indus->pos_x > left + SPOT_TILE_WIDTH ? indus->pos_x - left - SPOT_TILE_WIDTH : 0.0);
+
+            if (dx * dx + dy * dy > reach * reach) {
+                continue;
+            }
+
+            tile = tile_y * PLACE_GRID_WIDTH + tile_x;
+            industry_coverage[tile][ind_industry / 32] |= 1u << (ind_industry % 32);
+        }
+    }
+
+    industry_coverage_version++;
+}
+
+/**
+ * @brief Brings industry_coverage up to date.
+ *
+ * Rebuilds it if the place grid was moved, else only adds in the
+ * industries made since the last call.
+ */
+static void _industry_check_coverage(void) {
+    int tile, i;
+
+    if (industry_coverage_grid != place_grid_version) {
+        for (tile = 0; tile < PLACE_GRID_TILES; tile++) {
+            for (i = 0; i < INDUSTRY_SET_WORDS; i++) {
+                industry_coverage[tile][i] = 0;
+            }
+        }
+
+        industry_coverage_grid = place_grid_version;
+        industry_num_covered = 0;
+    }
+
+    while (industry_num_covered < num_industries) {
+        _industry_cover(industry_num_covered++);
+    }
+}
+
+industry_index_t industry_index(industry_handle_t ind_industry) {
+    if (ind_industry >= MAX_INDUSTRIES) {
+        errorac(ERR_INDUSTRY_BAD_INDEX, INDUSTRY_INDEX_NONE, "industry_index");
+    }
+
+    return (industry_index_t) ind_industry;
+}
+
+industry_handle_t industry_make(size_t type, float x, float y) {
+    struct industry_t *indus;
+    size_t i;
+
+    trace_call(TRACE_INDUSTRY_MAKE, type, x, y);
+
+    if (num_industries >= MAX_INDUSTRIES) {
+        errorac(ERR_INDUSTRY_MAXED, -1, "industry_make");
+    }
+
+    if (type >= MAX_INDUS_TYPES || industry_types[type].supply_type == ISUPTYPE_UNKNOWN) {
+        errorac(ERR_INDUSTRY_BAD_TYPE, -1, "industry_make");
+    }
+
+    if (industry_num_material + industry_types[type].num_accepts > MAX_INDUS_SLOTS || industry_num_supply + industry_types[type].num_supplies > MAX_INDUS_SLOTS) {
+        errorac(ERR_INDUSTRY_MAXED, -1, "industry_make");
+    }
+
+    indus = &industries[num_industries];
+
+    indus->type = (industry_type_index_t) type;
+    indus->pos_x = x;
+    indus->pos_y = y;
+
+    industry_material_tot[num_industries] = 0.0;
+    industry_boost_threshold[num_industries] = industry_types[type].supply_type == ISUPTYPE_BOOST ? industry_types[type].boost_threshold : INDUSTRY_NEVER_BOOSTED;
+
+    indus->first_material = industry_num_material;
+    indus->first_supply = industry_num_supply;
+
+    for (i = 0; i < industry_types[type].num_accepts; i++) {
+        industry_material[industry_num_material++] = 0.0;
+    }
+
+    for (i = 0; i < industry_types[type].num_supplies; i++) {
+        industry_produced[industry_num_supply] = 0.0;
+        industry_transported[industry_num_supply] = 0.0;
+        industry_num_supply++;
+    }
+
+    return num_industries++;
+}
+
+error_return_t industry_get_coverage(int tile, industry_set_t set) {
+    int i;
+
+    if (tile < 0 || tile >= PLACE_GRID_TILES) {
+        erroric(ERR_PLACE_BAD_SPOT_INDEX, "industry_get_coverage");
+    }
+
+    _industry_check_coverage();
+
+    for (i = 0; i < INDUSTRY_SET_WORDS; i++) {
+        set[i] = industry_coverage[tile][i];
+    }
+
+    return 0;
+}
+
+void industry_preview_begin(struct industry_preview_t *preview) {
+    preview->tile = -1;
+    preview->version = 0;
+    preview->num_candidates = 0;
+    preview->num_reached = 0;
+}
+
+/**
+ * @brief Gathers the candidates of a preview for its tile.
+ */
+static void _industry_preview_gather(struct industry_preview_t *preview) {
+    industry_handle_t ind_industry;
+    unsigned int word;
+    int i;
+
+    preview->num_candidates = 0;
+
+    if (preview->tile == -1) {
+        for (ind_industry = 0; ind_industry < num_industries; ind_industry++) {
+            preview->candidates[preview->num_candidates++] = ind_industry;
+        }
+
+        return;
+    }
+
+    for (i = 0; i < INDUSTRY_SET_WORDS; i++) {
+        for (word = industry_coverage[preview->tile][i], ind_industry = i * 32; word; word >>= 1, ind_industry++) {
+            if (word & 1) {
+                preview->candidates[preview->num_candidates++] = ind_industry;
+            }
+        }
+    }
+}
+
+size_t industry_preview_update(struct industry_preview_t *preview, float x, float y) {
+    const struct industry_t *indus;
+    const struct industry_type_t *indtype;
+    const int tile = place_grid_index(x, y);
+    float dx, dy;
+    size_t i, j;
+
+    _industry_check_coverage();
+
+    if (tile != preview->tile || preview->version != industry_coverage_version) {
+        preview->tile = tile;
+        preview->version = industry_coverage_version;
+
+        _industry_preview_gather(preview);
+    }
+
+    for (i = 0; i < MAX_CARGO_TYPES; i++) {
+        preview->accepts[i] = 0;
+        preview->supplies[i] = 0;
+    }
+
+    preview->num_reached = 0;
+
+    for (i = 0; i < preview->num_candidates; i++) {
+        indus = &industries[preview->candidates[i]];
+        indtype = &industry_types[indus->type];
+
+        dx = indus->pos_x - x;
+        dy = indus->pos_y - y;
+
+        if (dx * dx + dy * dy > indtype->reach * indtype->reach) {
+            continue;
+        }
+
+        preview->reached[preview->num_reached++] = preview->candidates[i];
+
+        for (j = 0; j < indtype->num_accepts; j++) {
+            preview->accepts[industry_mats[indtype->first_accept + j].cargo] = 1;
+        }
+
+        for (j = 0; j < indtype->num_supplies; j++) {
+            preview->supplies[industry_mats[indtype->first_supply + j].cargo] = 1;
+        }
+    }
+
+    return preview->num_reached;
+}
+
+static error_return_t _industry_make_production(industry_handle_t ind_industry, float amount) {
     errcli(_industry_check_index(ind_industry, "industry_check_production"));
 
     struct industry_t *const indus = &industries[ind_industry];
     const struct industry_type_t *const indtype = &industry_types[indus->type];
 
+    const struct industry_mat_t *const supplies = &industry_mats[indtype->first_supply];
+    float *const produced = &industry_produced[indus->first_supply];
+
     int i;
     size_t cargo_type;
     float supply;
 
-    for (i = 0; i < MAX_INDUS_MATS && indtype->supplies[i] != -1; i++) {
-        supply = amount * indtype->supply_weight[i];
-        cargo_type = indtype->supplies[i];
+    for (i = 0; i < indtype->num_supplies; i++) {
+        supply = amount * supplies[i].weight;
+        cargo_type = supplies[i].cargo;
 
-        indus->produced[i] += supply;
+        produced[i] += supply;
 
         // TODO: add actual cargo distribution code
     }
@@ -268,19 +612,26 @@ error_return_t industry_make_production(industry_handle_t ind_industry, float am
     return 0;
 }
 
+error_return_t industry_make_production(industry_handle_t ind_industry, float amount) {
+    trace_call(TRACE_INDUSTRY_MAKE_PRODUCTION, ind_industry, amount);
+
+    return _industry_make_production(ind_industry, amount);
+}
+
 unsigned char industry_is_boosted(industry_handle_t ind_industry) {
     errcla(_industry_check_index(ind_industry, "industry_check_production"), 0);
 
     struct industry_t *const indus = &industries[ind_industry];
     const struct industry_type_t *const indtype = &industry_types[indus->type];
+    const float *const material = &industry_material[indus->first_material];
 
     int i;
 
     switch (indtype->supply_type) {
         case ISUPTYPE_CONVERT:
             // check if all cargo types are received
-            for (i = 0; i < MAX_INDUS_MATS && indtype->accepts[i] != -1; i++) {
-                if (indus->material[i] == 0) {
+            for (i = 0; i < indtype->num_accepts; i++) {
+                if (material[i] == 0) {
                     // this cargo type is not received
                     return 0;
                 }
@@ -289,7 +640,7 @@ unsigned char industry_is_boosted(industry_handle_t ind_industry) {
             return 1;
 
         case ISUPTYPE_BOOST:
-            return indus->material_tot >= indtype->boost_threshold;
+            return industry_material_tot[ind_industry] >= industry_boost_threshold[ind_industry];
 
         default:
             break;
@@ -298,11 +649,12 @@ unsigned char industry_is_boosted(industry_handle_t ind_industry) {
     return 0;
 }
 
-error_return_t industry_check_production(industry_handle_t ind_industry) {
+static error_return_t _industry_check_production(industry_handle_t ind_industry) {
     errcli(_industry_check_index(ind_industry, "industry_check_production"));
 
     struct industry_t *const indus = &industries[ind_industry];
     const struct industry_type_t *const indtype = &industry_types[indus->type];
+    float *const material = &industry_material[indus->first_material];
 
     int boosted = 0;
     int i;
@@ -313,36 +665,32 @@ error_return_t industry_check_production(industry_handle_t ind_industry) {
     switch (indtype->supply_type) {
         case ISUPTYPE_ASSEMBLE:
             // produce only if all cargo types are received
-            for (i = 0; i < MAX_INDUS_MATS && indtype->accepts[i] != -1; i++) {
-                if (indus->material[i] == 0) {
+            for (i = 0; i < indtype->num_accepts; i++) {
+                if (material[i] == 0) {
                     // do not produce, no material of this type
                     erroric(ERR_BAD_MATERIAL, "industry_check_production");
                 }
 
-                if (spent_mat == 0.0 || spent_mat > indus->material[i]) {
-                    spent_mat = indus->material[i];
+                if (spent_mat == 0.0 || spent_mat > material[i]) {
+                    spent_mat = material[i];
                 }
             }
 
             // spend cargos
-            for (i = 0; i < MAX_INDUS_MATS; i++) {
-                if (indtype->accepts[i] == -1) {
-                    break;
-                }
-
+            for (i = 0; i < indtype->num_accepts; i++) {
                 production += spent_mat;
-                indus->material[i] -= spent_mat;
+                material[i] -= spent_mat;
             }
 
         case ISUPTYPE_CONVERT:
             // produce for every cargo type
-            for (i = 0; i < MAX_INDUS_MATS && indtype->accepts[i] != -1; i++) {
-                if (indus->material[i] == 0.0) {
+            for (i = 0; i < indtype->num_accepts; i++) {
+                if (material[i] == 0.0) {
                     continue;
                 }
 
-                production += indus->material[i];
-                indus->material[i] = 0.0;
+                production += material[i];
+                material[i] = 0.0;
             }
 
             break;
@@ -364,20 +712,80 @@ error_return_t industry_check_production(industry_handle_t ind_industry) {
     }
 
     // apply production
-    industry_make_production(ind_industry, production);
+    _industry_make_production(ind_industry, production);
 
     return 0;
 }
 
+error_return_t industry_check_production(industry_handle_t ind_industry) {
+    trace_call(TRACE_INDUSTRY_CHECK_PRODUCTION, ind_industry);
+
+    return _industry_check_production(ind_industry);
+}
+
 error_return_t industry_accept_cargo(industry_handle_t ind_industry, size_t ind_accept, float amount) {
+    trace_call(TRACE_INDUSTRY_ACCEPT_CARGO, ind_industry, ind_accept, amount);
+
     errcli(_industry_check_index_and_accept(ind_industry, ind_accept, "industry_accept_cargo"));
 
     struct industry_t *const indus = &industries[ind_industry];
 
-    indus->material[ind_accept] += amount;
-    indus->material_tot += amount;
+    industry_material[indus->first_material + ind_accept] += amount;
+    industry_material_tot[ind_industry] += amount;
+
+    _industry_check_production(ind_industry);
+
+    return 0;
+}
+
+error_return_t industry_get_produced(industry_handle_t ind_industry, size_t ind_supply, float *amount) {
+    trace_call(TRACE_INDUSTRY_GET_PRODUCED, ind_industry, ind_supply);
+
+    errcli(_industry_check_index(ind_industry, "industry_get_produced"));
+
+    if (ind_supply >= industry_types[industries[ind_industry].type].num_supplies) {
+        erroric(ERR_INDUSTRY_BAD_SUPPLY, "industry_get_produced");
+    }
 
-    industry_check_production(ind_industry);
+    *amount = industry_produced[industries[ind_industry].first_supply + ind_supply];
 
     return 0;
 }
+
+size_t industry_check_boosts(industry_set_t boosted) {
+    int i;
+
+    trace_call(TRACE_INDUSTRY_CHECK_BOOSTS);
+
+    for (i = (num_industries + 31) / 32; i < INDUSTRY_SET_WORDS; i++) {
+        boosted[i] = 0;
+    }
+
+    return vec_ge_bits(industry_material_tot, industry_boost_threshold, boosted, num_industries);
+}
+
+void industry_end_period(void) {
+    trace_call(TRACE_INDUSTRY_END_PERIOD);
+
+    vec_zero(industry_produced, industry_num_supply);
+    vec_zero(industry_transported, industry_num_supply);
+}
+
+float industry_total_produced(void) {
+    trace_call(TRACE_INDUSTRY_TOTAL_PRODUCED);
+
+    return vec_sum(industry_produced, industry_num_supply);
+}
+
+void industry_clear(void) {
+    trace_call(TRACE_INDUSTRY_CLEAR);
+
+    num_industries = 0;
+    industry_num_material = 0;
+    industry_num_supply = 0;
+
+    // forces industry_coverage to be rebuilt, and previews to drop the
+    // industries they gathered
+    industry_coverage_grid = place_grid_version - 1;
+    industry_coverage_version++;
+}
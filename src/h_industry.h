@@ -18,17 +18,9 @@
 
 #include "m_error.h"
 #include "h_cargo.h"
+#include "i_place.h"
 
 
-/**
- * @brief Max. number of materials that can be accepted or supplied.
- *
- * No industry can have more than MAX_INDUS_MATS distinct kinds of
- * accepted cargo, nor more thna MAX_INDUS_MATS distinct kinds of
- * supplied cargo.
- */
-#define MAX_INDUS_MATS  5
-
 /**
  * @brief Max. number of industry types.
  */
@@ -36,8 +28,32 @@
 
 /**
  * @brief Max. number of industries populating the world.
+ *
+ * May be overridden when building, such as by host tools that
+ * simulate larger worlds.
  */
+#ifndef MAX_INDUSTRIES
 #define MAX_INDUSTRIES  128
+#endif
+
+/**
+ * @brief Max. number of material slots shared by all industries.
+ *
+ * Every industry takes a slot per cargo type accepted by its type out
+ * of one shared pool, and a slot per cargo type supplied out of
+ * another. Each pool is sized for an average of three slots per
+ * industry, rather than for the most any type could take.
+ */
+#ifndef MAX_INDUS_SLOTS
+#define MAX_INDUS_SLOTS (MAX_INDUSTRIES * 3)
+#endif
+
+/**
+ * @brief The number of words in a set of industries.
+ *
+ * @see industry_set_t
+ */
+#define INDUSTRY_SET_WORDS ((MAX_INDUSTRIES + 31) / 32)
 
 
 /**
@@ -81,6 +97,30 @@ enum industry_supply_type_t {
     ISUPTYPE_CONVERT
 };
 
+/**
+ * @brief A cargo type accepted or supplied by an industry type.
+ */
+struct industry_mat_t {
+    /**
+     * @brief The cargo type.
+     */
+    cargo_index_t cargo;
+
+    /**
+     * @brief The weight of the cargo type.
+     *
+     * For accepted cargo, the amount of material generated by
+     * supplying it is the amount of cargo in Cargo Units, multiplied
+     * by this weight.
+     *
+     * For supplied cargo, the amount of cargo generated, in Cargo
+     * Units, is the amount of production generated, in Production
+     * Units, multiplied by this weight. Production is not split by
+     * the number of cargo types supplied.
+     */
+    float weight;
+};
+
 /**
  * @brief An industry type.
  */
@@ -150,53 +190,56 @@ struct industry_type_t {
     float reach;
 
     /**
-     * @brief Number of cargo types accepted.
+     * @brief The first cargo type accepted, in industry_mats.
+     *
+     * The accepted cargo types of this type are the num_accepts items
+     * of industry_mats starting from this one.
      */
-    size_t num_accepts;
+    unsigned short first_accept;
 
     /**
-     * @brief Cargo types accepted, by index.
+     * @brief Number of cargo types accepted.
      */
-    cargo_handle_t accepts[MAX_INDUS_MATS];
+    unsigned char num_accepts;
 
     /**
-     * @brief Weight of accepted cargo, by index.
+     * @brief The first cargo type supplied, in industry_mats.
      *
-     * Any cargo supplied to this industry of an accepted type may
-     * result in said industry attaining a certain amount of Material
-     * Units.
-     *
-     * The amount of material generated by supplying an accepted cargo
-     * is the amount of accepted cargo in Cargo Units, multiplied by
-     * the *weight* of that accepted cargo.
+     * The supplied cargo types of this type are the num_supplies items
+     * of industry_mats starting from this one.
      */
-    float accept_weight[MAX_INDUS_MATS];
+    unsigned short first_supply;
 
     /**
      * @brief Number of cargo types supplied.
      */
-    size_t num_supplies;
+    unsigned char num_supplies;
+};
 
-    /**
-     * @brief Cargo types supplied, by index.
-     */
-    cargo_handle_t supplies[MAX_INDUS_MATS];
+/**
+ * @brief An offset into a pool of industry slots.
+ */
+#if MAX_INDUS_SLOTS < 0xFFFF
+typedef unsigned short industry_slot_t;
+#else
+typedef unsigned int industry_slot_t;
+#endif
 
-    /**
-     * @brief Weight of supplied cargo, by index.
-     *
-     * Any cargo that this industry supplies stems from the production
-     * generated by processing the material accumulated in this
-     * industry.
-     *
-     * The precise amount of cargo generated, in Cargo Units, is the
-     * amount of production generated, in Production Units, multiplied
-     * by each cargo type's corresponding supply weight.
-     *
-     * Production is not split by the number of cargo types supplied.
-     */
-    float supply_weight[MAX_INDUS_MATS];
-};
+/**
+ * @brief A compact index into industry_types, for storing in tables.
+ */
+#if MAX_INDUS_TYPES < 0xFF
+typedef unsigned char industry_type_index_t;
+#elif MAX_INDUS_TYPES < 0xFFFF
+typedef unsigned short industry_type_index_t;
+#else
+typedef unsigned int industry_type_index_t;
+#endif
+
+/**
+ * @brief Denotes the absence of an industry type, in an industry_type_index_t.
+ */
+#define INDUSTRY_TYPE_INDEX_NONE ((industry_type_index_t) -1)
 
 /**
  * @brief An instance of an industry somewhere in the world.
@@ -209,26 +252,17 @@ struct industry_t {
      *
      * This is an index into industry_types.
      */
-    size_t type;
+    industry_type_index_t type;
 
     /**
-     * @brief All material accumulated in this industry.
-     *
-     * All material accumulated in this industry in Material
-     * Units, grouped by cargo type.
+     * @brief The first material slot of this industry.
      *
-     * Each item's cargo type is defined by the industry type's
-     * corresponding 'accepts' item.
+     * All material accumulated in this industry, in Material Units,
+     * is kept in one slot per accepted cargo type, starting from this
+     * one; each slot's cargo type is the type's corresponding
+     * accepted one.
      */
-    float material[MAX_INDUS_MATS];
-
-    /**
-     * @brief Total of all material accumulated in this industry.
-     *
-     * The ungrouped total of all material accumulated in this industry,
-     * in Material Units.
-     */
-    float material_tot;
+    industry_slot_t first_material;
 
     /**
      * @brief X coordinate of the position of this industry ingame.
@@ -243,41 +277,168 @@ struct industry_t {
     // -- Stats
 
     /**
-     * @brief The produced amount of supplied cargo over this period.
+     * @brief The first supply slot of this industry.
      *
-     * The produced amount of each supplied cargo type in the current period,
-     * in Cargo Units.
+     * The produced amount, in Cargo Units, and the transported ratio
+     * of each supplied cargo type over the current period are kept in
+     * one slot per supplied cargo type, starting from this one; each
+     * slot's cargo type is the type's corresponding supplied one.
      *
-     * Each number is reset at the end of the period.
+     * A transported ratio of 1.0 means it was all transported from
+     * reachable stations. All stats are reset at the end of the period.
      */
-    float produced[MAX_INDUS_MATS];
+    industry_slot_t first_supply;
+};
 
+/**
+ * @brief The number of all industries in the world.
+ */
+extern M_SIM_STATE int num_industries;
+
+/**
+ * @brief All definitions of industry types in the game.
+ *
+ * Unused items are zeroed, and thus of ISUPTYPE_UNKNOWN.
+ */
+extern M_SIM_TUNABLE struct industry_type_t industry_types[MAX_INDUS_TYPES];
+
+/**
+ * @brief The cargo types accepted and supplied by all industry types.
+ *
+ * @see industry_type_t.first_accept
+ * @see industry_type_t.first_supply
+ */
+extern M_SIM_TUNABLE struct industry_mat_t industry_mats[];
+
+
+// --
+
+/**
+ * @brief An index into an industry.
+ */
+typedef size_t industry_handle_t;
+
+/**
+ * @brief A compact index to an industry, for storing in tables.
+ *
+ * The narrowest unsigned type holding every index below MAX_INDUSTRIES,
+ * with the all-ones value left over as INDUSTRY_INDEX_NONE. Handles are
+ * still passed around as industry_handle_t; narrow them with industry_index.
+ */
+#if MAX_INDUSTRIES < 0xFF
+typedef unsigned char industry_index_t;
+#elif MAX_INDUSTRIES < 0xFFFF
+typedef unsigned short industry_index_t;
+#else
+typedef unsigned int industry_index_t;
+#endif
+
+/**
+ * @brief Denotes the absence of an industry, in an industry_index_t.
+ */
+#define INDUSTRY_INDEX_NONE ((industry_index_t) -1)
+
+/**
+ * @brief Narrows a handle to an industry into a compact index.
+ *
+ * @param ind_industry The handle to narrow.
+ * @return industry_index_t The index, or INDUSTRY_INDEX_NONE if out of range.
+ */
+industry_index_t industry_index(industry_handle_t ind_industry);
+
+/**
+ * @brief A set of industries, one bit per industry.
+ */
+typedef unsigned int industry_set_t[INDUSTRY_SET_WORDS];
+
+/**
+ * @brief What a station would reach if built at a position.
+ *
+ * Used to preview a station placement as the cursor moves. Which
+ * industries may reach a position is looked up per place grid tile,
+ * and only gathered again when the position moves onto another tile;
+ * every call then only checks the exact reach of those candidates.
+ */
+struct industry_preview_t {
     /**
-     * @brief The transported ratio of supplied cargo over this period.
+     * @brief The place grid tile the candidates were gathered for.
      *
-     * The relative amount of each supplied cargo type that was
-     * transported (i.e. distributed into a station) in the current
-     * period.
+     * -1 if outside of the place grid, where every industry is a
+     * candidate.
+     */
+    int tile;
+
+    /**
+     * @brief The industry coverage version the candidates were gathered for.
+     */
+    unsigned int version;
+
+    /**
+     * @brief Industries whose reach covers some of the tile.
      *
-     * 1.0 means it was all transported from reachable stations.
+     * @note Only items up to (num_candidates - 1) should be iterated.
+     */
+    industry_index_t candidates[MAX_INDUSTRIES];
+    size_t num_candidates;
+
+    /**
+     * @brief Industries whose reach covers the position.
      *
-     * All values here are reset at the end of the period.
+     * @note Only items up to (num_reached - 1) should be iterated.
      */
-    float transported[MAX_INDUS_MATS];
+    industry_index_t reached[MAX_INDUSTRIES];
+    size_t num_reached;
+
+    /**
+     * @brief Whether each cargo type would be accepted.
+     */
+    unsigned char accepts[MAX_CARGO_TYPES];
+
+    /**
+     * @brief Whether each cargo type would be supplied.
+     */
+    unsigned char supplies[MAX_CARGO_TYPES];
 };
 
 /**
- * @brief The number of all industries in the world.
+ * @brief Makes a new industry in the world.
+ *
+ * @param type The index of the new industry's type, in industry_types.
+ * @param x X location of the industry.
+ * @param y Y location of the industry.
+ * @return industry_handle_t The opaque handle index to this industry, or -1 on error.
  */
-extern int num_industries;
+industry_handle_t industry_make(size_t type, float x, float y);
 
+/**
+ * @brief Gets which industries may reach a place grid tile.
+ *
+ * These are all industries whose reach covers any part of the tile.
+ *
+ * @param tile The index of the tile in the place grid.
+ * @param set A pointer to an industry set in the which to store them.
+ * @return error_return_t 0 if successful, an error code otherwise.
+ */
+error_return_t industry_get_coverage(int tile, industry_set_t set);
 
-// --
+/**
+ * @brief Starts a new station placement preview.
+ *
+ * @param preview A pointer to the preview to start.
+ */
+void industry_preview_begin(struct industry_preview_t *preview);
 
 /**
- * @brief An index into an industry.
+ * @brief Updates a station placement preview to a position.
+ *
+ * Cheap enough to be called every frame.
+ *
+ * @param preview A pointer to the preview, started with industry_preview_begin.
+ * @param x X location of the would-be station.
+ * @param y Y location of the would-be station.
+ * @return size_t The number of industries the station would reach.
  */
-typedef size_t industry_handle_t;
+size_t industry_preview_update(struct industry_preview_t *preview, float x, float y);
 
 /**
  * @brief Checks if an industry is boosted in its current state.
@@ -292,7 +453,7 @@ unsigned char industry_is_boosted(industry_handle_t ind_industry);
  *
  * Each supplied cargo type is distributed evenly to any reachable stations where
  * that cargo type is loaded. The exact amount of each cargo is the amount of
- * production units multiplied by the respective supply_weight value in that industry's
+ * production units multiplied by the weight of that cargo type in that industry's
  * type. Each is divided by the number of stations loading that kind of cargo.
  *
  * @param ind_industry The industry from the which to make production.
@@ -319,6 +480,50 @@ error_return_t industry_check_production(industry_handle_t ind_industry);
  */
 error_return_t industry_accept_cargo(industry_handle_t ind_industry, size_t ind_accept, float amount);
 
+/**
+ * @brief Gets how much of a supplied cargo an industry produced this period.
+ *
+ * @param ind_industry Index of the industry instance.
+ * @param ind_supply Index of the supplied cargo in the industry's type. NOT cargo type!
+ * @param amount A pointer to a float in the which to store the amount, in Cargo Units.
+ * @return error_return_t 0 if successful, an error code otherwise.
+ */
+error_return_t industry_get_produced(industry_handle_t ind_industry, size_t ind_supply, float *amount);
+
+/**
+ * @brief Checks which boost-type industries are boosted, all at once.
+ *
+ * Equivalent to calling industry_is_boosted for every boost-type
+ * industry, but a single vectorizable sweep over the material totals
+ * of every industry. Industries of other supply types are never set.
+ *
+ * @param boosted A set in the which to store the boosted industries.
+ * @return size_t The number of boosted industries.
+ */
+size_t industry_check_boosts(industry_set_t boosted);
+
+/**
+ * @brief Ends the current period of every industry.
+ *
+ * Resets the stats of every supplied cargo type of every industry,
+ * such as its produced amount.
+ */
+void industry_end_period(void);
+
+/**
+ * @brief Sums up the amount produced by every industry this period.
+ *
+ * @return float The total produced, in Cargo Units, of all cargo types.
+ */
+float industry_total_produced(void);
+
+/**
+ * @brief Removes every industry from the world.
+ *
+ * Handles to any industry are invalid afterwards.
+ */
+void industry_clear(void);
+
 // TODO: decide on a way to do industry_spawn
 //size_t industry_spawn(size_t ind_indus_type, );
 
@@ -0,0 +1,43 @@
+/**
+ * @file h_sim.c
+ * @author Gustavo Rehermann (rehermann6046@gmail.com)
+ * @brief Simulation tic logic.
+ * @version added in 0.1
+ * @date 2021-03-21
+ *
+ * @copyright Copyright (c)Gustavo Ramos Rehermann 2021. The MIT License.
+ */
+
+#include "h_sim.h"
+#include "h_harvest.h"
+#include "h_station.h"
+#include "h_trap.h"
+#include "h_vehicle.h"
+#include "i_flow.h"
+#include "m_trace.h"
+
+
+error_return_t sim_run_tic(unsigned int tic) {
+    error_return_t result = 0;
+
+    trace_set_tic(tic);
+
+    flow_update();
+    vehicle_run_tic(tic);
+
+    // traps harvest into the yields flushed right after
+    iferr(trap_run_tic()) {
+        result = _err;
+    }
+
+    iferr(harvest_flush()) {
+        result = _err;
+    }
+
+    station_merge_inboxes();
+
+    // print this tic's calls, even if no other tic comes
+    trace_flush();
+
+    return result;
+}
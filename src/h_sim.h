@@ -0,0 +1,41 @@
+/**
+ * @file h_sim.h
+ * @author Gustavo Rehermann (rehermann6046@gmail.com)
+ * @brief The simulation tic.
+ * @version added in 0.1
+ * @date 2021-03-21
+ *
+ * Runs, in order, every part of the simulation that must be run once
+ * every tic, so that the tic script of the mod has a single call to
+ * make. Whatever runs every so many tics instead, such as industry
+ * periods, cargo aging and loan interest, is left to the caller.
+ *
+ * @copyright Copyright (c)Gustavo Ramos Rehermann 2021. The MIT License.
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include "m_error.h"
+
+
+/**
+ * @brief Runs a tic of the simulation.
+ *
+ * In order: updates the flow fields, runs the vehicle arrivals due,
+ * processes trap queues, flushes harvest yields, and merges the inboxes
+ * of every station.
+ *
+ * Also sets the tic of traced calls, and flushes the trace at the end,
+ * in builds that trace them; this happens whether or not anything else
+ * is going on in the world. Calls made after it, until the next tic is
+ * run, are recorded as made in this tic.
+ *
+ * @param tic The current tic.
+ * @return error_return_t 0 if successful, else the error code of the
+ * last part that failed. Every part is run all the same.
+ */
+error_return_t sim_run_tic(unsigned int tic);
+
+
+#endif // SIM_H
@@ -11,9 +11,11 @@
  * with vehicles in them.
  */
 
+#include <limits.h>
 #include <stddef.h>
 
 #include "h_station.h"
+#include "m_trace.h"
 
 
 /**
@@ -24,59 +26,956 @@ static struct station_t stations[MAX_STATIONS];
 /**
  * @brief Number of stations in the world.
  */
-static int num_stations;
+size_t num_stations = 0;
+
+/**
+ * @brief The generation of the last station made.
+ */
+static unsigned int station_generation_clock = 0;
+
+/**
+ * @brief The nearest station to the center of each place grid tile.
+ *
+ * STATION_INDEX_NONE where there is no station at all.
+ */
+static station_index_t station_nearest[PLACE_GRID_TILES];
+
+/**
+ * @brief The place grid version station_nearest was built for.
+ *
+ * Starts out matching no version, so that the tables are built before
+ * first use.
+ */
+static unsigned int station_nearest_version = UINT_MAX;
+
+/**
+ * @brief The squared distance from the center of each tile to its
+ * nearest station.
+ */
+static float station_nearest_dist[PLACE_GRID_TILES];
+
+/**
+ * @brief The largest station_nearest_dist in each block of tiles.
+ *
+ * Negative if any tile in the block has no station at all.
+ *
+ * @see STATION_NEAREST_BLOCK
+ */
+static float station_block_reach[STATION_NEAREST_BLOCKS_WIDE * STATION_NEAREST_BLOCKS_WIDE];
+
+/**
+ * @brief The first active station over each place grid tile.
+ *
+ * The rest are chained through station_tile_next.
+ */
+static station_index_t station_tile_head[PLACE_GRID_TILES];
+
+/**
+ * @brief The first active station outside the place grid.
+ */
+static station_index_t station_outside_head = STATION_INDEX_NONE;
+
+/**
+ * @brief The next station over the same tile as each station.
+ */
+static station_index_t station_tile_next[MAX_STATIONS];
+
+/**
+ * @brief The deposits waiting in the inbox of each station.
+ *
+ * Each deposit is kept as a load of its own, to be merged into the
+ * matching load of the station.
+ *
+ * @note Only items up to (station_inbox_length[station] - 1) should be iterated.
+ */
+static struct station_load_t station_inbox[MAX_STATIONS][STATION_INBOX_SIZE];
+static unsigned char station_inbox_length[MAX_STATIONS];
+
+/**
+ * @brief STATION_CARGO_DECAY, compounded over any number of tics.
+ */
+static struct decay_table_t station_decay;
+static int station_decay_built = 0;
 
 
 static error_return_t _station_check_index(station_handle_t ind_station, const char *const ctx) {
-    if (ind_station < num_stations) {
+    if (ind_station >= num_stations || !stations[ind_station].active) {
         erroric(ERR_STATION_BAD_INDEX, ctx);
     }
 
     return 0;
 }
 
+/**
+ * @brief The squared distance from a station to the center of a tile.
+ */
+static float _station_tile_distance(station_handle_t ind_station, int tile) {
+    const float dx = (place_grid_x + tile % PLACE_GRID_WIDTH + 0.5) * SPOT_TILE_WIDTH - stations[ind_station].pos_x;
+    const float dy = (place_grid_y + tile / PLACE_GRID_WIDTH + 0.5) * SPOT_TILE_WIDTH - stations[ind_station].pos_y;
+
+    return dx * dx + dy * dy;
+}
+
+/**
+ * @brief Whether a station is nearer to a tile than the best found so far.
+ *
+ * Ties go to the lowest index, so that the result does not depend on
+ * the order stations are checked in.
+ */
+static int _station_tile_nearer(station_handle_t ind_station, int tile, station_index_t best, float *best_dist) {
+    const float dist = _station_tile_distance(ind_station, tile);
+
+    if (best == STATION_INDEX_NONE || dist < *best_dist || (dist == *best_dist && ind_station < best)) {
+        *best_dist = dist;
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Checks every station in a chain of station_tile_next.
+ */
+static station_index_t _station_nearest_in_chain(station_index_t head, int tile, station_index_t best, float *best_dist) {
+    station_index_t ind_station;
+
+    for (ind_station = head; ind_station != STATION_INDEX_NONE; ind_station = station_tile_next[ind_station]) {
+        if (_station_tile_nearer(ind_station, tile, best, best_dist)) {
+            best = ind_station;
+        }
+    }
+
+    return best;
+}
+
+/**
+ * @brief Finds the nearest active station to a tile, by searching the
+ * station buckets in rings around it.
+ *
+ * @param tile The place grid index of the tile.
+ * @param best_dist Where to store the squared distance to the station found.
+ * @return station_index_t The nearest station, or STATION_INDEX_NONE if there is none.
+ */
+static station_index_t _station_nearest_search(int tile, float *best_dist) {
+    const int tile_x = tile % PLACE_GRID_WIDTH, tile_y = tile / PLACE_GRID_WIDTH;
+    station_index_t best = STATION_INDEX_NONE;
+    int ring, x, y, step;
+
+    for (ring = 0; ring < PLACE_GRID_WIDTH; ring++) {
+        // every station further out is at least (ring - 1) tiles away
+        if (best != STATION_INDEX_NONE && *best_dist < (float) (ring - 1) * SPOT_TILE_WIDTH * (ring - 1) * SPOT_TILE_WIDTH) {
+            break;
+        }
+
+        for (y = tile_y - ring; y <= tile_y + ring; y++) {
+            if (y < 0 || y >= PLACE_GRID_WIDTH) {
+                continue;
+            }
+
+            // inner rows only have the two ends of the ring
+            step = (y == tile_y - ring || y == tile_y + ring || ring == 0) ? 1 : 2 * ring;
+
+            for (x = tile_x - ring; x <= tile_x + ring; x += step) {
+                if (x >= 0 && x < PLACE_GRID_WIDTH) {
+                    best = _station_nearest_in_chain(station_tile_head[y * PLACE_GRID_WIDTH + x], tile, best, best_dist);
+                }
+            }
+        }
+    }
+
+    return _station_nearest_in_chain(station_outside_head, tile, best, best_dist);
+}
+
+/**
+ * @brief Whether a block may hold tiles as near to a station as to
+ * their own nearest station.
+ *
+ * Measured to the edges of the block rather than to the tile centers,
+ * to keep clear of rounding.
+ */
+static int _station_block_near(station_handle_t ind_station, int block) {
+    const float min_x = (float) (place_grid_x + block % STATION_NEAREST_BLOCKS_WIDE * STATION_NEAREST_BLOCK) * SPOT_TILE_WIDTH;
+    const float min_y = (float) (place_grid_y + block / STATION_NEAREST_BLOCKS_WIDE * STATION_NEAREST_BLOCK) * SPOT_TILE_WIDTH;
+    const float max_x = min_x + STATION_NEAREST_BLOCK * SPOT_TILE_WIDTH;
+    const float max_y = min_y + STATION_NEAREST_BLOCK * SPOT_TILE_WIDTH;
+    const float pos_x = stations[ind_station].pos_x, pos_y = stations[ind_station].pos_y;
+    const float dx = pos_x < min_x ? min_x - pos_x : pos_x > max_x ? pos_x - max_x : 0.0;
+    const float dy = pos_y < min_y ? min_y - pos_y : pos_y > max_y ? pos_y - max_y : 0.0;
+
+    return station_block_reach[block] < 0.0 || dx * dx + dy * dy <= station_block_reach[block];
+}
+
+/**
+ * @brief Gets the tiles of a block, as a range of rows and columns.
+ */
+static void _station_block_tiles(int block, int *min_x, int *min_y, int *max_x, int *max_y) {
+    *min_x = block % STATION_NEAREST_BLOCKS_WIDE * STATION_NEAREST_BLOCK;
+    *min_y = block / STATION_NEAREST_BLOCKS_WIDE * STATION_NEAREST_BLOCK;
+    *max_x = *min_x + STATION_NEAREST_BLOCK > PLACE_GRID_WIDTH ? PLACE_GRID_WIDTH : *min_x + STATION_NEAREST_BLOCK;
+    *max_y = *min_y + STATION_NEAREST_BLOCK > PLACE_GRID_WIDTH ? PLACE_GRID_WIDTH : *min_y + STATION_NEAREST_BLOCK;
+}
+
+/**
+ * @brief Recomputes station_block_reach for a block.
+ */
+static void _station_block_update(int block) {
+    int min_x, min_y, max_x, max_y, x, y, tile;
+    float reach = 0.0;
+
+    _station_block_tiles(block, &min_x, &min_y, &max_x, &max_y);
+
+    for (y = min_y; y < max_y; y++) {
+        for (x = min_x; x < max_x; x++) {
+            tile = y * PLACE_GRID_WIDTH + x;
+
+            if (station_nearest[tile] == STATION_INDEX_NONE) {
+                station_block_reach[block] = -1.0;
+                return;
+            }
+
+            if (station_nearest_dist[tile] > reach) {
+                reach = station_nearest_dist[tile];
+            }
+        }
+    }
+
+    station_block_reach[block] = reach;
+}
+
+/**
+ * @brief Puts a station in the station bucket of its tile.
+ */
+static void _station_bucket_add(station_handle_t ind_station) {
+    const int tile = place_grid_index(stations[ind_station].pos_x, stations[ind_station].pos_y);
+    station_index_t *const head = tile == -1 ? &station_outside_head : &station_tile_head[tile];
+
+    station_tile_next[ind_station] = *head;
+    *head = (station_index_t) ind_station;
+}
+
+/**
+ * @brief Takes a station out of the station bucket of its tile.
+ */
+static void _station_bucket_remove(station_handle_t ind_station) {
+    const int tile = place_grid_index(stations[ind_station].pos_x, stations[ind_station].pos_y);
+    station_index_t *link = tile == -1 ? &station_outside_head : &station_tile_head[tile];
+
+    while (*link != STATION_INDEX_NONE) {
+        if (*link == ind_station) {
+            *link = station_tile_next[ind_station];
+            return;
+        }
+
+        link = &station_tile_next[*link];
+    }
+}
+
+/**
+ * @brief Claims, for a new station, every tile it is now nearest to.
+ *
+ * Blocks too far away for any of their tiles to be nearer to it than
+ * to the station they have are skipped.
+ */
+static void _station_nearest_add(station_handle_t ind_station) {
+    int block, min_x, min_y, max_x, max_y, x, y, tile, changed;
+
+    _station_bucket_add(ind_station);
+
+    for (block = 0; block < STATION_NEAREST_BLOCKS_WIDE * STATION_NEAREST_BLOCKS_WIDE; block++) {
+        if (!_station_block_near(ind_station, block)) {
+            continue;
+        }
+
+        _station_block_tiles(block, &min_x, &min_y, &max_x, &max_y);
+        changed = 0;
+
+        for (y = min_y; y < max_y; y++) {
+            for (x = min_x; x < max_x; x++) {
+                tile = y * PLACE_GRID_WIDTH + x;
+
+                if (_station_tile_nearer(ind_station, tile, station_nearest[tile], &station_nearest_dist[tile])) {
+                    station_nearest[tile] = (station_index_t) ind_station;
+                    changed = 1;
+                }
+            }
+        }
+
+        if (changed) {
+            _station_block_update(block);
+        }
+    }
+}
+
+/**
+ * @brief Hands every tile of a removed station over to the nearest
+ * remaining station.
+ *
+ * Only blocks near enough to hold tiles of the station are checked,
+ * and each of its tiles is handed over after a search of the station
+ * buckets around it. The station must already be inactive.
+ */
+static void _station_nearest_remove(station_handle_t ind_station) {
+    int block, min_x, min_y, max_x, max_y, x, y, tile, changed;
+
+    _station_bucket_remove(ind_station);
+
+    for (block = 0; block < STATION_NEAREST_BLOCKS_WIDE * STATION_NEAREST_BLOCKS_WIDE; block++) {
+        if (!_station_block_near(ind_station, block)) {
+            continue;
+        }
+
+        _station_block_tiles(block, &min_x, &min_y, &max_x, &max_y);
+        changed = 0;
+
+        for (y = min_y; y < max_y; y++) {
+            for (x = min_x; x < max_x; x++) {
+                tile = y * PLACE_GRID_WIDTH + x;
+
+                if (station_nearest[tile] == ind_station) {
+                    station_nearest[tile] = _station_nearest_search(tile, &station_nearest_dist[tile]);
+                    changed = 1;
+                }
+            }
+        }
+
+        if (changed) {
+            _station_block_update(block);
+        }
+    }
+}
+
+/**
+ * @brief Rebuilds station_nearest, if the place grid was moved.
+ */
+static void _station_nearest_check_grid(void) {
+    station_handle_t ind_station;
+    int tile, block;
+
+    if (station_nearest_version == place_grid_version) {
+        return;
+    }
+
+    station_nearest_version = place_grid_version;
+    station_outside_head = STATION_INDEX_NONE;
+
+    for (tile = 0; tile < PLACE_GRID_TILES; tile++) {
+        station_tile_head[tile] = STATION_INDEX_NONE;
+    }
+
+    for (ind_station = 0; ind_station < num_stations; ind_station++) {
+        if (stations[ind_station].active) {
+            _station_bucket_add(ind_station);
+        }
+    }
+
+    for (tile = 0; tile < PLACE_GRID_TILES; tile++) {
+        station_nearest[tile] = _station_nearest_search(tile, &station_nearest_dist[tile]);
+    }
+
+    for (block = 0; block < STATION_NEAREST_BLOCKS_WIDE * STATION_NEAREST_BLOCKS_WIDE; block++) {
+        _station_block_update(block);
+    }
+}
+
+station_index_t station_index(station_handle_t ind_station) {
+    if (ind_station >= num_stations) {
+        errorac(ERR_STATION_BAD_INDEX, STATION_INDEX_NONE, "station_index");
+    }
+
+    return (station_index_t) ind_station;
+}
+
+station_handle_t station_make(spot_handle_t spot) {
+    struct station_t *station;
+    const spot_index_t spot_ind = spot_index(spot);
+
+    trace_call(TRACE_STATION_MAKE, spot);
+
+    if (spot_ind == SPOT_INDEX_NONE) {
+        errorac(ERR_PLACE_BAD_SPOT_INDEX, -1, "station_make");
+    }
+
+    if (num_stations >= MAX_STATIONS) {
+        errorac(ERR_STATION_MAXED, -1, "station_make");
+    }
+
+    station = &stations[num_stations];
+
+    station->pos_x = place_spots[spot].x;
+    station->pos_y = place_spots[spot].y;
+    station->spot = spot_ind;
+    station->active = 1;
+    station->generation = ++station_generation_clock;
+    station->num_cargo_loads = 0;
+    station_inbox_length[num_stations] = 0;
+
+    if (station_nearest_version != place_grid_version) {
+        // also adds this station
+        num_stations++;
+        _station_nearest_check_grid();
+
+        return num_stations - 1;
+    }
+
+    _station_nearest_add(num_stations);
+
+    return num_stations++;
+}
+
+error_return_t station_remove(station_handle_t ind_station) {
+    trace_call(TRACE_STATION_REMOVE, ind_station);
+
+    errcli(_station_check_index(ind_station, "station_remove"));
+
+    _station_nearest_check_grid();
+
+    stations[ind_station].active = 0;
+    stations[ind_station].num_cargo_loads = 0;
+    station_inbox_length[ind_station] = 0;
+
+    _station_nearest_remove(ind_station);
+
+    return 0;
+}
+
+int station_is_active(station_handle_t ind_station) {
+    return ind_station < num_stations && stations[ind_station].active;
+}
+
+unsigned int station_get_generation(station_handle_t ind_station) {
+    return station_is_active(ind_station) ? stations[ind_station].generation : 0;
+}
+
+spot_handle_t station_get_spot(station_handle_t ind_station) {
+    errcla(_station_check_index(ind_station, "station_get_spot"), -1);
+
+    return stations[ind_station].spot;
+}
+
+/**
+ * @brief Checks that an origin station fits in the key of a load.
+ *
+ * MAX_STATIONS is checked against STATION_LOAD_ORIGIN_BITS at compile
+ * time, but origins are passed in by callers, and would otherwise spill
+ * into the bits of other fields.
+ */
+static error_return_t _station_check_origin(size_t origin, const char *const ctx) {
+    if (origin >= (1 << STATION_LOAD_ORIGIN_BITS)) {
+        erroric(ERR_STATION_BAD_ORIGIN, ctx);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Converts an amount of cargo to load amount units, rounding to nearest.
+ *
+ * Amounts too large for a load saturate.
+ */
+static int _station_to_load_amount(float amount) {
+    const double scaled = (double) amount * STATION_LOAD_SCALE;
+
+    if (scaled >= INT_MAX) {
+        return INT_MAX;
+    }
+
+    if (scaled <= INT_MIN) {
+        return INT_MIN;
+    }
+
+    return (int) (scaled + (scaled < 0 ? -0.5 : 0.5));
+}
+
+/**
+ * @brief Adds two load amounts, saturating instead of overflowing.
+ */
+static int _station_add_load_amount(int amount, int add) {
+    if (add > 0 && amount > INT_MAX - add) {
+        return INT_MAX;
+    }
+
+    if (add < 0 && amount < INT_MIN - add) {
+        return INT_MIN;
+    }
+
+    return amount + add;
+}
+
 error_return_t station_add_cargo(station_handle_t ind_station, cargo_handle_t cargo_type, int origin, float amount) {
     int i;
 
+    trace_call(TRACE_STATION_ADD_CARGO, ind_station, cargo_type, origin, amount);
+
     errcli(_station_check_index(ind_station, "station_add_cargo"));
 
     struct station_load_t *load;
     struct station_t *station;
+    unsigned int key;
+    int load_amount;
+
+    if (cargo_type >= MAX_CARGO_TYPES) {
+        erroric(ERR_CARGO_BAD_TYPE, "station_add_cargo");
+    }
 
     if (origin == -1) {
         origin = ind_station;
     }
 
+    errcli(_station_check_origin(origin, "station_add_cargo"));
+
+    load_amount = _station_to_load_amount(amount);
+
+    // as with batches and deposits, nothing to add takes up no load
+    if (load_amount == 0) {
+        return 0;
+    }
+
     station = &stations[ind_station];
+    key = station_load_key(cargo_type, origin);
 
     for (i = 0; i < station->num_cargo_loads; i++) {
-        if (station->cargo_loads[i].cargo_type == cargo_type && station->cargo_loads[i].origin == origin) {
-            station->cargo_loads[i].amount += amount;
+        if (station->cargo_loads[i].key == key) {
+            station->cargo_loads[i].amount = _station_add_load_amount(station->cargo_loads[i].amount, load_amount);
             return 0;
         }
     }
 
+    if (station->num_cargo_loads >= MAX_CARGO_LOADS) {
+        erroric(ERR_STATION_MAXED_LOADS, "station_add_cargo");
+    }
+
     load = &station->cargo_loads[station->num_cargo_loads++];
 
-    load->amount = amount;
-    load->cargo_type = cargo_type;
-    load->origin = origin;
+    load->key = key;
+    load->amount = load_amount;
+
+    return 0;
+}
+
+error_return_t station_add_cargo_batch(station_handle_t ind_station, int origin, const cargo_handle_t *cargo_types, const float *amounts, size_t count) {
+    static int sums[MAX_CARGO_TYPES];
+    static int matches[MAX_CARGO_TYPES];
+    static cargo_handle_t types[MAX_CARGO_TYPES];
+
+    // the batch each cargo type was last seen in, so none of the
+    // arrays above ever need clearing
+    static unsigned int seen[MAX_CARGO_TYPES];
+    static unsigned int batch_id = 0;
+
+    cargo_handle_t type;
+    int i, j, num_types = 0, num_new = 0;
+
+    trace_call(TRACE_STATION_ADD_CARGO_BATCH, ind_station, origin, count, cargo_types, amounts);
+
+    errcli(_station_check_index(ind_station, "station_add_cargo_batch"));
+
+    struct station_t *const station = &stations[ind_station];
+    struct station_load_t *load;
+
+    if (count > MAX_CARGO_TYPES) {
+        erroric(ERR_STATION_BATCH_TOO_LARGE, "station_add_cargo_batch");
+    }
+
+    if (origin == -1) {
+        origin = ind_station;
+    }
+
+    errcli(_station_check_origin(origin, "station_add_cargo_batch"));
+
+    batch_id++;
+
+    // fold repeated cargo types into a single amount each
+    for (j = 0; j < count; j++) {
+        type = cargo_types[j];
+
+        if (type >= MAX_CARGO_TYPES) {
+            erroric(ERR_CARGO_BAD_TYPE, "station_add_cargo_batch");
+        }
+
+        if (seen[type] != batch_id) {
+            seen[type] = batch_id;
+            sums[type] = 0;
+            matches[type] = -1;
+            types[num_types++] = type;
+        }
+
+        sums[type] = _station_add_load_amount(sums[type], _station_to_load_amount(amounts[j]));
+    }
+
+    // find the existing load of each cargo type in a single pass
+    for (i = 0; i < station->num_cargo_loads; i++) {
+        load = &station->cargo_loads[i];
+        type = station_load_type(load);
+
+        if (station_load_origin(load) == origin && seen[type] == batch_id) {
+            matches[type] = i;
+        }
+    }
+
+    // make sure the new loads fit before touching anything
+    for (j = 0; j < num_types; j++) {
+        if (matches[types[j]] == -1 && sums[types[j]] != 0) {
+            num_new++;
+        }
+    }
+
+    if (station->num_cargo_loads + num_new > MAX_CARGO_LOADS) {
+        erroric(ERR_STATION_MAXED_LOADS, "station_add_cargo_batch");
+    }
+
+    for (j = 0; j < num_types; j++) {
+        type = types[j];
+
+        if (matches[type] != -1) {
+            load = &station->cargo_loads[matches[type]];
+            load->amount = _station_add_load_amount(load->amount, sums[type]);
+        }
+
+        else if (sums[type] != 0) {
+            load = &station->cargo_loads[station->num_cargo_loads++];
+
+            load->key = station_load_key(type, origin);
+            load->amount = sums[type];
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Hashes a load key into 5 bits, for filtering inbox lookups.
+ */
+static int _station_key_hash(unsigned int key) {
+    return (key ^ (key >> STATION_LOAD_TYPE_BITS)) & 31;
+}
+
+static error_return_t _station_merge_inbox(station_handle_t ind_station) {
+    errcli(_station_check_index(ind_station, "station_merge_inbox"));
+
+    struct station_t *const station = &stations[ind_station];
+    struct station_load_t *const inbox = station_inbox[ind_station];
+    struct station_load_t *load;
+    int i, j, kept, length = station_inbox_length[ind_station];
+    unsigned int filter = 0;
+
+    if (length == 0) {
+        return 0;
+    }
+
+    // sum up deposits of the same key, so each matches a single load
+    for (i = 0; i < length; i++) {
+        for (j = i + 1; j < length; j++) {
+            if (inbox[j].key == inbox[i].key) {
+                inbox[i].amount = _station_add_load_amount(inbox[i].amount, inbox[j].amount);
+                inbox[j--] = inbox[--length];
+            }
+        }
+
+        filter |= 1u << _station_key_hash(inbox[i].key);
+    }
+
+    // merge into existing loads in a single pass, only checking the
+    // inbox for loads whose key hash some deposit shares
+    for (i = 0; i < station->num_cargo_loads && length > 0; i++) {
+        load = &station->cargo_loads[i];
+
+        if (!(filter & (1u << _station_key_hash(load->key)))) {
+            continue;
+        }
+
+        for (j = 0; j < length; j++) {
+            if (load->key == inbox[j].key) {
+                load->amount = _station_add_load_amount(load->amount, inbox[j].amount);
+                inbox[j] = inbox[--length];
+                break;
+            }
+        }
+    }
+
+    // then make new loads for the rest
+    for (j = 0; j < length; j++) {
+        if (inbox[j].amount == 0) {
+            continue;
+        }
+
+        if (station->num_cargo_loads >= MAX_CARGO_LOADS) {
+            // keep the deposits that do not fit, for a later merge
+            for (kept = 0; j < length; j++) {
+                if (inbox[j].amount != 0) {
+                    inbox[kept++] = inbox[j];
+                }
+            }
+
+            station_inbox_length[ind_station] = kept;
+
+            erroric(ERR_STATION_MAXED_LOADS, "station_merge_inbox");
+        }
+
+        station->cargo_loads[station->num_cargo_loads++] = inbox[j];
+    }
+
+    station_inbox_length[ind_station] = 0;
+
+    return 0;
+}
+
+error_return_t station_merge_inbox(station_handle_t ind_station) {
+    trace_call(TRACE_STATION_MERGE_INBOX, ind_station);
+
+    return _station_merge_inbox(ind_station);
+}
+
+error_return_t station_deposit_cargo(station_handle_t ind_station, cargo_handle_t cargo_type, int origin, float amount) {
+    struct station_load_t *deposit;
+
+    trace_call(TRACE_STATION_DEPOSIT_CARGO, ind_station, cargo_type, origin, amount);
+
+    errcli(_station_check_index(ind_station, "station_deposit_cargo"));
+
+    if (cargo_type >= MAX_CARGO_TYPES) {
+        erroric(ERR_CARGO_BAD_TYPE, "station_deposit_cargo");
+    }
+
+    if (origin == -1) {
+        origin = ind_station;
+    }
+
+    errcli(_station_check_origin(origin, "station_deposit_cargo"));
+
+    if (station_inbox_length[ind_station] >= STATION_INBOX_SIZE) {
+        // deposits that do not fit in the loads stay in the inbox; this
+        // one only fails if none of them were folded or merged
+        _station_merge_inbox(ind_station);
+
+        if (station_inbox_length[ind_station] >= STATION_INBOX_SIZE) {
+            erroric(ERR_STATION_MAXED_LOADS, "station_deposit_cargo");
+        }
+    }
+
+    deposit = &station_inbox[ind_station][station_inbox_length[ind_station]++];
+
+    deposit->key = station_load_key(cargo_type, origin);
+    deposit->amount = _station_to_load_amount(amount);
 
     return 0;
 }
 
+void station_merge_inboxes(void) {
+    station_handle_t ind_station;
+
+    trace_call(TRACE_STATION_MERGE_INBOXES);
+
+    for (ind_station = 0; ind_station < num_stations; ind_station++) {
+        if (station_inbox_length[ind_station] > 0) {
+            _station_merge_inbox(ind_station);
+        }
+    }
+}
+
+station_handle_t station_find_nearest(float x, float y) {
+    station_handle_t ind_station, nearest = -1;
+    float dx, dy, dist, best = 0.0;
+    int tile;
+
+    trace_call(TRACE_STATION_FIND_NEAREST, x, y);
+
+    _station_nearest_check_grid();
+
+    tile = place_grid_index(x, y);
+
+    if (tile != -1 && station_nearest[tile] != STATION_INDEX_NONE) {
+        return station_nearest[tile];
+    }
+
+    // outside the place grid; check every station
+    for (ind_station = 0; ind_station < num_stations; ind_station++) {
+        if (!stations[ind_station].active) {
+            continue;
+        }
+
+        dx = stations[ind_station].pos_x - x;
+        dy = stations[ind_station].pos_y - y;
+        dist = dx * dx + dy * dy;
+
+        if (nearest == (station_handle_t) -1 || dist < best) {
+            nearest = ind_station;
+            best = dist;
+        }
+    }
+
+    return nearest;
+}
+
 error_return_t station_get_cargo_amount(station_handle_t ind_station, cargo_handle_t cargo_type, float *amount) {
-    int i;
+    int i, total = 0;
+
+    trace_call(TRACE_STATION_GET_CARGO_AMOUNT, ind_station, cargo_type);
 
     errcli(_station_check_index(ind_station, "station_get_cargo_amount"));
 
+    // deposits that do not fit in the loads stay in the inbox, and are
+    // counted from there
+    _station_merge_inbox(ind_station);
+
     const struct station_t *station = &stations[ind_station];
+    const struct station_load_t *const inbox = station_inbox[ind_station];
+
+    for (i = 0; i < station->num_cargo_loads; i++) {
+        if (station_load_type(&station->cargo_loads[i]) == cargo_type) {
+            total = _station_add_load_amount(total, station->cargo_loads[i].amount);
+        }
+    }
+
+    for (i = 0; i < station_inbox_length[ind_station]; i++) {
+        if (station_load_type(&inbox[i]) == cargo_type) {
+            total = _station_add_load_amount(total, inbox[i].amount);
+        }
+    }
+
+    *amount = (float) total / STATION_LOAD_SCALE;
+
+    return 0;
+}
+
+error_return_t station_visit(station_handle_t ind_station, struct station_visit_t *visit) {
+    int i, kept;
+
+    trace_call(TRACE_STATION_VISIT, ind_station, visit->cargo_type, visit->origin, visit->amount, visit->capacity, visit->unload, visit->load);
+
+    errcli(_station_check_index(ind_station, "station_visit"));
+
+    // deposits that do not fit in the loads stay in the inbox; loading
+    // may yet free up loads for them
+    _station_merge_inbox(ind_station);
+
+    struct station_t *const station = &stations[ind_station];
+    struct station_load_t *load;
+
+    const int unloading = visit->unload && visit->amount > 0;
+    const unsigned int key = station_load_key(visit->cargo_type, visit->origin);
+    int merged = 0;
+
+    // only cargo of a single origin can be carried at once
+    size_t take_origin = (visit->amount > 0 && !unloading) ? visit->origin : (size_t) -1;
+    int room = _station_to_load_amount(visit->capacity - (unloading ? 0.0 : visit->amount));
+    int taken = 0;
+    int take;
+
+    if (visit->cargo_type >= MAX_CARGO_TYPES) {
+        erroric(ERR_CARGO_BAD_TYPE, "station_visit");
+    }
+
+    if (unloading) {
+        errcli(_station_check_origin(visit->origin, "station_visit"));
+    }
+
+    if (unloading && station->num_cargo_loads >= MAX_CARGO_LOADS) {
+        // rare; make sure there is a load to merge into before touching anything
+        for (i = 0; i < station->num_cargo_loads; i++) {
+            if (station->cargo_loads[i].key == key) {
+                break;
+            }
+        }
+
+        if (i == station->num_cargo_loads) {
+            erroric(ERR_STATION_MAXED_LOADS, "station_visit");
+        }
+    }
+
+    // unload, load and drop emptied loads, all in one pass
+    kept = 0;
 
     for (i = 0; i < station->num_cargo_loads; i++) {
-        if (station->cargo_loads[i].cargo_type == cargo_type) {
-            *amount += station->cargo_loads[i].amount;
+        load = &station->cargo_loads[i];
+
+        if (station_load_type(load) != visit->cargo_type) {
+            // not of interest; just keep it
+        }
+
+        else if (unloading && load->key == key) {
+            load->amount = _station_add_load_amount(load->amount, _station_to_load_amount(visit->amount));
+            merged = 1;
+        }
+
+        else if (visit->load && room > 0 && (take_origin == (size_t) -1 || station_load_origin(load) == take_origin)) {
+            take = load->amount < room ? load->amount : room;
+
+            load->amount -= take;
+            room -= take;
+            taken += take;
+            take_origin = station_load_origin(load);
+        }
+
+        if (load->amount > 0) {
+            station->cargo_loads[kept++] = *load;
         }
     }
 
+    station->num_cargo_loads = kept;
+
+    if (unloading && !merged) {
+        load = &station->cargo_loads[station->num_cargo_loads++];
+
+        load->key = key;
+        load->amount = _station_to_load_amount(visit->amount);
+    }
+
+    if (unloading) {
+        visit->amount = 0.0;
+    }
+
+    if (taken > 0) {
+        visit->amount += (float) taken / STATION_LOAD_SCALE;
+        visit->origin = take_origin;
+    }
+
     return 0;
 }
+
+static error_return_t _station_age_cargo(station_handle_t ind_station, unsigned int tics) {
+    errcli(_station_check_index(ind_station, "station_age_cargo"));
+
+    // deposits that do not fit in the loads stay in the inbox, unaged
+    _station_merge_inbox(ind_station);
+
+    struct station_t *const station = &stations[ind_station];
+    fixed_t factor;
+    int i, kept = 0;
+
+    if (!station_decay_built) {
+        decay_table_build(&station_decay, STATION_CARGO_DECAY);
+        station_decay_built = 1;
+    }
+
+    factor = decay_table_factor(&station_decay, tics);
+
+    for (i = 0; i < station->num_cargo_loads; i++) {
+        station->cargo_loads[i].amount = fixed_mul(station->cargo_loads[i].amount, factor);
+
+        if (station->cargo_loads[i].amount > 0) {
+            station->cargo_loads[kept++] = station->cargo_loads[i];
+        }
+    }
+
+    station->num_cargo_loads = kept;
+
+    return 0;
+}
+
+error_return_t station_age_cargo(station_handle_t ind_station, unsigned int tics) {
+    trace_call(TRACE_STATION_AGE_CARGO, ind_station, tics);
+
+    return _station_age_cargo(ind_station, tics);
+}
+
+void station_age_all_cargo(unsigned int tics) {
+    station_handle_t ind_station;
+
+    trace_call(TRACE_STATION_AGE_ALL_CARGO, tics);
+
+    for (ind_station = 0; ind_station < num_stations; ind_station++) {
+        if (stations[ind_station].active) {
+            _station_age_cargo(ind_station, tics);
+        }
+    }
+}
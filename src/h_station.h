@@ -13,23 +13,141 @@
 
 #include <stddef.h>
 #include "m_error.h"
+#include "m_util.h"
 #include "h_cargo.h"
+#include "i_place.h"
 
 /**
  * @brief The maximum number of distinct cargo loads in a single station.
  */
 #define MAX_CARGO_LOADS 32
 
+/**
+ * @brief The max number of deposits waiting in the inbox of a single station.
+ *
+ * @see station_deposit_cargo
+ */
+#define STATION_INBOX_SIZE 8
+
 /**
  * @brief The maximum number of stations in the entire world.
+ *
+ * May be overridden when building, such as by host tools that
+ * simulate larger worlds, along with STATION_LOAD_ORIGIN_BITS.
  */
+#ifndef MAX_STATIONS
 #define MAX_STATIONS 128
+#endif
+
+/**
+ * @brief The width, in tiles, of the blocks station_find_nearest keeps
+ * its bounds in.
+ *
+ * Adding or removing a station only checks the blocks that can hold
+ * tiles whose nearest station changes.
+ */
+#define STATION_NEAREST_BLOCK 8
+
+/**
+ * @brief The width, in blocks, of the place grid.
+ */
+#define STATION_NEAREST_BLOCKS_WIDE ((PLACE_GRID_WIDTH + STATION_NEAREST_BLOCK - 1) / STATION_NEAREST_BLOCK)
 
 /**
  * @brief An index handle to a station.
  */
 typedef size_t station_handle_t;
 
+/**
+ * @brief A compact index to a station, for storing in tables.
+ *
+ * The narrowest unsigned type holding every index below MAX_STATIONS,
+ * with the all-ones value left over as STATION_INDEX_NONE. Handles are
+ * still passed around as station_handle_t; narrow them with station_index.
+ */
+#if MAX_STATIONS < 0xFF
+typedef unsigned char station_index_t;
+#elif MAX_STATIONS < 0xFFFF
+typedef unsigned short station_index_t;
+#else
+typedef unsigned int station_index_t;
+#endif
+
+/**
+ * @brief Denotes the absence of a station, in a station_index_t.
+ */
+#define STATION_INDEX_NONE ((station_index_t) -1)
+
+/**
+ * @brief Narrows a handle to a station into a compact index.
+ *
+ * @param ind_station The handle to narrow.
+ * @return station_index_t The index, or STATION_INDEX_NONE if no such station was made.
+ */
+station_index_t station_index(station_handle_t ind_station);
+
+/**
+ * @brief The number of bits of a load key holding the cargo type.
+ */
+#define STATION_LOAD_TYPE_BITS 6
+
+/**
+ * @brief The number of bits of a load key holding the origin station.
+ *
+ * Origins that do not fit are rejected with ERR_STATION_BAD_ORIGIN
+ * wherever cargo is added to a station.
+ */
+#ifndef STATION_LOAD_ORIGIN_BITS
+#define STATION_LOAD_ORIGIN_BITS 7
+#endif
+
+/**
+ * @brief How many load amount units make up a Cargo Unit.
+ *
+ * Load amounts are fixed point numbers, with 8 fractional bits, so a
+ * single load holds up to about 8 million Cargo Units; adding to a load
+ * beyond that saturates rather than wrapping around.
+ */
+#define STATION_LOAD_SCALE 256
+
+/**
+ * @brief How much of its waiting cargo a station keeps every tic, in 16.16 fixed point.
+ *
+ * Just under 1; waiting cargo halves about every 11000 tics, or five
+ * minutes and a half.
+ *
+ * @see station_age_cargo
+ */
+#define STATION_CARGO_DECAY (FIXED_ONE - 4)
+
+#if MAX_CARGO_TYPES > (1 << STATION_LOAD_TYPE_BITS)
+#error "MAX_CARGO_TYPES does not fit in STATION_LOAD_TYPE_BITS"
+#endif
+
+#if MAX_STATIONS > (1 << STATION_LOAD_ORIGIN_BITS)
+#error "MAX_STATIONS does not fit in STATION_LOAD_ORIGIN_BITS"
+#endif
+
+/**
+ * @brief Makes the key of a load, from its cargo type and origin station.
+ */
+#define station_load_key(cargo_type, origin) (((unsigned int) (origin) << STATION_LOAD_TYPE_BITS) | (unsigned int) (cargo_type))
+
+/**
+ * @brief Gets the cargo type of a load.
+ */
+#define station_load_type(load) ((cargo_handle_t) ((load)->key & ((1 << STATION_LOAD_TYPE_BITS) - 1)))
+
+/**
+ * @brief Gets the origin station of a load.
+ */
+#define station_load_origin(load) ((station_handle_t) ((load)->key >> STATION_LOAD_TYPE_BITS))
+
+/**
+ * @brief Gets the amount of cargo in a load, in Cargo Units.
+ */
+#define station_load_amount(load) ((float) (load)->amount / STATION_LOAD_SCALE)
+
 /**
  * @brief A distinct load of cargo in a station.
  *
@@ -39,25 +157,27 @@ typedef size_t station_handle_t;
  * Any cargo of a different type or origin must be grouped into
  * a different 'load'. Conversely, no two loads exist with the
  * exact same cargo type *and* origin.
+ *
+ * Loads are packed into two words, so that scanning the loads of a
+ * station reads as little as possible; use the station_load_*
+ * accessors rather than the fields.
  */
 struct station_load_t {
     /**
-     * @brief Indef of this load's cargo type.
-     */
-    cargo_handle_t  cargo_type;
-
-    /**
-     * @brief Amount of cargo in this load, in Cargo Units.
+     * @brief The cargo type and origin station of this load.
+     *
+     * The origin is stored above the lowest STATION_LOAD_TYPE_BITS
+     * bits, and the cargo type in them; matching both at once is a
+     * single comparison.
+     *
+     * @see station_load_key
      */
-    float   amount;
+    unsigned int key;
 
     /**
-     * @brief Index of the origin station.
-     *
-     * The index of the station from which all cargo in this
-     * 'load' originated.
+     * @brief Amount of cargo in this load, in units of 1/STATION_LOAD_SCALE Cargo Units.
      */
-    size_t  origin;
+    int amount;
 };
 
 /**
@@ -84,6 +204,31 @@ struct station_t {
      */
     float pos_y;
 
+    /**
+     * @brief The spot this station is built on.
+     *
+     * Vehicles travel to and from stations through their spots.
+     */
+    spot_index_t spot;
+
+    /**
+     * @brief Whether this station still stands.
+     *
+     * Removed stations keep their index, so that handles to other
+     * stations stay valid, but are otherwise ignored.
+     */
+    unsigned char active;
+
+    /**
+     * @brief Tells this station apart from any other that held its index.
+     *
+     * Unique to every station made, so that state kept per station
+     * index elsewhere can tell a removed station from a new one.
+     *
+     * @see station_get_generation
+     */
+    unsigned int generation;
+
     /**
      * @brief All cargo loads in this station.
      *
@@ -97,22 +242,195 @@ struct station_t {
     size_t num_cargo_loads;
 };
 
+/**
+ * @brief The vehicle side of a station visit.
+ *
+ * A vehicle carries a single load of cargo at a time, of a single
+ * cargo type and origin, much like a station_load_t.
+ */
+struct station_visit_t {
+    /**
+     * @brief The type of cargo this vehicle carries.
+     */
+    cargo_handle_t cargo_type;
+
+    /**
+     * @brief The origin station of the cargo this vehicle carries.
+     */
+    size_t origin;
+
+    /**
+     * @brief The amount of cargo this vehicle carries, in Cargo Units.
+     */
+    float amount;
+
+    /**
+     * @brief The max amount of cargo this vehicle carries, in Cargo Units.
+     */
+    float capacity;
+
+    /**
+     * @brief Whether to unload all carried cargo into the station.
+     */
+    unsigned char unload;
+
+    /**
+     * @brief Whether to load waiting cargo from the station, up to capacity.
+     */
+    unsigned char load;
+};
+
+/**
+ * @brief The number of all stations in the world.
+ */
+extern size_t num_stations;
+
+/**
+ * @brief Builds a new station on a spot.
+ *
+ * @param spot The spot to build the station on.
+ * @return station_handle_t The opaque handle index to this station.
+ */
+station_handle_t station_make(spot_handle_t spot);
+
+/**
+ * @brief Removes a station from the world.
+ *
+ * All cargo waiting in it is lost, as is any harvest still pending
+ * for it; see harvest_flush.
+ *
+ * @param ind_station The station to remove.
+ * @return error_return_t 0 if successful, an error code otherwise.
+ */
+error_return_t station_remove(station_handle_t ind_station);
+
+/**
+ * @brief Checks whether a station exists, and was not removed.
+ *
+ * @param ind_station The station to check.
+ * @return int 1 if the station is active, else 0.
+ */
+int station_is_active(station_handle_t ind_station);
+
+/**
+ * @brief Gets the generation of a station.
+ *
+ * State kept per station index, such as pending harvest, should be
+ * stamped with this, and dropped once it no longer matches.
+ *
+ * @param ind_station The station to check.
+ * @return unsigned int The generation of the station, or 0 if it is not active.
+ */
+unsigned int station_get_generation(station_handle_t ind_station);
+
+/**
+ * @brief Gets the spot a station is built on.
+ *
+ * @param ind_station The station to query.
+ * @return spot_handle_t The spot of the station, or -1 if the index is invalid.
+ */
+spot_handle_t station_get_spot(station_handle_t ind_station);
+
 /**
  * @brief Add an amount of a cargo type to this station.
  *
  * @param ind_station The station to the which to add cargo.
  * @param cargo_type The type of the cargo to be added.
  * @param origin The origin of the cargo, or -1 to default to the station itself.
- * @param amount The amount of cargo to add.
+ * @param amount The amount of cargo to add. An amount too small to be
+ * stored adds nothing, and takes up no cargo load.
  * @return error_return_t 0 if successful, an error code otherwise.
  */
 error_return_t station_add_cargo(station_handle_t ind_station, cargo_handle_t cargo_type, int origin, float amount);
 
+/**
+ * @brief Add amounts of several cargo types to this station at once.
+ *
+ * Equivalent to calling station_add_cargo once for each cargo type,
+ * but takes a single pass over the loads of the station, however many
+ * cargo types are added. Repeated cargo types are added into a single
+ * load. Either all of the cargo is added, or, on error, none of it.
+ *
+ * @param ind_station The station to the which to add cargo.
+ * @param origin The origin of the cargo, or -1 to default to the station itself.
+ * @param cargo_types The types of the cargo to be added.
+ * @param amounts The amount of each cargo type to add.
+ * @param count The number of cargo types to add, up to MAX_CARGO_TYPES.
+ * @return error_return_t 0 if successful, an error code otherwise.
+ */
+error_return_t station_add_cargo_batch(station_handle_t ind_station, int origin, const cargo_handle_t *cargo_types, const float *amounts, size_t count);
+
+/**
+ * @brief Deposits an amount of a cargo type into the inbox of this station.
+ *
+ * Unlike station_add_cargo, this does not look up the loads of the
+ * station; the deposit is only appended to an inbox, and merged into
+ * the loads later, along with every other deposit, by
+ * station_merge_inbox. Producers depositing into a station many times
+ * a tic thus only pay for looking up its loads once.
+ *
+ * The inbox is merged early if it is full, and whenever the loads of
+ * the station are read; deposits are never lost nor left unseen. If
+ * the station runs out of loads, deposits that do not fit stay in the
+ * inbox, and only once it is full of them is a deposit refused.
+ *
+ * @param ind_station The station to the which to deposit cargo.
+ * @param cargo_type The type of the cargo to be deposited.
+ * @param origin The origin of the cargo, or -1 to default to the station itself.
+ * @param amount The amount of cargo to deposit.
+ * @return error_return_t 0 if successful, an error code otherwise.
+ */
+error_return_t station_deposit_cargo(station_handle_t ind_station, cargo_handle_t cargo_type, int origin, float amount);
+
+/**
+ * @brief Merges all deposits in the inbox of this station into its loads.
+ *
+ * Deposits of the same cargo type and origin are summed up first, so
+ * that the loads of the station are scanned only once.
+ *
+ * If the station runs out of loads partway, the deposits that do not
+ * fit are kept in the inbox, for a later merge, and
+ * ERR_STATION_MAXED_LOADS is returned.
+ *
+ * @param ind_station The station whose inbox to merge.
+ * @return error_return_t 0 if successful, an error code otherwise.
+ */
+error_return_t station_merge_inbox(station_handle_t ind_station);
+
+/**
+ * @brief Merges the inboxes of every station.
+ *
+ * Should be called once every tic, after all cargo is deposited.
+ */
+void station_merge_inboxes(void);
+
+/**
+ * @brief Finds the station nearest to a position.
+ *
+ * Within the place grid, this is a single lookup into a table of the
+ * nearest station to the center of each tile (a discrete Voronoi
+ * diagram of the stations), which is updated whenever a station is
+ * built or removed, including stations outside the grid. Positions
+ * outside the place grid fall back to checking every station.
+ *
+ * As such, the result is only exact up to the size of a tile; this is
+ * meant for assigning drops, such as harvested cargo, to stations.
+ *
+ * @param x X location in the world.
+ * @param y Y location in the world.
+ * @return station_handle_t The nearest station, or -1 if there are no stations.
+ */
+station_handle_t station_find_nearest(float x, float y);
+
 /**
  * @brief Get the amount of cargo of a specific type in this station.
  *
  * Precisely, this function returns the sum of the amounts of all cargo
- * loads with a matching cargo type.
+ * loads with a matching cargo type. The inbox of the station is merged
+ * first; deposits left in it, for want of loads, are counted as well.
+ *
+ * The amount is stored into the pointed float, replacing its value;
+ * on error, the float is left untouched.
  *
  * @param ind_station The station on the which to query for cargo.
  * @param cargo_type The type of cargo to be queried.
@@ -121,5 +439,46 @@ error_return_t station_add_cargo(station_handle_t ind_station, cargo_handle_t ca
  */
 error_return_t station_get_cargo_amount(station_handle_t ind_station, cargo_handle_t cargo_type, float *amount);
 
+/**
+ * @brief Unloads and loads a visiting vehicle in a single pass.
+ *
+ * All carried cargo is unloaded first, if requested, and merged into
+ * the matching load. Then, if requested, waiting cargo of the same
+ * type is loaded, up to capacity, from loads sharing a single origin;
+ * cargo unloaded in this same visit is never loaded back. Loads left
+ * empty are removed in the same pass. The inbox of the station is
+ * merged first.
+ *
+ * @param ind_station The station being visited.
+ * @param visit The state of the visiting vehicle, updated in place.
+ * @return error_return_t 0 if successful, an error code otherwise.
+ */
+error_return_t station_visit(station_handle_t ind_station, struct station_visit_t *visit);
+
+/**
+ * @brief Ages the cargo waiting in a station over a number of tics.
+ *
+ * Every load loses cargo at STATION_CARGO_DECAY per tic, compounded
+ * over all tics at once from a table; loads left empty are removed.
+ * The inbox of the station is merged first.
+ *
+ * This should not be done every tic, but every so many tics: loads of
+ * less than 32 Cargo Units lose less than half a load amount unit a
+ * tic, which rounds off to nothing.
+ *
+ * @param ind_station The station whose cargo to age.
+ * @param tics The number of tics since the station's cargo was last aged.
+ * @return error_return_t 0 if successful, an error code otherwise.
+ */
+error_return_t station_age_cargo(station_handle_t ind_station, unsigned int tics);
+
+/**
+ * @brief Ages the cargo waiting in every station over a number of tics.
+ *
+ * @param tics The number of tics since cargo was last aged.
+ * @see station_age_cargo
+ */
+void station_age_all_cargo(unsigned int tics);
+
 
 #endif // STATIONS_H
@@ -0,0 +1,149 @@
+/**
+ * @file h_trap.c
+ * @author Gustavo Rehermann (rehermann6046@gmail.com)
+ * @brief Death trap logic.
+ * @version added in 0.1
+ * @date 2021-03-17
+ *
+ * @copyright Copyright (c)Gustavo Ramos Rehermann 2021. The MIT License.
+ */
+
+#include "h_trap.h"
+
+
+/**
+ * @brief All traps in the world.
+ */
+static struct trap_t traps[MAX_TRAPS];
+
+size_t num_traps = 0;
+
+
+static error_return_t _trap_check_index(trap_handle_t ind_trap, const char *const ctx) {
+    if (ind_trap >= num_traps) {
+        erroric(ERR_TRAP_BAD_INDEX, ctx);
+    }
+
+    return 0;
+}
+
+trap_handle_t trap_make(float x, float y, float radius, station_handle_t ind_station, int rate) {
+    struct trap_t *trap;
+    spot_handle_t spot;
+    flow_handle_t flow;
+
+    if (num_traps >= MAX_TRAPS) {
+        errorac(ERR_TRAP_MAXED, -1, "trap_make");
+    }
+
+    if (!station_is_active(ind_station)) {
+        errorac(ERR_STATION_BAD_INDEX, -1, "trap_make");
+    }
+
+    if (rate < 1) {
+        errorac(ERR_TRAP_BAD_RATE, -1, "trap_make");
+    }
+
+    // spots can not be removed, so check everything before making one
+    errcla(spot_can_link(x, y, radius), -1);
+    errcla(flow = flow_add_source(x, y), -1);
+
+    spot = make_spot(x, y);
+
+    if (spot == (spot_handle_t) -1) {
+        flow_remove_source(flow);
+        return -1;
+    }
+
+    iferr(spot_link(spot, radius)) {
+        flow_remove_source(flow);
+        return -1;
+    }
+
+    trap = &traps[num_traps];
+
+    trap->spot = spot_index(spot);
+    trap->station = station_index(ind_station);
+    trap->station_generation = station_get_generation(ind_station);
+    trap->flow = flow;
+    trap->rate = rate;
+    trap->queue_head = 0;
+    trap->queue_length = 0;
+    trap->overflowed = 0;
+
+    return num_traps++;
+}
+
+error_return_t trap_queue_kill(trap_handle_t ind_trap, harvest_class_handle_t monster_class) {
+    struct trap_t *trap;
+
+    errcli(_trap_check_index(ind_trap, "trap_queue_kill"));
+
+    trap = &traps[ind_trap];
+
+    if (trap->queue_length >= TRAP_QUEUE_SIZE) {
+        // the trap is jammed; this corpse goes to waste
+        trap->overflowed++;
+        return 0;
+    }
+
+    trap->queue[(trap->queue_head + trap->queue_length) % TRAP_QUEUE_SIZE] = monster_class;
+    trap->queue_length++;
+
+    return 0;
+}
+
+/**
+ * @brief Relinks a trap to the station nearest it, if its own was removed.
+ *
+ * @return int 1 if the trap has a station to harvest into, else 0.
+ */
+static int _trap_relink(struct trap_t *trap) {
+    const struct spot_t *const spot = &place_spots[trap->spot];
+    station_handle_t nearest;
+
+    if (station_get_generation(trap->station) == trap->station_generation) {
+        return 1;
+    }
+
+    nearest = station_find_nearest(spot->x, spot->y);
+
+    if (nearest == (station_handle_t) -1) {
+        return 0;
+    }
+
+    trap->station = station_index(nearest);
+    trap->station_generation = station_get_generation(nearest);
+
+    return 1;
+}
+
+error_return_t trap_run_tic(void) {
+    struct trap_t *trap;
+    trap_handle_t ind_trap;
+    error_return_t result = 0;
+    int processed;
+
+    for (ind_trap = 0; ind_trap < num_traps; ind_trap++) {
+        trap = &traps[ind_trap];
+
+        if (trap->queue_length > 0 && !_trap_relink(trap)) {
+            // no station left anywhere; these corpses go to waste
+            trap->queue_length = 0;
+            continue;
+        }
+
+        for (processed = 0; processed < trap->rate && trap->queue_length > 0; processed++) {
+            iferr(harvest_kill_at(trap->station, trap->queue[trap->queue_head])) {
+                // leave this trap's kills queued for later
+                result = _err;
+                break;
+            }
+
+            trap->queue_head = (trap->queue_head + 1) % TRAP_QUEUE_SIZE;
+            trap->queue_length--;
+        }
+    }
+
+    return result;
+}
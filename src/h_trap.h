@@ -0,0 +1,151 @@
+/**
+ * @file h_trap.h
+ * @author Gustavo Rehermann (rehermann6046@gmail.com)
+ * @brief Death traps.
+ * @version added in 0.1
+ * @date 2021-03-17
+ *
+ * Death traps are where monsters are funneled into, killed and turned
+ * into cargo. Every trap is linked to a station, into which all of its
+ * harvest goes, and is a flow field source that monsters are steered
+ * towards.
+ *
+ * Kills are not harvested as they happen. Each trap queues them in a
+ * fixed ring queue instead, and processes at most a capped number of
+ * them every tic; a horde wave is thus smoothed out over several tics,
+ * and the cost of a tic stays flat.
+ *
+ * @copyright Copyright (c)Gustavo Ramos Rehermann 2021. The MIT License.
+ */
+
+#ifndef TRAP_H
+#define TRAP_H
+
+#include <stddef.h>
+
+#include "m_error.h"
+#include "i_place.h"
+#include "i_flow.h"
+#include "h_station.h"
+#include "h_harvest.h"
+
+
+/**
+ * @brief The maximum number of traps in the entire world.
+ */
+#define MAX_TRAPS 32
+
+/**
+ * @brief The max number of kills queued in a single trap.
+ */
+#define TRAP_QUEUE_SIZE 64
+
+
+/**
+ * @brief An index handle to a trap.
+ */
+typedef size_t trap_handle_t;
+
+/**
+ * @brief A death trap.
+ */
+struct trap_t {
+    /**
+     * @brief The spot this trap is registered at.
+     */
+    spot_index_t spot;
+
+    /**
+     * @brief The station all harvest of this trap goes into.
+     *
+     * If it is removed, the trap is relinked to the station nearest it.
+     */
+    station_index_t station;
+
+    /**
+     * @brief The generation of that station, when the trap was linked to it.
+     *
+     * @see station_get_generation
+     */
+    unsigned int station_generation;
+
+    /**
+     * @brief The flow field source steering monsters towards this trap.
+     */
+    flow_handle_t flow;
+
+    /**
+     * @brief How many kills this trap processes every tic, at most.
+     */
+    int rate;
+
+    /**
+     * @brief The queue of kills yet to be processed, as a ring.
+     *
+     * Each item is the class of the killed monster.
+     */
+    harvest_class_handle_t queue[TRAP_QUEUE_SIZE];
+
+    /**
+     * @brief The index of the oldest kill in the queue.
+     */
+    int queue_head;
+
+    /**
+     * @brief The number of kills in the queue.
+     */
+    int queue_length;
+
+    /**
+     * @brief The number of kills lost because the queue was full.
+     */
+    unsigned int overflowed;
+};
+
+/**
+ * @brief The number of all traps in the world.
+ */
+extern size_t num_traps;
+
+/**
+ * @brief Builds a new trap.
+ *
+ * Makes a spot for the trap, links it to all spotmap tiles within its
+ * radius, and adds a flow field source at it.
+ *
+ * @param x X location of the trap.
+ * @param y Y location of the trap.
+ * @param radius The radius of the trap's killing zone.
+ * @param ind_station The station to harvest into; must be active.
+ * @param rate How many kills the trap processes every tic, at most; at least 1.
+ * @return trap_handle_t The opaque handle index to this trap, or -1 on
+ * error, in which case no spot nor flow field source is left behind.
+ */
+trap_handle_t trap_make(float x, float y, float radius, station_handle_t ind_station, int rate);
+
+/**
+ * @brief Queues a kill made by a trap.
+ *
+ * @param ind_trap The trap that made the kill.
+ * @param monster_class The class of the killed monster.
+ * @return error_return_t 0 if successful, an error code otherwise.
+ */
+error_return_t trap_queue_kill(trap_handle_t ind_trap, harvest_class_handle_t monster_class);
+
+/**
+ * @brief Processes the queued kills of every trap.
+ *
+ * Should be called once every tic, before harvest_flush. Kills that
+ * could not be harvested stay queued.
+ *
+ * Traps whose station was removed are first relinked to the station
+ * nearest them; if there are no stations left at all, their queued
+ * kills go to waste, as with harvest_kill.
+ *
+ * @return error_return_t 0 if successful, else the error code of the
+ * last kill that could not be harvested.
+ */
+error_return_t trap_run_tic(void);
+
+
+#endif // TRAP_H
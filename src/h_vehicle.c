@@ -0,0 +1,445 @@
+/**
+ * @file h_vehicle.c
+ * @author Gustavo Rehermann (rehermann6046@gmail.com)
+ * @brief Vehicle logic.
+ * @version added in 0.1
+ * @date 2021-03-15
+ *
+ * @copyright Copyright (c)Gustavo Ramos Rehermann 2021. The MIT License.
+ *
+ * The logic that governs how vehicles travel between stations, and
+ * carry cargo between them.
+ */
+
+#include "h_vehicle.h"
+
+
+/**
+ * @brief A value of vehicles.moving; stopped.
+ */
+#define VEHICLE_STOPPED 0
+
+/**
+ * @brief A value of vehicles.moving; travelling on a route.
+ */
+#define VEHICLE_MOVING 1
+
+/**
+ * @brief A value of vehicles.moving; stopped, but due to depart.
+ */
+#define VEHICLE_DUE 2
+
+
+/**
+ * @brief All vehicles in the world.
+ */
+struct vehicle_store_t vehicles;
+
+size_t num_vehicles = 0;
+
+struct vehicle_pooled_order_t vehicle_orders[MAX_VEHICLE_ORDERS];
+
+/**
+ * @brief The number of orders in vehicle_orders in use, or left as holes.
+ */
+static int vehicle_orders_used = 0;
+
+/**
+ * @brief A scheduled arrival.
+ */
+struct _vehicle_event_t {
+    unsigned int tic;
+    vehicle_handle_t vehicle;
+};
+
+/**
+ * @brief All scheduled arrivals, as a binary min-heap by tic.
+ *
+ * Only moving or due vehicles have an event scheduled, and neither
+ * can be scheduled again, so there is never more than one per vehicle.
+ */
+static struct _vehicle_event_t vehicle_events[MAX_VEHICLES];
+static int vehicle_num_events = 0;
+
+
+static error_return_t _vehicle_check_index(vehicle_handle_t ind_vehicle, const char *const ctx) {
+    if (ind_vehicle >= num_vehicles) {
+        erroric(ERR_VEHICLE_BAD_INDEX, ctx);
+    }
+
+    return 0;
+}
+
+static void _vehicle_schedule(unsigned int tic, vehicle_handle_t ind_vehicle) {
+    int i = vehicle_num_events++;
+
+    // sift up
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+
+        if (vehicle_events[parent].tic <= tic) {
+            break;
+        }
+
+        vehicle_events[i] = vehicle_events[parent];
+        i = parent;
+    }
+
+    vehicle_events[i].tic = tic;
+    vehicle_events[i].vehicle = ind_vehicle;
+}
+
+static vehicle_handle_t _vehicle_unschedule(void) {
+    const vehicle_handle_t top = vehicle_events[0].vehicle;
+    const struct _vehicle_event_t last = vehicle_events[--vehicle_num_events];
+    int i = 0;
+
+    // sift down
+    while (1) {
+        int child = i * 2 + 1;
+
+        if (child >= vehicle_num_events) {
+            break;
+        }
+
+        if (child + 1 < vehicle_num_events && vehicle_events[child + 1].tic < vehicle_events[child].tic) {
+            child++;
+        }
+
+        if (last.tic <= vehicle_events[child].tic) {
+            break;
+        }
+
+        vehicle_events[i] = vehicle_events[child];
+        i = child;
+    }
+
+    vehicle_events[i] = last;
+
+    return top;
+}
+
+vehicle_handle_t vehicle_make(spot_handle_t spot, int speed, cargo_handle_t cargo_type, float capacity, company_handle_t owner) {
+    const vehicle_handle_t ind_vehicle = num_vehicles;
+    const spot_index_t spot_ind = spot_index(spot);
+    const cargo_index_t cargo_ind = cargo_index(cargo_type);
+    const company_index_t owner_ind = company_index(owner);
+
+    if (spot_ind == SPOT_INDEX_NONE) {
+        errorac(ERR_PLACE_BAD_SPOT_INDEX, -1, "vehicle_make");
+    }
+
+    if (cargo_ind == CARGO_INDEX_NONE) {
+        errorac(ERR_CARGO_BAD_TYPE, -1, "vehicle_make");
+    }
+
+    if (owner_ind == COMPANY_INDEX_NONE) {
+        errorac(ERR_COMPANY_BAD_INDEX, -1, "vehicle_make");
+    }
+
+    if (num_vehicles >= MAX_VEHICLES) {
+        errorac(ERR_VEHICLE_MAXED, -1, "vehicle_make");
+    }
+
+    vehicles.spot[ind_vehicle] = spot_ind;
+    vehicles.speed[ind_vehicle] = speed > 0 ? speed : 1;
+    vehicles.moving[ind_vehicle] = VEHICLE_STOPPED;
+    vehicles.route[ind_vehicle] = -1;
+
+    vehicles.cargo_type[ind_vehicle] = cargo_ind;
+    vehicles.cargo_origin[ind_vehicle] = 0;
+    vehicles.capacity[ind_vehicle] = capacity;
+    vehicles.load[ind_vehicle] = 0.0;
+
+    vehicles.order_first[ind_vehicle] = 0;
+    vehicles.num_orders[ind_vehicle] = 0;
+    vehicles.order_index[ind_vehicle] = 0;
+
+    vehicles.owner[ind_vehicle] = owner_ind;
+
+    return num_vehicles++;
+}
+
+/**
+ * @brief Packs all order lists to the start of the order pool.
+ *
+ * Replacing an order list leaves a hole behind, in the old list's
+ * place; holes are only reclaimed once the pool runs out.
+ */
+static void _vehicle_compact_orders(void) {
+    static struct vehicle_pooled_order_t packed[MAX_VEHICLE_ORDERS];
+    vehicle_handle_t ind_vehicle;
+    int i, used = 0;
+
+    for (ind_vehicle = 0; ind_vehicle < num_vehicles; ind_vehicle++) {
+        const int first = vehicles.order_first[ind_vehicle];
+
+        vehicles.order_first[ind_vehicle] = used;
+
+        for (i = 0; i < vehicles.num_orders[ind_vehicle]; i++) {
+            packed[used++] = vehicle_orders[first + i];
+        }
+    }
+
+    for (i = 0; i < used; i++) {
+        vehicle_orders[i] = packed[i];
+    }
+
+    vehicle_orders_used = used;
+}
+
+error_return_t vehicle_set_orders(vehicle_handle_t ind_vehicle, const struct vehicle_order_t *orders, int num_orders) {
+    vehicle_handle_t other;
+    int i, live;
+
+    errcli(_vehicle_check_index(ind_vehicle, "vehicle_set_orders"));
+
+    // validate everything first, so a failed call keeps the old list
+    if (num_orders < 0) {
+        erroric(ERR_VEHICLE_MAXED_ORDERS, "vehicle_set_orders");
+    }
+
+    for (i = 0; i < num_orders; i++) {
+        // checked at full width, before station_index narrows it
+        if (orders[i].station >= num_stations) {
+            erroric(ERR_STATION_BAD_INDEX, "vehicle_set_orders");
+        }
+    }
+
+    if (vehicle_orders_used + num_orders > MAX_VEHICLE_ORDERS) {
+        // only compact if the new list fits once the old one is gone
+        live = num_orders;
+
+        for (other = 0; other < num_vehicles; other++) {
+            if (other != ind_vehicle) {
+                live += vehicles.num_orders[other];
+            }
+        }
+
+        if (live > MAX_VEHICLE_ORDERS) {
+            erroric(ERR_VEHICLE_MAXED_ORDERS, "vehicle_set_orders");
+        }
+
+        // drop the old list, so compaction can reclaim it
+        vehicles.num_orders[ind_vehicle] = 0;
+        _vehicle_compact_orders();
+    }
+
+    for (i = 0; i < num_orders; i++) {
+        vehicle_orders[vehicle_orders_used + i].station = station_index(orders[i].station);
+        vehicle_orders[vehicle_orders_used + i].flags = orders[i].flags;
+    }
+
+    vehicles.order_first[ind_vehicle] = vehicle_orders_used;
+    vehicles.num_orders[ind_vehicle] = num_orders;
+    vehicles.order_index[ind_vehicle] = 0;
+
+    vehicle_orders_used += num_orders;
+
+    // a stopped vehicle departs on the next tic run
+    if (num_orders > 0 && vehicles.moving[ind_vehicle] == VEHICLE_STOPPED) {
+        vehicles.moving[ind_vehicle] = VEHICLE_DUE;
+        _vehicle_schedule(0, ind_vehicle);
+    }
+
+    return 0;
+}
+
+error_return_t vehicle_depart(vehicle_handle_t ind_vehicle, spot_handle_t to, unsigned int tic) {
+    const struct path_route_t *route;
+    route_handle_t ind_route;
+    int length;
+
+    errcli(_vehicle_check_index(ind_vehicle, "vehicle_depart"));
+
+    if (vehicles.moving[ind_vehicle] != VEHICLE_STOPPED) {
+        erroric(ERR_VEHICLE_MOVING, "vehicle_depart");
+    }
+
+    errcli(ind_route = path_find(vehicles.spot[ind_vehicle], to));
+    errcli(path_hold(ind_route));
+
+    route = path_get_route(ind_route);
+    length = route->dist[route->num_nodes - 1];
+
+    vehicles.route[ind_vehicle] = ind_route;
+    vehicles.depart_tic[ind_vehicle] = tic;
+    vehicles.arrive_tic[ind_vehicle] = tic + (length + vehicles.speed[ind_vehicle] - 1) / vehicles.speed[ind_vehicle];
+
+    if (vehicles.arrive_tic[ind_vehicle] == tic) {
+        // never arrive on the tic of departure, or a vehicle with a
+        // single order could loop forever within one vehicle_run_tic
+        vehicles.arrive_tic[ind_vehicle]++;
+    }
+
+    vehicles.moving[ind_vehicle] = VEHICLE_MOVING;
+
+    _vehicle_schedule(vehicles.arrive_tic[ind_vehicle], ind_vehicle);
+
+    return 0;
+}
+
+error_return_t vehicle_get_position(vehicle_handle_t ind_vehicle, unsigned int tic, float *x, float *y) {
+    const struct path_route_t *route;
+    const struct spot_t *from, *to;
+    unsigned int depart_tic;
+    int travelled, low, high, mid, span;
+    float along;
+
+    errcli(_vehicle_check_index(ind_vehicle, "vehicle_get_position"));
+
+    depart_tic = vehicles.depart_tic[ind_vehicle];
+
+    if (vehicles.moving[ind_vehicle] != VEHICLE_MOVING || tic <= depart_tic) {
+        *x = place_spots[vehicles.spot[ind_vehicle]].x;
+        *y = place_spots[vehicles.spot[ind_vehicle]].y;
+        return 0;
+    }
+
+    route = path_get_route(vehicles.route[ind_vehicle]);
+    travelled = (tic - depart_tic) * vehicles.speed[ind_vehicle];
+
+    if (tic >= vehicles.arrive_tic[ind_vehicle] || travelled >= route->dist[route->num_nodes - 1]) {
+        *x = place_spots[route->to].x;
+        *y = place_spots[route->to].y;
+        return 0;
+    }
+
+    // find the last waypoint passed, i.e. the last with dist <= travelled
+    low = 0;
+    high = route->num_nodes - 1;
+
+    while (high - low > 1) {
+        mid = (low + high) / 2;
+
+        if (route->dist[mid] <= travelled) {
+            low = mid;
+        }
+
+        else {
+            high = mid;
+        }
+    }
+
+    from = &place_spots[route->nodes[low]];
+    to = &place_spots[route->nodes[high]];
+    span = route->dist[high] - route->dist[low];
+
+    if (span <= 0) {
+        // coinciding waypoints
+        *x = from->x;
+        *y = from->y;
+        return 0;
+    }
+
+    along = (float) (travelled - route->dist[low]) / (float) span;
+
+    *x = from->x + (to->x - from->x) * along;
+    *y = from->y + (to->y - from->y) * along;
+
+    return 0;
+}
+
+error_return_t vehicle_is_moving(vehicle_handle_t ind_vehicle) {
+    errcli(_vehicle_check_index(ind_vehicle, "vehicle_is_moving"));
+
+    return vehicles.moving[ind_vehicle] == VEHICLE_MOVING;
+}
+
+/**
+ * @brief Unloads and loads a vehicle at the station it is stopped at.
+ */
+static void _vehicle_visit(vehicle_handle_t ind_vehicle, const struct vehicle_pooled_order_t *order) {
+    struct station_visit_t visit;
+
+    visit.cargo_type = vehicles.cargo_type[ind_vehicle];
+    visit.origin = vehicles.cargo_origin[ind_vehicle];
+    visit.amount = vehicles.load[ind_vehicle];
+    visit.capacity = vehicles.capacity[ind_vehicle];
+    visit.unload = (order->flags & ORDER_UNLOAD) != 0;
+    visit.load = (order->flags & ORDER_LOAD) != 0;
+
+    errclv(station_visit(order->station, &visit));
+
+    vehicles.cargo_origin[ind_vehicle] = (station_index_t) visit.origin;
+    vehicles.load[ind_vehicle] = visit.amount;
+}
+
+/**
+ * @brief Moves the current order of a vehicle past orders to removed stations.
+ *
+ * @return const struct vehicle_pooled_order_t* The current order, or
+ * NULL if every order is to a removed station.
+ */
+static const struct vehicle_pooled_order_t *_vehicle_current_order(vehicle_handle_t ind_vehicle) {
+    const int num_orders = vehicles.num_orders[ind_vehicle];
+    const struct vehicle_pooled_order_t *order;
+    int skipped;
+
+    for (skipped = 0; skipped < num_orders; skipped++) {
+        order = &vehicle_orders[vehicles.order_first[ind_vehicle] + vehicles.order_index[ind_vehicle]];
+
+        if (station_is_active(order->station)) {
+            return order;
+        }
+
+        vehicles.order_index[ind_vehicle] = (vehicles.order_index[ind_vehicle] + 1) % num_orders;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Handles a due event of a vehicle.
+ *
+ * Stops an arriving vehicle at the end of its route, services its
+ * current order if it arrived at that order's station, and departs
+ * it towards its next order, skipping orders to removed stations.
+ *
+ * A vehicle that can not depart is scheduled to try again later;
+ * nothing else would ever wake a stopped vehicle up.
+ */
+static void _vehicle_arrive(vehicle_handle_t ind_vehicle, unsigned int tic) {
+    const struct vehicle_pooled_order_t *order;
+
+    if (vehicles.moving[ind_vehicle] == VEHICLE_MOVING) {
+        vehicles.spot[ind_vehicle] = path_get_route(vehicles.route[ind_vehicle])->to;
+
+        path_release(vehicles.route[ind_vehicle]);
+        vehicles.route[ind_vehicle] = -1;
+    }
+
+    vehicles.moving[ind_vehicle] = VEHICLE_STOPPED;
+
+    if (vehicles.num_orders[ind_vehicle] == 0) {
+        return;
+    }
+
+    order = _vehicle_current_order(ind_vehicle);
+
+    if (order != NULL && station_get_spot(order->station) == vehicles.spot[ind_vehicle]) {
+        _vehicle_visit(ind_vehicle, order);
+
+        vehicles.order_index[ind_vehicle] = (vehicles.order_index[ind_vehicle] + 1) % vehicles.num_orders[ind_vehicle];
+        order = _vehicle_current_order(ind_vehicle);
+    }
+
+    if (order != NULL) {
+        iferr(vehicle_depart(ind_vehicle, station_get_spot(order->station), tic)) {
+            order = NULL;
+        }
+    }
+
+    if (order == NULL) {
+        vehicles.moving[ind_vehicle] = VEHICLE_DUE;
+        _vehicle_schedule(tic + VEHICLE_RETRY_TICS, ind_vehicle);
+
+        errorvc(ERR_VEHICLE_STRANDED, "vehicle_run_tic");
+    }
+}
+
+void vehicle_run_tic(unsigned int tic) {
+    while (vehicle_num_events > 0 && vehicle_events[0].tic <= tic) {
+        _vehicle_arrive(_vehicle_unschedule(), tic);
+    }
+}
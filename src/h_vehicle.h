@@ -0,0 +1,280 @@
+/**
+ * @file h_vehicle.h
+ * @author Gustavo Rehermann (rehermann6046@gmail.com)
+ * @brief Vehicles.
+ * @version added in 0.1
+ * @date 2021-03-15
+ *
+ * Vehicles move 'on rails': rather than being moved a little every
+ * tic, a moving vehicle only stores when it departed, the route it is
+ * travelling on, and its speed. Its position is then computed only
+ * when something actually asks for it, such as rendering it near a
+ * player.
+ *
+ * Arrival is known as soon as a vehicle departs, so it is scheduled as
+ * a single future event; vehicles on their way cost nothing at all
+ * until they arrive.
+ *
+ * Each vehicle loops through a list of orders, each telling it which
+ * station to visit next, and whether to unload and load cargo there.
+ *
+ * @copyright Copyright (c)Gustavo Ramos Rehermann 2021. The MIT License.
+ */
+
+#ifndef VEHICLE_H
+#define VEHICLE_H
+
+#include <stddef.h>
+
+#include "m_error.h"
+#include "i_place.h"
+#include "i_path.h"
+#include "h_cargo.h"
+#include "h_station.h"
+#include "h_company.h"
+
+
+/**
+ * @brief The maximum number of vehicles in the entire world.
+ */
+#define MAX_VEHICLES 256
+
+#if MAX_CACHED_ROUTES <= MAX_VEHICLES
+#error "MAX_CACHED_ROUTES must exceed MAX_VEHICLES, or moving vehicles can fill the route cache"
+#endif
+
+/**
+ * @brief How many tics a vehicle waits before trying to depart again.
+ *
+ * A vehicle finding no route to its next order, e.g. because its
+ * station was removed or the graph was changed, stays put until then.
+ */
+#define VEHICLE_RETRY_TICS 35
+
+/**
+ * @brief The maximum number of orders, shared among all vehicles.
+ */
+#define MAX_VEHICLE_ORDERS 1024
+
+/**
+ * @brief Unload all carried cargo at the order's station.
+ */
+#define ORDER_UNLOAD 1
+
+/**
+ * @brief Load waiting cargo at the order's station, up to capacity.
+ */
+#define ORDER_LOAD 2
+
+
+/**
+ * @brief An index handle to a vehicle.
+ */
+typedef size_t vehicle_handle_t;
+
+/**
+ * @brief A vehicle order.
+ *
+ * Vehicles visit the stations in their order list in a loop.
+ */
+struct vehicle_order_t {
+    /**
+     * @brief The station to be visited.
+     */
+    station_handle_t station;
+
+    /**
+     * @brief What to do at the station.
+     *
+     * A combination of ORDER_UNLOAD and ORDER_LOAD.
+     */
+    unsigned char flags;
+};
+
+/**
+ * @brief A vehicle order, as stored in the order pool.
+ *
+ * The same as a vehicle_order_t, but with the station narrowed to a
+ * station_index_t, once it is known to be valid.
+ */
+struct vehicle_pooled_order_t {
+    station_index_t station;
+    unsigned char flags;
+};
+
+/**
+ * @brief All state of every vehicle in the world.
+ *
+ * Vehicles are stored as a structure of arrays, indexed by vehicle
+ * handle, rather than as an array of vehicle structures; sweeps over
+ * a single field of every vehicle then read only that field.
+ */
+struct vehicle_store_t {
+    // -- Movement
+
+    /**
+     * @brief The spot each vehicle is stopped at, or last departed from.
+     */
+    spot_index_t spot[MAX_VEHICLES];
+
+    /**
+     * @brief The speed of each vehicle, in map units per tic.
+     */
+    int speed[MAX_VEHICLES];
+
+    /**
+     * @brief Whether each vehicle is currently moving.
+     */
+    unsigned char moving[MAX_VEHICLES];
+
+    /**
+     * @brief The route each vehicle is travelling on.
+     *
+     * Held for as long as the vehicle is moving.
+     */
+    route_handle_t route[MAX_VEHICLES];
+
+    /**
+     * @brief The tic each vehicle departed at.
+     */
+    unsigned int depart_tic[MAX_VEHICLES];
+
+    /**
+     * @brief The tic each vehicle will arrive at.
+     */
+    unsigned int arrive_tic[MAX_VEHICLES];
+
+    // -- Cargo
+
+    /**
+     * @brief The type of cargo each vehicle carries.
+     */
+    cargo_index_t cargo_type[MAX_VEHICLES];
+
+    /**
+     * @brief The origin station of the cargo each vehicle carries.
+     */
+    station_index_t cargo_origin[MAX_VEHICLES];
+
+    /**
+     * @brief The max amount of cargo each vehicle carries, in Cargo Units.
+     */
+    float capacity[MAX_VEHICLES];
+
+    /**
+     * @brief The amount of cargo each vehicle carries, in Cargo Units.
+     */
+    float load[MAX_VEHICLES];
+
+    // -- Orders
+
+    /**
+     * @brief The first order of each vehicle in vehicle_orders.
+     */
+    int order_first[MAX_VEHICLES];
+
+    /**
+     * @brief The number of orders of each vehicle.
+     */
+    int num_orders[MAX_VEHICLES];
+
+    /**
+     * @brief The current order of each vehicle, relative to order_first.
+     */
+    int order_index[MAX_VEHICLES];
+
+    // -- Ownership
+
+    /**
+     * @brief The company owning each vehicle.
+     */
+    company_index_t owner[MAX_VEHICLES];
+};
+
+/**
+ * @brief All vehicles in the world.
+ */
+extern struct vehicle_store_t vehicles;
+
+/**
+ * @brief The orders of all vehicles, each list stored contiguously.
+ */
+extern struct vehicle_pooled_order_t vehicle_orders[MAX_VEHICLE_ORDERS];
+
+/**
+ * @brief The number of all vehicles in the world.
+ */
+extern size_t num_vehicles;
+
+/**
+ * @brief Define a new vehicle.
+ *
+ * @param spot The spot where the vehicle is placed, stopped.
+ * @param speed The speed of the vehicle, in map units per tic.
+ * @param cargo_type The type of cargo the vehicle carries.
+ * @param capacity The max amount of cargo the vehicle carries, in Cargo Units.
+ * @param owner The company owning the vehicle.
+ * @return vehicle_handle_t The opaque handle index to this vehicle.
+ */
+vehicle_handle_t vehicle_make(spot_handle_t spot, int speed, cargo_handle_t cargo_type, float capacity, company_handle_t owner);
+
+/**
+ * @brief Replaces the order list of a vehicle.
+ *
+ * The orders are copied into the shared order pool. A stopped vehicle
+ * with orders will depart towards its first order on the next tic.
+ *
+ * @param ind_vehicle The vehicle whose orders to set.
+ * @param orders The new orders.
+ * @param num_orders The number of new orders.
+ * @return error_return_t 0 if successful, an error code otherwise.
+ */
+error_return_t vehicle_set_orders(vehicle_handle_t ind_vehicle, const struct vehicle_order_t *orders, int num_orders);
+
+/**
+ * @brief Makes a stopped vehicle depart towards a spot.
+ *
+ * Finds (or reuses) a route to the destination, and schedules the
+ * arrival of the vehicle there.
+ *
+ * @param ind_vehicle The vehicle to depart.
+ * @param to The spot to travel to.
+ * @param tic The current tic.
+ * @return error_return_t 0 if successful, an error code otherwise.
+ */
+error_return_t vehicle_depart(vehicle_handle_t ind_vehicle, spot_handle_t to, unsigned int tic);
+
+/**
+ * @brief Computes the position of a vehicle at a given tic.
+ *
+ * @param ind_vehicle The vehicle whose position to compute.
+ * @param tic The tic at which to compute it; usually the current one.
+ * @param x A pointer to a float in the which to store the X position.
+ * @param y A pointer to a float in the which to store the Y position.
+ * @return error_return_t 0 if successful, an error code otherwise.
+ */
+error_return_t vehicle_get_position(vehicle_handle_t ind_vehicle, unsigned int tic, float *x, float *y);
+
+/**
+ * @brief Checks whether a vehicle is currently moving.
+ *
+ * @param ind_vehicle The vehicle to check.
+ * @return error_return_t 1 if the vehicle is moving, 0 if it is stopped, an error code otherwise.
+ */
+error_return_t vehicle_is_moving(vehicle_handle_t ind_vehicle);
+
+/**
+ * @brief Runs every arrival due by a given tic.
+ *
+ * Should be called once every tic, as sim_run_tic does. Only vehicles
+ * that arrive are ever touched; each unloads and loads at its order's
+ * station, then departs towards its next order. Orders to removed stations are skipped; a
+ * vehicle finding no route is reported, with ERR_VEHICLE_STRANDED, and
+ * tries again VEHICLE_RETRY_TICS later.
+ *
+ * @param tic The current tic.
+ */
+void vehicle_run_tic(unsigned int tic);
+
+
+#endif // VEHICLE_H
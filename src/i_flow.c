@@ -0,0 +1,367 @@
+/**
+ * @file i_flow.c
+ * @author Gustavo Rehermann (rehermann6046@gmail.com)
+ * @brief Flow field implementation.
+ * @version added in 0.1
+ * @date 2021-03-16
+ *
+ * @copyright Copyright (c)Gustavo Ramos Rehermann 2021. The MIT License.
+ */
+
+#include "i_flow.h"
+#include "m_util.h"
+
+
+/**
+ * @brief A flow field source.
+ */
+struct _flow_source_t {
+    float x;
+    float y;
+
+    /**
+     * @brief Whether this source slot is in use.
+     */
+    unsigned char active;
+
+    /**
+     * @brief Whether the field of this source is out of date.
+     */
+    unsigned char dirty;
+};
+
+static struct _flow_source_t flow_sources[MAX_FLOW_SOURCES];
+
+/**
+ * @brief The distance from each tile to each source, in tiles.
+ */
+static unsigned short flow_dist[MAX_FLOW_SOURCES][PLACE_GRID_TILES];
+
+/**
+ * @brief The direction from each tile towards each source.
+ *
+ * An index into flow_dir_x and flow_dir_y.
+ */
+static unsigned char flow_dir[MAX_FLOW_SOURCES][PLACE_GRID_TILES];
+
+/**
+ * @brief The nearest source to each tile, or -1 if none is reachable.
+ */
+static signed char flow_nearest[PLACE_GRID_TILES];
+
+/**
+ * @brief Which tiles are blocked.
+ */
+static unsigned char flow_blocked[PLACE_GRID_TILES];
+
+/**
+ * @brief The place grid version the fields were computed for.
+ */
+static unsigned int flow_grid_version = 0;
+
+/**
+ * @brief Whether the combined field is out of date.
+ */
+static unsigned char flow_combined_dirty = 0;
+
+/**
+ * @brief The X step of each direction.
+ *
+ * Direction 0 means staying put; 1, 3, 5 and 7 are orthogonal, and
+ * the rest diagonal.
+ */
+static const int flow_dir_x[9] = { 0, 1, 1, 0, -1, -1, -1, 0, 1 };
+
+/**
+ * @brief The Y step of each direction.
+ */
+static const int flow_dir_y[9] = { 0, 0, 1, 1, 1, 0, -1, -1, -1 };
+
+/**
+ * @brief The breadth-first search queue.
+ */
+static int flow_queue[PLACE_GRID_TILES];
+
+
+static error_return_t _flow_check_source(flow_handle_t source, const char *const ctx) {
+    if (source < 0 || source >= MAX_FLOW_SOURCES || !flow_sources[source].active) {
+        erroric(ERR_FLOW_BAD_SOURCE, ctx);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Whether a tile of the place grid can be entered.
+ *
+ * @param x X coordinate, relative to the place grid.
+ * @param y Y coordinate, relative to the place grid.
+ */
+static int _flow_open(int x, int y) {
+    if (x < 0 || y < 0 || x >= PLACE_GRID_WIDTH || y >= PLACE_GRID_WIDTH) {
+        return 0;
+    }
+
+    return !flow_blocked[y * PLACE_GRID_WIDTH + x];
+}
+
+/**
+ * @brief Marks every tile of a source's field as unreached.
+ */
+static void _flow_clear_field(flow_handle_t source) {
+    int tile;
+
+    for (tile = 0; tile < PLACE_GRID_TILES; tile++) {
+        flow_dist[source][tile] = FLOW_UNREACHED;
+        flow_dir[source][tile] = 0;
+    }
+}
+
+static void _flow_mark_all_dirty(void) {
+    int i;
+
+    for (i = 0; i < MAX_FLOW_SOURCES; i++) {
+        flow_sources[i].dirty = flow_sources[i].active;
+    }
+
+    flow_combined_dirty = 1;
+}
+
+/**
+ * @brief Resets all tiles, if the place grid was moved since last checked.
+ */
+static void _flow_check_grid(void) {
+    flow_handle_t source;
+    int tile;
+
+    if (flow_grid_version == place_grid_version) {
+        return;
+    }
+
+    // every tile now stands somewhere else
+    for (tile = 0; tile < PLACE_GRID_TILES; tile++) {
+        flow_blocked[tile] = 0;
+        flow_nearest[tile] = -1;
+    }
+
+    // and no field may be sampled until it is computed again
+    for (source = 0; source < MAX_FLOW_SOURCES; source++) {
+        if (flow_sources[source].active) {
+            _flow_clear_field(source);
+        }
+    }
+
+    _flow_mark_all_dirty();
+    flow_grid_version = place_grid_version;
+}
+
+flow_handle_t flow_add_source(float x, float y) {
+    flow_handle_t source;
+
+    for (source = 0; source < MAX_FLOW_SOURCES; source++) {
+        if (!flow_sources[source].active) {
+            break;
+        }
+    }
+
+    if (source == MAX_FLOW_SOURCES) {
+        erroric(ERR_FLOW_MAXED_SOURCES, "flow_add_source");
+    }
+
+    _flow_check_grid();
+
+    // the slot may still hold the field of a removed source
+    _flow_clear_field(source);
+
+    flow_sources[source].x = x;
+    flow_sources[source].y = y;
+    flow_sources[source].active = 1;
+    flow_sources[source].dirty = 1;
+
+    flow_combined_dirty = 1;
+
+    return source;
+}
+
+error_return_t flow_remove_source(flow_handle_t source) {
+    errcli(_flow_check_source(source, "flow_remove_source"));
+
+    flow_sources[source].active = 0;
+    flow_sources[source].dirty = 0;
+
+    flow_combined_dirty = 1;
+
+    return 0;
+}
+
+void flow_set_blocked(int tile_x, int tile_y, int blocked) {
+    const int tile = place_grid_tile_index(tile_x, tile_y);
+
+    _flow_check_grid();
+
+    if (tile == -1 || flow_blocked[tile] == (blocked != 0)) {
+        return;
+    }
+
+    flow_blocked[tile] = blocked != 0;
+
+    // any field may now take a different way
+    _flow_mark_all_dirty();
+}
+
+/**
+ * @brief Computes the field of a single source.
+ */
+static void _flow_compute(flow_handle_t source) {
+    unsigned short *const dist = flow_dist[source];
+    unsigned char *const dir = flow_dir[source];
+
+    const int start = place_grid_index(flow_sources[source].x, flow_sources[source].y);
+    int head = 0, tail = 0;
+    int tile, x, y, nx, ny, next, d, best;
+
+    _flow_clear_field(source);
+
+    if (start == -1 || flow_blocked[start]) {
+        return;
+    }
+
+    // breadth-first search outwards from the source, orthogonally
+    dist[start] = 0;
+    flow_queue[tail++] = start;
+
+    while (head < tail) {
+        tile = flow_queue[head++];
+        x = tile % PLACE_GRID_WIDTH;
+        y = tile / PLACE_GRID_WIDTH;
+
+        for (d = 1; d < 9; d += 2) {
+            nx = x + flow_dir_x[d];
+            ny = y + flow_dir_y[d];
+            next = ny * PLACE_GRID_WIDTH + nx;
+
+            if (_flow_open(nx, ny) && dist[next] == FLOW_UNREACHED) {
+                dist[next] = dist[tile] + 1;
+                flow_queue[tail++] = next;
+            }
+        }
+    }
+
+    // point every reached tile towards its closest neighbour; diagonal
+    // steps skip two orthogonal ones, but may not cut blocked corners
+    for (head = 1; head < tail; head++) {
+        tile = flow_queue[head];
+        x = tile % PLACE_GRID_WIDTH;
+        y = tile / PLACE_GRID_WIDTH;
+        best = dist[tile];
+
+        for (d = 1; d < 9; d++) {
+            nx = x + flow_dir_x[d];
+            ny = y + flow_dir_y[d];
+
+            if (!_flow_open(nx, ny)) {
+                continue;
+            }
+
+            if ((d & 1) == 0 && (!_flow_open(nx, y) || !_flow_open(x, ny))) {
+                continue;
+            }
+
+            next = ny * PLACE_GRID_WIDTH + nx;
+
+            if (dist[next] < best) {
+                best = dist[next];
+                dir[tile] = d;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Recomputes which source is nearest to each tile.
+ */
+static void _flow_combine(void) {
+    int tile, source, best;
+
+    for (tile = 0; tile < PLACE_GRID_TILES; tile++) {
+        flow_nearest[tile] = -1;
+        best = FLOW_UNREACHED;
+
+        for (source = 0; source < MAX_FLOW_SOURCES; source++) {
+            if (flow_sources[source].active && flow_dist[source][tile] < best) {
+                best = flow_dist[source][tile];
+                flow_nearest[tile] = source;
+            }
+        }
+    }
+
+    flow_combined_dirty = 0;
+}
+
+void flow_update(void) {
+    flow_handle_t source;
+
+    _flow_check_grid();
+
+    for (source = 0; source < MAX_FLOW_SOURCES; source++) {
+        if (flow_sources[source].dirty) {
+            _flow_compute(source);
+            flow_sources[source].dirty = 0;
+        }
+    }
+
+    if (flow_combined_dirty) {
+        _flow_combine();
+    }
+}
+
+flow_handle_t flow_sample(float x, float y, int *dx, int *dy) {
+    flow_handle_t source;
+    int tile;
+
+    _flow_check_grid();
+
+    tile = place_grid_index(x, y);
+
+    *dx = 0;
+    *dy = 0;
+
+    if (tile == -1 || flow_nearest[tile] == -1) {
+        return -1;
+    }
+
+    source = flow_nearest[tile];
+
+    if (!flow_sources[source].active || flow_dist[source][tile] == FLOW_UNREACHED) {
+        // removed since the last flow_update, and maybe already
+        // replaced by a new source whose field is not computed yet
+        return -1;
+    }
+
+    *dx = flow_dir_x[flow_dir[source][tile]];
+    *dy = flow_dir_y[flow_dir[source][tile]];
+
+    return source;
+}
+
+error_return_t flow_sample_source(flow_handle_t source, float x, float y, int *dx, int *dy) {
+    int tile;
+
+    errcli(_flow_check_source(source, "flow_sample_source"));
+
+    _flow_check_grid();
+
+    tile = place_grid_index(x, y);
+
+    *dx = 0;
+    *dy = 0;
+
+    if (tile == -1 || flow_dist[source][tile] == FLOW_UNREACHED) {
+        return 0;
+    }
+
+    *dx = flow_dir_x[flow_dir[source][tile]];
+    *dy = flow_dir_y[flow_dir[source][tile]];
+
+    return 1;
+}
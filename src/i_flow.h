@@ -0,0 +1,118 @@
+/**
+ * @file i_flow.h
+ * @author Gustavo Rehermann (rehermann6046@gmail.com)
+ * @brief Flow fields for funneling monsters.
+ * @version added in 0.1
+ * @date 2021-03-16
+ *
+ * Monsters are funneled towards death traps by flow fields, rather
+ * than by pathing each monster on its own.
+ *
+ * Every flow field source, such as a trap, has a field laid over the
+ * place grid, telling in which direction to go from each tile to get
+ * closer to it. A field is computed with a single breadth-first
+ * search, and only recomputed when its source moves, or tiles are
+ * blocked or unblocked. A combined field, pointing towards whichever
+ * source is nearest, is kept alongside.
+ *
+ * Any monster can then sample its steering direction in O(1), so the
+ * cost of funneling is independent of the number of monsters.
+ *
+ * @copyright Copyright (c)Gustavo Ramos Rehermann 2021. The MIT License.
+ */
+
+#ifndef FLOW_H
+#define FLOW_H
+
+#include "m_error.h"
+#include "i_place.h"
+
+
+/**
+ * @brief The max number of flow field sources.
+ */
+#define MAX_FLOW_SOURCES 16
+
+/**
+ * @brief The distance of tiles that cannot reach a flow field source.
+ */
+#define FLOW_UNREACHED 0xFFFF
+
+
+/**
+ * @brief An index handle to a flow field source.
+ *
+ * Negative values are error codes, rather than valid handles.
+ */
+typedef int flow_handle_t;
+
+/**
+ * @brief Adds a flow field source.
+ *
+ * Its field is computed on the next call to flow_update.
+ *
+ * @param x X location of the source in the world.
+ * @param y Y location of the source in the world.
+ * @return flow_handle_t The handle to the source, or a negative error code.
+ */
+flow_handle_t flow_add_source(float x, float y);
+
+/**
+ * @brief Removes a flow field source.
+ *
+ * @param source The handle to the source.
+ * @return error_return_t 0 if successful, an error code otherwise.
+ */
+error_return_t flow_remove_source(flow_handle_t source);
+
+/**
+ * @brief Blocks or unblocks a tile for all flow fields.
+ *
+ * Blocked tiles can neither be entered nor crossed by the fields. All
+ * tiles are unblocked again if the place grid is moved, so tiles should
+ * only be blocked after place_grid_fit.
+ *
+ * @param tile_x X coordinate of the tile.
+ * @param tile_y Y coordinate of the tile.
+ * @param blocked 1 to block the tile, 0 to unblock it.
+ */
+void flow_set_blocked(int tile_x, int tile_y, int blocked);
+
+/**
+ * @brief Recomputes every flow field that is out of date.
+ *
+ * Cheap when nothing changed; may be called once every tic.
+ */
+void flow_update(void);
+
+/**
+ * @brief Samples the direction towards the nearest source.
+ *
+ * Fields are only computed by flow_update; until then, new sources,
+ * and every source once the place grid has moved, cannot be reached.
+ *
+ * @param x X location in the world.
+ * @param y Y location in the world.
+ * @param dx A pointer to an int in the which to store the X direction (-1, 0 or 1).
+ * @param dy A pointer to an int in the which to store the Y direction (-1, 0 or 1).
+ * @return flow_handle_t The nearest source, or -1 if none can be reached from here.
+ */
+flow_handle_t flow_sample(float x, float y, int *dx, int *dy);
+
+/**
+ * @brief Samples the direction towards a specific source.
+ *
+ * As with flow_sample, the source cannot be reached until its field is
+ * computed by flow_update.
+ *
+ * @param source The handle to the source.
+ * @param x X location in the world.
+ * @param y Y location in the world.
+ * @param dx A pointer to an int in the which to store the X direction (-1, 0 or 1).
+ * @param dy A pointer to an int in the which to store the Y direction (-1, 0 or 1).
+ * @return error_return_t 1 if the source can be reached from here, 0 if not, an error code otherwise.
+ */
+error_return_t flow_sample_source(flow_handle_t source, float x, float y, int *dx, int *dy);
+
+
+#endif // FLOW_H
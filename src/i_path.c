@@ -0,0 +1,811 @@
+/**
+ * @file i_path.c
+ * @author Gustavo Rehermann (rehermann6046@gmail.com)
+ * @brief Waypoint graph pathfinding implementation.
+ * @version added in 0.1
+ * @date 2021-03-14
+ *
+ * @copyright Copyright (c)Gustavo Ramos Rehermann 2021. The MIT License.
+ */
+
+#include <limits.h>
+
+#include "i_path.h"
+#include "m_util.h"
+
+
+/**
+ * @brief The spots each spot is linked to.
+ */
+static spot_index_t path_links[MAX_SPOTS][MAX_SPOT_LINKS];
+
+/**
+ * @brief The length of each link in path_links, in map units.
+ */
+static int path_link_costs[MAX_SPOTS][MAX_SPOT_LINKS];
+
+/**
+ * @brief The number of links of each spot.
+ */
+static int path_num_links[MAX_SPOTS];
+
+unsigned int path_graph_version = 0;
+
+static struct path_route_t path_routes[MAX_CACHED_ROUTES];
+static int path_num_routes = 0;
+
+/**
+ * @brief A counter bumped on every route lookup, for LRU eviction.
+ */
+static unsigned int path_lookup_clock = 0;
+
+
+// -- Hierarchy
+
+/**
+ * @brief The spotmap tile each spot lies in, along the X axis.
+ *
+ * Every spotmap tile is a cluster of the hierarchical pathfinder.
+ */
+static int path_tile_x[MAX_SPOTS];
+
+/**
+ * @brief The spotmap tile each spot lies in, along the Y axis.
+ */
+static int path_tile_y[MAX_SPOTS];
+
+/**
+ * @brief Whether each spot is an entrance.
+ *
+ * Entrances are spots linked to at least one spot in another tile.
+ * Only entrances are part of the top level of the hierarchy.
+ */
+static unsigned char path_is_entrance[MAX_SPOTS];
+
+/**
+ * @brief The entrances each entrance is linked to, at the top level.
+ *
+ * Both entrances of other tiles linked directly, and entrances of the
+ * same tile reachable without leaving it.
+ */
+static spot_index_t path_entrance_links[MAX_SPOTS][MAX_ENTRANCE_LINKS];
+
+/**
+ * @brief The length of each link in path_entrance_links, in map units.
+ */
+static int path_entrance_costs[MAX_SPOTS][MAX_ENTRANCE_LINKS];
+
+/**
+ * @brief The number of top level links of each entrance.
+ */
+static int path_num_entrance_links[MAX_SPOTS];
+
+/**
+ * @brief The graph version the hierarchy was last built for.
+ */
+static unsigned int path_hier_version;
+
+/**
+ * @brief The number of spots the hierarchy was last built for.
+ */
+static size_t path_hier_num_spots = 0;
+
+/**
+ * @brief Whether any entrance had more top level links than fit.
+ *
+ * The top level then misses some of them, and could miss routes; every
+ * search falls back to the whole waypoint graph until it is rebuilt
+ * without overflowing.
+ */
+static int path_hier_saturated = 0;
+
+
+// -- Search state
+
+/**
+ * @brief An item of the open set.
+ */
+struct _path_open_t {
+    int f;
+
+    /**
+     * @brief The spot, or MAX_SPOTS past an entrance to leave the top level at.
+     *
+     * A full int, since the latter does not fit in a spot_index_t.
+     */
+    int spot;
+};
+
+/**
+ * @brief The open set, as a binary min-heap.
+ *
+ * Items are never decreased in place; an improved spot is pushed
+ * again instead, and stale items are skipped once popped. Every
+ * directed link can thus be pushed at most once per search.
+ */
+static struct _path_open_t path_open[MAX_SPOTS * (MAX_ENTRANCE_LINKS + 2) + 1];
+static int path_num_open;
+
+static int path_g[MAX_SPOTS];
+static spot_index_t path_parent[MAX_SPOTS];
+
+/**
+ * @brief The search in which each spot was last reached.
+ *
+ * Compared against path_search_id instead of clearing every array
+ * before each search.
+ */
+static unsigned int path_seen[MAX_SPOTS];
+
+/**
+ * @brief The search in which each spot was last closed.
+ */
+static unsigned int path_closed[MAX_SPOTS];
+
+static unsigned int path_search_id = 0;
+
+/**
+ * @brief Stands for no tile in particular, so that a search is not
+ * confined at all.
+ */
+#define PATH_ANY_TILE INT_MIN
+
+/**
+ * @brief Every spot closed in the last local search, in order.
+ */
+static spot_index_t path_visited[MAX_SPOTS];
+static int path_num_visited;
+
+/**
+ * @brief The local distance from each goal tile entrance to the goal.
+ */
+static int path_goal_cost[MAX_SPOTS];
+
+/**
+ * @brief The query in which each spot was last a goal tile entrance.
+ */
+static unsigned int path_goal_seen[MAX_SPOTS];
+
+/**
+ * @brief Start tile entrances of the current query.
+ */
+static spot_index_t path_start_entrances[MAX_SPOTS];
+
+/**
+ * @brief The local distance from the start to each start tile entrance.
+ */
+static int path_start_costs[MAX_SPOTS];
+
+/**
+ * @brief Entrances along the top level route of the current query.
+ */
+static spot_index_t path_abstract[MAX_ROUTE_NODES];
+
+
+static error_return_t _path_check_spot(spot_handle_t ind_spot, const char *const ctx) {
+    if (ind_spot >= place_num_spots) {
+        erroric(ERR_PLACE_BAD_SPOT_INDEX, ctx);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief The straight-line distance between two spots, in map units.
+ *
+ * Only used when linking, so that searches never need a square root.
+ */
+static int _path_spot_distance(spot_handle_t spot_a, spot_handle_t spot_b) {
+    return dist_exact((int) (place_spots[spot_a].x - place_spots[spot_b].x), (int) (place_spots[spot_a].y - place_spots[spot_b].y));
+}
+
+/**
+ * @brief The A* heuristic between two spots.
+ *
+ * The larger of both axis distances; never more than the straight-line
+ * distance, so the heuristic is admissible.
+ */
+static int _path_heuristic(spot_handle_t spot_a, spot_handle_t spot_b) {
+    int dx = (int) (place_spots[spot_a].x - place_spots[spot_b].x);
+    int dy = (int) (place_spots[spot_a].y - place_spots[spot_b].y);
+
+    if (dx < 0) dx = -dx;
+    if (dy < 0) dy = -dy;
+
+    return dx > dy ? dx : dy;
+}
+
+static error_return_t _path_add_link(spot_handle_t from, spot_handle_t to, int cost) {
+    int i;
+
+    for (i = 0; i < path_num_links[from]; i++) {
+        if (path_links[from][i] == to) {
+            // already linked
+            path_link_costs[from][i] = cost;
+            return 0;
+        }
+    }
+
+    if (path_num_links[from] >= MAX_SPOT_LINKS) {
+        erroric(ERR_PATH_MAXED_LINKS, "path_link");
+    }
+
+    path_links[from][path_num_links[from]] = to;
+    path_link_costs[from][path_num_links[from]] = cost;
+    path_num_links[from]++;
+
+    return 0;
+}
+
+static void _path_remove_link(spot_handle_t from, spot_handle_t to) {
+    int i;
+
+    for (i = 0; i < path_num_links[from]; i++) {
+        if (path_links[from][i] == to) {
+            // swap the last link into its place
+            path_num_links[from]--;
+            path_links[from][i] = path_links[from][path_num_links[from]];
+            path_link_costs[from][i] = path_link_costs[from][path_num_links[from]];
+            return;
+        }
+    }
+}
+
+error_return_t path_link(spot_handle_t spot_a, spot_handle_t spot_b) {
+    int cost;
+
+    errcli(_path_check_spot(spot_a, "path_link"));
+    errcli(_path_check_spot(spot_b, "path_link"));
+
+    if (path_num_links[spot_a] >= MAX_SPOT_LINKS || path_num_links[spot_b] >= MAX_SPOT_LINKS) {
+        erroric(ERR_PATH_MAXED_LINKS, "path_link");
+    }
+
+    cost = _path_spot_distance(spot_a, spot_b);
+
+    errcli(_path_add_link(spot_a, spot_b, cost));
+    errcli(_path_add_link(spot_b, spot_a, cost));
+
+    path_graph_version++;
+
+    return 0;
+}
+
+error_return_t path_unlink(spot_handle_t spot_a, spot_handle_t spot_b) {
+    errcli(_path_check_spot(spot_a, "path_unlink"));
+    errcli(_path_check_spot(spot_b, "path_unlink"));
+
+    _path_remove_link(spot_a, spot_b);
+    _path_remove_link(spot_b, spot_a);
+
+    path_graph_version++;
+
+    return 0;
+}
+
+static void _path_open_push(int f, spot_handle_t spot) {
+    int i = path_num_open++;
+
+    // sift up
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+
+        if (path_open[parent].f <= f) {
+            break;
+        }
+
+        path_open[i] = path_open[parent];
+        i = parent;
+    }
+
+    path_open[i].f = f;
+    path_open[i].spot = spot;
+}
+
+static spot_handle_t _path_open_pop(void) {
+    const spot_handle_t top = path_open[0].spot;
+    const struct _path_open_t last = path_open[--path_num_open];
+    int i = 0;
+
+    // sift down
+    while (1) {
+        int child = i * 2 + 1;
+
+        if (child >= path_num_open) {
+            break;
+        }
+
+        if (child + 1 < path_num_open && path_open[child + 1].f < path_open[child].f) {
+            child++;
+        }
+
+        if (last.f <= path_open[child].f) {
+            break;
+        }
+
+        path_open[i] = path_open[child];
+        i = child;
+    }
+
+    path_open[i] = last;
+
+    return top;
+}
+
+/**
+ * @brief Runs a search confined to a single spotmap tile.
+ *
+ * A* if a target spot is passed; otherwise, a plain Dijkstra search
+ * that reaches every spot of the tile it can. Either way, every spot
+ * closed is listed in path_visited.
+ *
+ * @param from The spot to start searching from.
+ * @param to The spot to search a route to, or PATH_NO_TARGET.
+ * @param tile_x The X coordinate of the tile to confine the search to,
+ * or PATH_ANY_TILE to search the whole graph.
+ * @param tile_y The Y coordinate of the tile to confine the search to.
+ * @return int 1 if 'to' was reached, else 0.
+ */
+static int _path_local_search(spot_handle_t from, spot_handle_t to, int tile_x, int tile_y) {
+    spot_handle_t spot, next;
+    int i, g;
+
+    path_search_id++;
+    path_num_open = 0;
+    path_num_visited = 0;
+
+    path_g[from] = 0;
+    path_parent[from] = from;
+    path_seen[from] = path_search_id;
+    _path_open_push(to == PATH_NO_TARGET ? 0 : _path_heuristic(from, to), from);
+
+    while (path_num_open > 0) {
+        spot = _path_open_pop();
+
+        if (path_closed[spot] == path_search_id) {
+            // stale item
+            continue;
+        }
+
+        path_closed[spot] = path_search_id;
+        path_visited[path_num_visited++] = spot;
+
+        if (spot == to) {
+            return 1;
+        }
+
+        for (i = 0; i < path_num_links[spot]; i++) {
+            next = path_links[spot][i];
+            g = path_g[spot] + path_link_costs[spot][i];
+
+            if (tile_x != PATH_ANY_TILE && (path_tile_x[next] != tile_x || path_tile_y[next] != tile_y)) {
+                continue;
+            }
+
+            if (path_closed[next] == path_search_id) {
+                continue;
+            }
+
+            if (path_seen[next] == path_search_id && path_g[next] <= g) {
+                continue;
+            }
+
+            path_g[next] = g;
+            path_parent[next] = spot;
+            path_seen[next] = path_search_id;
+
+            _path_open_push(g + (to == PATH_NO_TARGET ? 0 : _path_heuristic(next, to)), next);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Appends the result of the last local search to a route.
+ *
+ * The route must already end at 'from'.
+ */
+static error_return_t _path_append_search(struct path_route_t *route, spot_handle_t from, spot_handle_t to) {
+    const int base = route->dist[route->num_nodes - 1];
+    spot_handle_t spot;
+    int i, steps = 0;
+
+    for (spot = to; spot != from; spot = path_parent[spot]) {
+        steps++;
+    }
+
+    if (route->num_nodes + steps > MAX_ROUTE_NODES) {
+        erroric(ERR_PATH_TOO_LONG, "path_find");
+    }
+
+    // fill in back to front
+    for (spot = to, i = route->num_nodes + steps - 1; spot != from; spot = path_parent[spot], i--) {
+        route->nodes[i] = spot;
+        route->dist[i] = base + path_g[spot];
+    }
+
+    route->num_nodes += steps;
+
+    return 0;
+}
+
+static error_return_t _path_add_entrance_link(spot_handle_t from, spot_handle_t to, int cost) {
+    int i;
+
+    for (i = 0; i < path_num_entrance_links[from]; i++) {
+        if (path_entrance_links[from][i] == to) {
+            if (cost < path_entrance_costs[from][i]) {
+                path_entrance_costs[from][i] = cost;
+            }
+
+            return 0;
+        }
+    }
+
+    if (path_num_entrance_links[from] >= MAX_ENTRANCE_LINKS) {
+        // the top level would miss this link, and possibly a route
+        codei(ERR_PATH_MAXED_LINKS);
+    }
+
+    path_entrance_links[from][path_num_entrance_links[from]] = to;
+    path_entrance_costs[from][path_num_entrance_links[from]] = cost;
+    path_num_entrance_links[from]++;
+
+    return 0;
+}
+
+void path_build_hierarchy(void) {
+    spot_handle_t spot, other;
+    int i;
+
+    // assign each spot to its tile
+    for (spot = 0; spot < place_num_spots; spot++) {
+        path_tile_x[spot] = floordiv(place_spots[spot].x, SPOT_TILE_WIDTH);
+        path_tile_y[spot] = floordiv(place_spots[spot].y, SPOT_TILE_WIDTH);
+    }
+
+    // find entrances, and link those of neighbouring tiles directly
+    for (spot = 0; spot < place_num_spots; spot++) {
+        path_is_entrance[spot] = 0;
+        path_num_entrance_links[spot] = 0;
+    }
+
+    path_hier_saturated = 0;
+
+    for (spot = 0; spot < place_num_spots; spot++) {
+        for (i = 0; i < path_num_links[spot]; i++) {
+            other = path_links[spot][i];
+
+            if (path_tile_x[other] != path_tile_x[spot] || path_tile_y[other] != path_tile_y[spot]) {
+                path_is_entrance[spot] = 1;
+
+                if (_path_add_entrance_link(spot, other, path_link_costs[spot][i]) < 0) {
+                    path_hier_saturated = 1;
+                }
+            }
+        }
+    }
+
+    // link entrances within the same tile, by their local distance
+    for (spot = 0; spot < place_num_spots; spot++) {
+        if (!path_is_entrance[spot]) {
+            continue;
+        }
+
+        _path_local_search(spot, PATH_NO_TARGET, path_tile_x[spot], path_tile_y[spot]);
+
+        for (i = 1; i < path_num_visited; i++) {
+            other = path_visited[i];
+
+            if (path_is_entrance[other] && _path_add_entrance_link(spot, other, path_g[other]) < 0) {
+                path_hier_saturated = 1;
+            }
+        }
+    }
+
+    path_hier_version = path_graph_version;
+    path_hier_num_spots = place_num_spots;
+
+    if (path_hier_saturated) {
+        errorvc(ERR_PATH_MAXED_LINKS, "path_build_hierarchy");
+    }
+}
+
+/**
+ * @brief Searches the top level of the hierarchy.
+ *
+ * Starts from every start tile entrance at once, and finishes at
+ * whichever goal tile entrance yields the shortest total route.
+ *
+ * @param num_starts The number of items in path_start_entrances.
+ * @param goal_id The query id stamped on goal tile entrances.
+ * @param to The goal spot.
+ * @return int The number of entrances in path_abstract, or a negative error code.
+ */
+static int _path_abstract_search(int num_starts, unsigned int goal_id, spot_handle_t to) {
+    spot_handle_t spot, next, exit = PATH_NO_TARGET;
+    int i, g, num_abstract;
+
+    path_search_id++;
+    path_num_open = 0;
+
+    for (i = 0; i < num_starts; i++) {
+        spot = path_start_entrances[i];
+
+        path_g[spot] = path_start_costs[i];
+        path_parent[spot] = spot;
+        path_seen[spot] = path_search_id;
+        _path_open_push(path_g[spot] + _path_heuristic(spot, to), spot);
+    }
+
+    while (path_num_open > 0) {
+        spot = _path_open_pop();
+
+        if (spot >= MAX_SPOTS) {
+            // the cheapest complete route; spots past MAX_SPOTS stand
+            // for leaving the top level at entrance (spot - MAX_SPOTS)
+            exit = spot - MAX_SPOTS;
+            break;
+        }
+
+        if (path_closed[spot] == path_search_id) {
+            // stale item
+            continue;
+        }
+
+        path_closed[spot] = path_search_id;
+
+        if (path_goal_seen[spot] == goal_id) {
+            _path_open_push(path_g[spot] + path_goal_cost[spot], MAX_SPOTS + spot);
+        }
+
+        for (i = 0; i < path_num_entrance_links[spot]; i++) {
+            next = path_entrance_links[spot][i];
+            g = path_g[spot] + path_entrance_costs[spot][i];
+
+            if (path_closed[next] == path_search_id) {
+                continue;
+            }
+
+            if (path_seen[next] == path_search_id && path_g[next] <= g) {
+                continue;
+            }
+
+            path_g[next] = g;
+            path_parent[next] = spot;
+            path_seen[next] = path_search_id;
+
+            _path_open_push(g + _path_heuristic(next, to), next);
+        }
+    }
+
+    if (exit == PATH_NO_TARGET) {
+        codei(ERR_PATH_NO_ROUTE);
+    }
+
+    num_abstract = 1;
+
+    for (spot = exit; path_parent[spot] != spot; spot = path_parent[spot]) {
+        num_abstract++;
+    }
+
+    if (num_abstract > MAX_ROUTE_NODES) {
+        erroric(ERR_PATH_TOO_LONG, "path_find");
+    }
+
+    for (spot = exit, i = num_abstract - 1; i >= 0; spot = path_parent[spot], i--) {
+        path_abstract[i] = spot;
+    }
+
+    return num_abstract;
+}
+
+/**
+ * @brief Extends a route ending at 'from' up to 'to'.
+ *
+ * Both spots must either be in the same tile, or linked directly.
+ */
+static error_return_t _path_refine(struct path_route_t *route, spot_handle_t from, spot_handle_t to) {
+    int i;
+
+    if (from == to) {
+        return 0;
+    }
+
+    if (path_tile_x[from] != path_tile_x[to] || path_tile_y[from] != path_tile_y[to]) {
+        if (route->num_nodes >= MAX_ROUTE_NODES) {
+            erroric(ERR_PATH_TOO_LONG, "path_find");
+        }
+
+        for (i = 0; path_links[from][i] != to; i++);
+
+        route->nodes[route->num_nodes] = to;
+        route->dist[route->num_nodes] = route->dist[route->num_nodes - 1] + path_link_costs[from][i];
+        route->num_nodes++;
+
+        return 0;
+    }
+
+    _path_local_search(from, to, path_tile_x[from], path_tile_y[from]);
+
+    return _path_append_search(route, from, to);
+}
+
+/**
+ * @brief Finds a route with the hierarchical pathfinder.
+ *
+ * Only the start and goal tiles are ever searched spot by spot; the
+ * rest of the route is found at the top level, between entrances, and
+ * then refined one tile at a time.
+ *
+ * @param from The spot to start the route from.
+ * @param to The spot to end the route at.
+ * @param route The route to store the result into.
+ */
+static error_return_t _path_search(spot_handle_t from, spot_handle_t to, struct path_route_t *route) {
+    unsigned int goal_id;
+    int i, num_starts, num_abstract;
+
+    if (path_hier_version != path_graph_version || path_hier_num_spots != place_num_spots) {
+        path_build_hierarchy();
+    }
+
+    route->nodes[0] = from;
+    route->dist[0] = 0;
+    route->num_nodes = 1;
+
+    if (path_hier_saturated) {
+        // the top level is incomplete; search every waypoint instead
+        if (!_path_local_search(from, to, PATH_ANY_TILE, 0)) {
+            codei(ERR_PATH_NO_ROUTE);
+        }
+
+        return _path_append_search(route, from, to);
+    }
+
+    // try staying within the tile first
+    if (path_tile_x[from] == path_tile_x[to] && path_tile_y[from] == path_tile_y[to]) {
+        if (_path_local_search(from, to, path_tile_x[from], path_tile_y[from])) {
+            return _path_append_search(route, from, to);
+        }
+    }
+
+    // reach every entrance of the goal tile from the goal; links are
+    // bidirectional, so these are also the distances towards the goal
+    _path_local_search(to, PATH_NO_TARGET, path_tile_x[to], path_tile_y[to]);
+    goal_id = path_search_id;
+
+    for (i = 0; i < path_num_visited; i++) {
+        if (path_is_entrance[path_visited[i]]) {
+            path_goal_cost[path_visited[i]] = path_g[path_visited[i]];
+            path_goal_seen[path_visited[i]] = goal_id;
+        }
+    }
+
+    // reach every entrance of the start tile from the start
+    _path_local_search(from, PATH_NO_TARGET, path_tile_x[from], path_tile_y[from]);
+    num_starts = 0;
+
+    for (i = 0; i < path_num_visited; i++) {
+        if (path_is_entrance[path_visited[i]]) {
+            path_start_entrances[num_starts] = path_visited[i];
+            path_start_costs[num_starts] = path_g[path_visited[i]];
+            num_starts++;
+        }
+    }
+
+    errcli(num_abstract = _path_abstract_search(num_starts, goal_id, to));
+
+    // refine the top level route into waypoints
+    errcli(_path_refine(route, from, path_abstract[0]));
+
+    for (i = 1; i < num_abstract; i++) {
+        errcli(_path_refine(route, path_abstract[i - 1], path_abstract[i]));
+    }
+
+    errcli(_path_refine(route, path_abstract[num_abstract - 1], to));
+
+    return 0;
+}
+
+/**
+ * @brief Picks a cache slot for a new route.
+ *
+ * An unused slot if there is any left, else the least recently used
+ * route that is not held.
+ */
+static route_handle_t _path_pick_slot(void) {
+    route_handle_t best = -1;
+    int i;
+
+    if (path_num_routes < MAX_CACHED_ROUTES) {
+        return path_num_routes++;
+    }
+
+    for (i = 0; i < MAX_CACHED_ROUTES; i++) {
+        if (path_routes[i].holds > 0) {
+            continue;
+        }
+
+        if (best == -1 || path_routes[i].last_used < path_routes[best].last_used) {
+            best = i;
+        }
+    }
+
+    if (best == -1) {
+        erroric(ERR_PATH_CACHE_FULL, "path_find");
+    }
+
+    return best;
+}
+
+route_handle_t path_find(spot_handle_t from, spot_handle_t to) {
+    struct path_route_t *route;
+    route_handle_t slot;
+    int i;
+
+    errcli(_path_check_spot(from, "path_find"));
+    errcli(_path_check_spot(to, "path_find"));
+
+    path_lookup_clock++;
+
+    // look for an up-to-date cached route first
+    for (i = 0; i < path_num_routes; i++) {
+        route = &path_routes[i];
+
+        if (route->from == from && route->to == to && route->version == path_graph_version) {
+            route->last_used = path_lookup_clock;
+            return i;
+        }
+    }
+
+    errcli(slot = _path_pick_slot());
+
+    route = &path_routes[slot];
+
+    // invalidate the slot until the search succeeds
+    route->version = path_graph_version - 1;
+    route->holds = 0;
+
+    errcli(_path_search(from, to, route));
+
+    route->from = from;
+    route->to = to;
+    route->version = path_graph_version;
+    route->last_used = path_lookup_clock;
+
+    return slot;
+}
+
+static error_return_t _path_check_route(route_handle_t route, const char *const ctx) {
+    if (route < 0 || route >= path_num_routes) {
+        erroric(ERR_PATH_BAD_ROUTE, ctx);
+    }
+
+    return 0;
+}
+
+const struct path_route_t *path_get_route(route_handle_t route) {
+    errcla(_path_check_route(route, "path_get_route"), NULL);
+
+    return &path_routes[route];
+}
+
+error_return_t path_hold(route_handle_t route) {
+    errcli(_path_check_route(route, "path_hold"));
+
+    path_routes[route].holds++;
+
+    return 0;
+}
+
+error_return_t path_release(route_handle_t route) {
+    errcli(_path_check_route(route, "path_release"));
+
+    if (path_routes[route].holds > 0) {
+        path_routes[route].holds--;
+    }
+
+    return 0;
+}
@@ -0,0 +1,228 @@
+/**
+ * @file i_path.h
+ * @author Gustavo Rehermann (rehermann6046@gmail.com)
+ * @brief Waypoint graph pathfinding.
+ * @version added in 0.1
+ * @date 2021-03-14
+ *
+ * Spots double as waypoints for vehicles. Two spots can be linked
+ * together, meaning a vehicle can travel between them in a straight
+ * line; the resulting graph is searched with A* whenever a vehicle
+ * needs a route between two spots.
+ *
+ * Searching on the ACS VM is far from cheap, so every route found is
+ * kept in a small, fixed-size route cache. Vehicles travelling between
+ * the same pair of spots share a single cached route, instead of each
+ * running its own search. Any change to the graph bumps its version,
+ * which invalidates every route cached before it.
+ *
+ * Searches are hierarchical, using spotmap tiles as clusters. Spots
+ * linked to another tile are 'entrances'; the distances between the
+ * entrances of each tile are precomputed, so that a route is first
+ * found between entrances alone, and only the start and goal tiles
+ * are searched spot by spot. A query thus scales with the length of
+ * the route in tiles, rather than with the number of waypoints.
+ *
+ * @copyright Copyright (c)Gustavo Ramos Rehermann 2021. The MIT License.
+ */
+
+#ifndef PATH_H
+#define PATH_H
+
+#include <stddef.h>
+
+#include "m_error.h"
+#include "i_place.h"
+
+
+/**
+ * @brief The max number of waypoint links a single spot can have.
+ */
+#define MAX_SPOT_LINKS 6
+
+/**
+ * @brief The max number of top level links a single entrance can have.
+ *
+ * Includes both the links to entrances of other tiles, and to the
+ * other entrances of its own tile.
+ */
+#define MAX_ENTRANCE_LINKS 16
+
+/**
+ * @brief The max number of waypoints in a single route.
+ */
+#define MAX_ROUTE_NODES 64
+
+/**
+ * @brief The number of routes that can be kept in the route cache.
+ *
+ * Every moving vehicle holds its route until it arrives, so there must
+ * be more slots than MAX_VEHICLES (as checked in h_vehicle.h); the rest
+ * keep routes around for reuse.
+ */
+#ifndef MAX_CACHED_ROUTES
+#define MAX_CACHED_ROUTES 288
+#endif
+
+/**
+ * @brief Denotes the lack of a target spot in a search.
+ */
+#define PATH_NO_TARGET ((spot_handle_t) -1)
+
+
+/**
+ * @brief A route between two spots.
+ *
+ * A route is a sequence of linked waypoints, from a starting spot to
+ * a destination spot, as found by the pathfinder.
+ */
+struct path_route_t {
+    /**
+     * @brief The spot this route starts from.
+     */
+    spot_index_t from;
+
+    /**
+     * @brief The spot this route leads to.
+     */
+    spot_index_t to;
+
+    /**
+     * @brief All waypoints of this route, in order.
+     *
+     * The first item is always 'from', and the last one always 'to'.
+     *
+     * @note Only items up to (num_nodes - 1) should be iterated.
+     */
+    spot_index_t nodes[MAX_ROUTE_NODES];
+
+    /**
+     * @brief The distance travelled up to each waypoint.
+     *
+     * The distance, in map units, from the start of this route to
+     * each corresponding item of 'nodes'. The last item is thus the
+     * total length of the route.
+     */
+    int dist[MAX_ROUTE_NODES];
+
+    /**
+     * @brief The number of waypoints in this route.
+     */
+    int num_nodes;
+
+    /**
+     * @brief The graph version this route was found in.
+     *
+     * @see path_graph_version
+     */
+    unsigned int version;
+
+    /**
+     * @brief When this route was last looked up.
+     *
+     * Used to pick the least recently used route for eviction.
+     */
+    unsigned int last_used;
+
+    /**
+     * @brief The number of holds on this route.
+     *
+     * Held routes are never evicted from the cache, even if stale,
+     * so that vehicles already travelling on them are unaffected.
+     */
+    int holds;
+};
+
+/**
+ * @brief An index handle to a cached route.
+ *
+ * Negative values are error codes, rather than valid handles.
+ */
+typedef int route_handle_t;
+
+/**
+ * @brief The current version of the waypoint graph.
+ *
+ * Bumped every time a waypoint link is added or removed.
+ */
+extern unsigned int path_graph_version;
+
+/**
+ * @brief Links two spots together as waypoints.
+ *
+ * Links are bidirectional.
+ *
+ * @param spot_a The opaque handle index to the first spot.
+ * @param spot_b The opaque handle index to the second spot.
+ * @return error_return_t 0 if successful, an error code otherwise.
+ */
+error_return_t path_link(spot_handle_t spot_a, spot_handle_t spot_b);
+
+/**
+ * @brief Removes the waypoint link between two spots.
+ *
+ * @param spot_a The opaque handle index to the first spot.
+ * @param spot_b The opaque handle index to the second spot.
+ * @return error_return_t 0 if successful, an error code otherwise.
+ */
+error_return_t path_unlink(spot_handle_t spot_a, spot_handle_t spot_b);
+
+/**
+ * @brief Rebuilds the top level of the pathfinding hierarchy.
+ *
+ * Precomputes the distances between the entrances of every tile. It
+ * is rebuilt automatically by the first search after the waypoint
+ * graph changes, but may be called once after map load to avoid
+ * stalling that search.
+ *
+ * If any entrance has more than MAX_ENTRANCE_LINKS top level links,
+ * the top level is left incomplete, and searches run over the whole
+ * waypoint graph instead, until a rebuild fits again.
+ */
+void path_build_hierarchy(void);
+
+/**
+ * @brief Finds a route between two spots.
+ *
+ * If an up-to-date route between the same two spots is already cached,
+ * it is returned as is; otherwise, one is searched for and stored in
+ * the route cache, evicting the least recently used route
+ * that is not held.
+ *
+ * The handle is only guaranteed to stay valid until the next call to
+ * path_find, unless held with path_hold.
+ *
+ * @param from The spot to start the route from.
+ * @param to The spot to end the route at.
+ * @return route_handle_t A handle to the cached route, or a negative error code.
+ */
+route_handle_t path_find(spot_handle_t from, spot_handle_t to);
+
+/**
+ * @brief Gets a cached route by handle.
+ *
+ * @param route The handle to the cached route.
+ * @return const struct path_route_t* The route, or NULL if the handle is invalid.
+ */
+const struct path_route_t *path_get_route(route_handle_t route);
+
+/**
+ * @brief Holds a cached route, so that it is never evicted.
+ *
+ * Every hold must eventually be matched by a call to path_release.
+ *
+ * @param route The handle to the cached route.
+ * @return error_return_t 0 if successful, an error code otherwise.
+ */
+error_return_t path_hold(route_handle_t route);
+
+/**
+ * @brief Releases a hold on a cached route.
+ *
+ * @param route The handle to the cached route.
+ * @return error_return_t 0 if successful, an error code otherwise.
+ */
+error_return_t path_release(route_handle_t route);
+
+
+#endif // PATH_H
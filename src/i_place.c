@@ -8,22 +8,90 @@
  * @copyright Copyright (c)Gustavo Ramos Rehermann 2021. The MIT License.
  */
 
+#include <float.h>
+#include <stdlib.h>
+
 #include "i_place.h"
+#include "m_trace.h"
 #include "m_util.h"
 
 
 static struct spotmap_t place_spotmap;
 
-static struct spot_t place_spots[MAX_SPOTS];
+struct spot_t place_spots[MAX_SPOTS];
 size_t place_num_spots = 0;
 
+/**
+ * @brief The first spot in each bucket of each spot index level.
+ *
+ * Stored as the spot's index plus one; 0 marks an empty bucket.
+ */
+static spot_index_t place_level_heads[PLACE_NUM_LEVELS][PLACE_LEVEL_BUCKETS];
+
+/**
+ * @brief An entry of a spot in a spot index level.
+ *
+ * Keeps a copy of the spot's position next to its cell, so that a
+ * query only touches one entry per spot tested.
+ */
+struct place_level_entry_t {
+    float x, y;
+    int cell_x, cell_y;
+
+    /**
+     * @brief The next spot in the same bucket.
+     *
+     * Stored as the spot's index plus one; 0 marks the end of a bucket.
+     */
+    spot_index_t next;
+};
+
+/**
+ * @brief The entries of every spot, for each spot index level.
+ */
+static struct place_level_entry_t place_level_entries[PLACE_NUM_LEVELS][MAX_SPOTS];
+
+/**
+ * @brief The sum, over the cells of each spot index level, of the
+ * square of the number of spots in each.
+ *
+ * Divided by the number of spots, this is the occupancy of the cell
+ * of the average spot, rather than of the average cell; queries are
+ * mostly made around spots, where cells are the most crowded.
+ */
+static unsigned int place_level_sum_sq[PLACE_NUM_LEVELS];
+
+/**
+ * @brief The cost of scanning a cell, relative to testing a spot in it.
+ */
+#define PLACE_LEVEL_CELL_COST 0.5
+
+/**
+ * @brief The last search in which each spot was found.
+ *
+ * Used to skip spots found twice, without clearing anything between
+ * searches.
+ */
+static unsigned int place_seen[MAX_SPOTS];
+static unsigned int place_search_id = 0;
+
+struct place_morton_entry_t place_morton[MAX_SPOTS];
+size_t place_morton_num_spots = 0;
+
+struct place_kd_node_t place_kd[MAX_SPOTS];
+size_t place_kd_num_spots = 0;
+
+int place_grid_x = -PLACE_GRID_WIDTH / 2;
+int place_grid_y = -PLACE_GRID_WIDTH / 2;
+unsigned int place_grid_version = 0;
+
 
 static int hash_coords(int x, int y) {
     return ((x & 0xD555) << 1) | (y & 0x5555);
 }
 
 
-static struct spotmap_tile_t *spot_find_tile(int x, int y) {
+static struct spotmap_tile_t *spot_lookup_tile(int x, int y) {
     const int hash = hash_coords(x, y);
     struct spotmap_bucket_t *const bucket = &place_spotmap.buckets[hash % NUM_SPOT_BUCKETS_PER_MAP];
     size_t i;
@@ -36,6 +104,22 @@ static struct spotmap_tile_t *spot_find_tile(int x, int y) {
         }
     }
 
+    return NULL;
+}
+
+static struct spotmap_tile_t *spot_find_tile(int x, int y) {
+    const int hash = hash_coords(x, y);
+    struct spotmap_bucket_t *const bucket = &place_spotmap.buckets[hash % NUM_SPOT_BUCKETS_PER_MAP];
+    struct spotmap_tile_t *const found = spot_lookup_tile(x, y);
+
+    if (found != NULL) {
+        return found;
+    }
+
+    if (bucket->num_tiles >= MAX_SPOT_TILES_PER_BUCKET) {
+        return NULL;
+    }
+
     // make new tile
     struct spotmap_tile_t *const tile = &bucket->tiles[bucket->num_tiles++];
 
@@ -47,7 +131,7 @@ static struct spotmap_tile_t *spot_find_tile(int x, int y) {
 }
 
 static error_return_t _spot_check_index(spot_handle_t ind_spot, const char *const ctx) {
-    if (ind_spot < place_num_spots) {
+    if (ind_spot >= place_num_spots) {
         erroric(ERR_PLACE_BAD_SPOT_INDEX, ctx);
     }
 
@@ -60,7 +144,11 @@ static error_return_t _spot_check_index(spot_handle_t ind_spot, const char *cons
 typedef error_return_t (*_spot_iterator_callback_t)(spot_handle_t ind_spot, float radius, struct spotmap_tile_t *const tile, int x, int y);
 
 static error_return_t _spot_link_callback(spot_handle_t ind_spot, float radius, struct spotmap_tile_t *const tile, int x, int y) {
-    tile->spots[tile->num_spots++] = ind_spot;
+    if (tile->num_spots >= MAX_SPOTS_PER_TILE) {
+        erroric(ERR_PLACE_MAXED_TILE_SPOTS, "_spot_link_callback");
+    }
+
+    tile->spots[tile->num_spots++] = (spot_index_t) ind_spot;
 
     return 0;
 }
@@ -68,8 +156,6 @@ static error_return_t _spot_link_callback(spot_handle_t ind_spot, float radius,
 static error_return_t _spot_unlink_callback(spot_handle_t ind_spot, float radius, struct spotmap_tile_t *const tile, int x, int y) {
     static int i;
 
-    tile->spots[tile->num_spots++] = ind_spot;
-
     // find which spot in tile is our spot
     for (i = 0; i < tile->num_spots; i++) {
         if (tile->spots[i] == ind_spot) {
@@ -84,7 +170,7 @@ static error_return_t _spot_unlink_callback(spot_handle_t ind_spot, float radius
     }
 
     // move all other spots back a slot
-    while (i < tile->num_spots) {
+    while (i < tile->num_spots - 1) {
         tile->spots[i] = tile->spots[i + 1];
         i++;
     }
@@ -107,6 +193,10 @@ static error_return_t _spot_tile_iter(spot_handle_t ind_spot, float radius, _spo
         for (x = min_x; x <= max_x; x++) {
             struct spotmap_tile_t *const tile = spot_find_tile(x, y);
 
+            if (tile == NULL) {
+                erroric(ERR_PLACE_MAXED_BUCKET_TILES, "_spot_tile_iter");
+            }
+
             errcli(iterator(ind_spot, radius, tile, x, y));
         }
     }
@@ -115,6 +205,8 @@ static error_return_t _spot_tile_iter(spot_handle_t ind_spot, float radius, _spo
 }
 
 error_return_t spot_link(spot_handle_t ind_spot, float radius) {
+    trace_call(TRACE_SPOT_LINK, ind_spot, radius);
+
     errcli(_spot_check_index(ind_spot, "spot_link"));
 
     errcli(_spot_tile_iter(ind_spot, radius, _spot_link_callback));
@@ -122,7 +214,52 @@ error_return_t spot_link(spot_handle_t ind_spot, float radius) {
     return 0;
 }
 
+error_return_t spot_can_link(float x, float y, float radius) {
+    // new tiles each bucket would need, stamped by check
+    static size_t bucket_new[NUM_SPOT_BUCKETS_PER_MAP];
+    static unsigned int bucket_seen[NUM_SPOT_BUCKETS_PER_MAP];
+    static unsigned int check_id = 0;
+
+    const int min_x = floordiv((x - radius), SPOT_TILE_WIDTH);
+    const int max_x = floordiv((x + radius), SPOT_TILE_WIDTH);
+    const int min_y = floordiv((y - radius), SPOT_TILE_WIDTH);
+    const int max_y = floordiv((y + radius), SPOT_TILE_WIDTH);
+    const struct spotmap_tile_t *tile;
+    int tile_x, tile_y, bucket;
+
+    check_id++;
+
+    for (tile_y = min_y; tile_y <= max_y; tile_y++) {
+        for (tile_x = min_x; tile_x <= max_x; tile_x++) {
+            tile = spot_lookup_tile(tile_x, tile_y);
+
+            if (tile != NULL) {
+                if (tile->num_spots >= MAX_SPOTS_PER_TILE) {
+                    erroric(ERR_PLACE_MAXED_TILE_SPOTS, "spot_can_link");
+                }
+
+                continue;
+            }
+
+            bucket = hash_coords(tile_x, tile_y) % NUM_SPOT_BUCKETS_PER_MAP;
+
+            if (bucket_seen[bucket] != check_id) {
+                bucket_seen[bucket] = check_id;
+                bucket_new[bucket] = 0;
+            }
+
+            if (place_spotmap.buckets[bucket].num_tiles + ++bucket_new[bucket] > MAX_SPOT_TILES_PER_BUCKET) {
+                erroric(ERR_PLACE_MAXED_BUCKET_TILES, "spot_can_link");
+            }
+        }
+    }
+
+    return 0;
+}
+
 error_return_t spot_unlink(spot_handle_t ind_spot, float radius) {
+    trace_call(TRACE_SPOT_UNLINK, ind_spot, radius);
+
     errcli(_spot_check_index(ind_spot, "spot_unlink"));
 
     errcli(_spot_tile_iter(ind_spot, radius, _spot_unlink_callback));
@@ -130,7 +267,171 @@ error_return_t spot_unlink(spot_handle_t ind_spot, float radius) {
     return 0;
 }
 
+static int _place_level_hash(int x, int y) {
+    return (int) (((unsigned int) x * 73856093u ^ (unsigned int) y * 19349663u) % PLACE_LEVEL_BUCKETS);
+}
+
+static void _place_level_insert(spot_handle_t ind_spot) {
+    struct place_level_entry_t *entry;
+    int level, width, hash;
+    unsigned int count;
+    spot_index_t next;
+
+    for (level = 0, width = PLACE_LEVEL_BASE_WIDTH; level < PLACE_NUM_LEVELS; level++, width *= 2) {
+        entry = &place_level_entries[level][ind_spot];
+
+        entry->x = place_spots[ind_spot].x;
+        entry->y = place_spots[ind_spot].y;
+        entry->cell_x = floordiv(entry->x, width);
+        entry->cell_y = floordiv(entry->y, width);
+
+        hash = _place_level_hash(entry->cell_x, entry->cell_y);
+
+        // count the spots already in the cell
+        for (count = 0, next = place_level_heads[level][hash]; next; next = place_level_entries[level][next - 1].next) {
+            if (place_level_entries[level][next - 1].cell_x == entry->cell_x && place_level_entries[level][next - 1].cell_y == entry->cell_y) {
+                count++;
+            }
+        }
+
+        // from count squared to (count + 1) squared
+        place_level_sum_sq[level] += 2 * count + 1;
+
+        entry->next = place_level_heads[level][hash];
+        place_level_heads[level][hash] = (spot_index_t) (ind_spot + 1);
+    }
+}
+
+int place_level_for_radius(float radius) {
+    // spots of other cells in the same bucket; alike at every level
+    const float collisions = (float) place_num_spots / PLACE_LEVEL_BUCKETS;
+    int level, best_level = 0, width;
+    float span, occupancy, cost, best_cost = 0.0;
+
+    for (level = 0, width = PLACE_LEVEL_BASE_WIDTH; level < PLACE_NUM_LEVELS; level++, width *= 2) {
+        // expected cells scanned, times the cost of scanning each
+        span = radius * 2 / width + 1;
+        occupancy = place_num_spots ? (float) place_level_sum_sq[level] / place_num_spots : 0.0;
+        cost = span * span * (PLACE_LEVEL_CELL_COST + occupancy + collisions);
+
+        if (level == 0 || cost < best_cost) {
+            best_level = level;
+            best_cost = cost;
+        }
+    }
+
+    return best_level;
+}
+
+size_t place_find_spots_at_level(int level, float x, float y, float radius, spot_handle_t *found, size_t max_found) {
+    const int width = PLACE_LEVEL_BASE_WIDTH << level;
+    const int min_x = floordiv(x - radius, width);
+    const int max_x = floordiv(x + radius, width);
+    const int min_y = floordiv(y - radius, width);
+    const int max_y = floordiv(y + radius, width);
+    const struct place_level_entry_t *entry;
+    size_t num_found = 0;
+    spot_index_t next;
+    int cell_x, cell_y;
+    float dx, dy;
+
+    for (cell_y = min_y; cell_y <= max_y; cell_y++) {
+        for (cell_x = min_x; cell_x <= max_x; cell_x++) {
+            for (next = place_level_heads[level][_place_level_hash(cell_x, cell_y)]; next; next = entry->next) {
+                entry = &place_level_entries[level][next - 1];
+
+                if (entry->cell_x != cell_x || entry->cell_y != cell_y) {
+                    // another cell in the same bucket
+                    continue;
+                }
+
+                dx = entry->x - x;
+                dy = entry->y - y;
+
+                if (dx * dx + dy * dy > radius * radius) {
+                    continue;
+                }
+
+                if (num_found >= max_found) {
+                    return num_found;
+                }
+
+                found[num_found++] = next - 1;
+            }
+        }
+    }
+
+    return num_found;
+}
+
+size_t place_find_spots(float x, float y, float radius, spot_handle_t *found, size_t max_found) {
+    trace_call(TRACE_PLACE_FIND_SPOTS, x, y, radius, max_found);
+
+    return place_find_spots_at_level(place_level_for_radius(radius), x, y, radius, found, max_found);
+}
+
+size_t spot_find_near(float x, float y, float radius, spot_handle_t *found, size_t max_found) {
+    const int min_x = floordiv(x - radius, SPOT_TILE_WIDTH);
+    const int max_x = floordiv(x + radius, SPOT_TILE_WIDTH);
+    const int min_y = floordiv(y - radius, SPOT_TILE_WIDTH);
+    const int max_y = floordiv(y + radius, SPOT_TILE_WIDTH);
+    const struct spotmap_tile_t *tile;
+    size_t num_found = 0, ind_spot;
+    int tile_x, tile_y, i;
+    float dx, dy;
+
+    trace_call(TRACE_SPOT_FIND_NEAR, x, y, radius, max_found);
+
+    place_search_id++;
+
+    for (tile_y = min_y; tile_y <= max_y; tile_y++) {
+        for (tile_x = min_x; tile_x <= max_x; tile_x++) {
+            tile = spot_lookup_tile(tile_x, tile_y);
+
+            if (tile == NULL) {
+                continue;
+            }
+
+            for (i = 0; i < tile->num_spots; i++) {
+                ind_spot = tile->spots[i];
+
+                // spots linked with a radius may be in several tiles
+                if (place_seen[ind_spot] == place_search_id) {
+                    continue;
+                }
+
+                place_seen[ind_spot] = place_search_id;
+
+                dx = place_spots[ind_spot].x - x;
+                dy = place_spots[ind_spot].y - y;
+
+                if (dx * dx + dy * dy > radius * radius) {
+                    continue;
+                }
+
+                if (num_found >= max_found) {
+                    return num_found;
+                }
+
+                found[num_found++] = ind_spot;
+            }
+        }
+    }
+
+    return num_found;
+}
+
+spot_index_t spot_index(spot_handle_t spot) {
+    if (spot >= place_num_spots) {
+        errorac(ERR_PLACE_BAD_SPOT_INDEX, SPOT_INDEX_NONE, "spot_index");
+    }
+
+    return (spot_index_t) spot;
+}
+
 spot_handle_t make_spot(float x, float y) {
+    trace_call(TRACE_MAKE_SPOT, x, y);
+
     if (place_num_spots >= MAX_SPOTS) {
         errorac(ERR_PLACE_MAXED_SPOTS, -1, "make_spot");
     }
@@ -138,5 +439,843 @@ spot_handle_t make_spot(float x, float y) {
     place_spots[place_num_spots].x = x;
     place_spots[place_num_spots].y = y;
 
+    _place_level_insert(place_num_spots);
+
     return place_num_spots++;
 }
+
+void place_grid_fit(void) {
+    int min_x, min_y, max_x, max_y, x, y;
+    size_t i;
+
+    if (place_num_spots == 0) {
+        return;
+    }
+
+    min_x = max_x = floordiv(place_spots[0].x, SPOT_TILE_WIDTH);
+    min_y = max_y = floordiv(place_spots[0].y, SPOT_TILE_WIDTH);
+
+    for (i = 1; i < place_num_spots; i++) {
+        x = floordiv(place_spots[i].x, SPOT_TILE_WIDTH);
+        y = floordiv(place_spots[i].y, SPOT_TILE_WIDTH);
+
+        if (x < min_x) min_x = x;
+        if (x > max_x) max_x = x;
+        if (y < min_y) min_y = y;
+        if (y > max_y) max_y = y;
+    }
+
+    // center the grid over the spots
+    place_grid_x = (min_x + max_x + 1 - PLACE_GRID_WIDTH) / 2;
+    place_grid_y = (min_y + max_y + 1 - PLACE_GRID_WIDTH) / 2;
+
+    place_grid_version++;
+}
+
+int place_grid_tile_index(int tile_x, int tile_y) {
+    tile_x -= place_grid_x;
+    tile_y -= place_grid_y;
+
+    if (tile_x < 0 || tile_y < 0 || tile_x >= PLACE_GRID_WIDTH || tile_y >= PLACE_GRID_WIDTH) {
+        return -1;
+    }
+
+    return tile_y * PLACE_GRID_WIDTH + tile_x;
+}
+
+int place_grid_index(float x, float y) {
+    return place_grid_tile_index(floordiv(x, SPOT_TILE_WIDTH), floordiv(y, SPOT_TILE_WIDTH));
+}
+
+/**
+ * @brief Spreads the low 16 bits of a number over its even bits.
+ */
+static unsigned int _place_morton_spread(unsigned int n) {
+    n &= 0xFFFF;
+    n = (n | (n << 8)) & 0x00FF00FF;
+    n = (n | (n << 4)) & 0x0F0F0F0F;
+    n = (n | (n << 2)) & 0x33333333;
+    n = (n | (n << 1)) & 0x55555555;
+
+    return n;
+}
+
+/**
+ * @brief The Morton key of a tile.
+ *
+ * Tile coordinates are biased so that the key sorts negative tiles
+ * before positive ones.
+ */
+static unsigned int _place_morton_key(int tile_x, int tile_y) {
+    return _place_morton_spread(tile_x + PLACE_MORTON_BIAS) | (_place_morton_spread(tile_y + PLACE_MORTON_BIAS) << 1);
+}
+
+static int _place_morton_compare(const void *a, const void *b) {
+    const struct place_morton_entry_t *const entry_a = a;
+    const struct place_morton_entry_t *const entry_b = b;
+
+    if (entry_a->key != entry_b->key) {
+        return entry_a->key < entry_b->key ? -1 : 1;
+    }
+
+    // keep spots of the same tile in order
+    return entry_a->spot < entry_b->spot ? -1 : (entry_a->spot > entry_b->spot);
+}
+
+void place_morton_build(void) {
+    size_t i;
+
+    for (i = 0; i < place_num_spots; i++) {
+        place_morton[i].key = _place_morton_key(floordiv(place_spots[i].x, SPOT_TILE_WIDTH), floordiv(place_spots[i].y, SPOT_TILE_WIDTH));
+        place_morton[i].spot = (spot_index_t) i;
+    }
+
+    qsort(place_morton, place_num_spots, sizeof(*place_morton), _place_morton_compare);
+
+    place_morton_num_spots = place_num_spots;
+}
+
+/**
+ * @brief Splits a rectangle of tiles into contiguous Morton key ranges.
+ *
+ * Small rectangles are split into a range per tile, merged wherever
+ * keys are consecutive. Larger ones walk the quadtree implied by the keys, from the smallest aligned
+ * square holding the whole rectangle down. Squares inside of the
+ * rectangle become one range each, and adjacent ranges are merged.
+ * Once the range budget runs low, squares only partly inside become
+ * whole ranges too; their spots are filtered out by the caller.
+ */
+static int _place_morton_ranges(unsigned int min_x, unsigned int min_y, unsigned int max_x, unsigned int max_y, unsigned int *range_lo, unsigned int *range_hi) {
+    // squares yet to be split, as their minimum corner and size
+    static unsigned int stack_x[4 * 32], stack_y[4 * 32];
+    static int stack_level[4 * 32];
+    int num_stack = 0, num_ranges = 0;
+
+    unsigned int x, y, side, lo, hi, key;
+    int level = 0, child, i;
+
+    if ((max_x - min_x + 1) * (max_y - min_y + 1) <= PLACE_MORTON_MAX_RANGES) {
+        // small enough to just list the key of every tile, in order
+        for (y = min_y; y <= max_y; y++) {
+            for (x = min_x; x <= max_x; x++) {
+                key = _place_morton_spread(x) | (_place_morton_spread(y) << 1);
+
+                for (i = num_ranges; i > 0 && range_lo[i - 1] > key; i--) {
+                    range_lo[i] = range_lo[i - 1];
+                }
+
+                range_lo[i] = key;
+                num_ranges++;
+            }
+        }
+
+        // merge tiles with consecutive keys
+        for (i = 0, child = 0; i < num_ranges; i++) {
+            if (child > 0 && range_hi[child - 1] + 1 == range_lo[i]) {
+                range_hi[child - 1] = range_lo[i];
+            }
+
+            else {
+                range_lo[child] = range_hi[child] = range_lo[i];
+                child++;
+            }
+        }
+
+        return child;
+    }
+
+    // the smallest aligned square holding the rectangle
+    while ((min_x >> level) != (max_x >> level) || (min_y >> level) != (max_y >> level)) {
+        level++;
+    }
+
+    stack_x[0] = (min_x >> level) << level;
+    stack_y[0] = (min_y >> level) << level;
+    stack_level[0] = level;
+    num_stack = 1;
+
+    while (num_stack > 0) {
+        num_stack--;
+        x = stack_x[num_stack];
+        y = stack_y[num_stack];
+        level = stack_level[num_stack];
+        side = 1u << level;
+
+        if (x > max_x || y > max_y || x + side - 1 < min_x || y + side - 1 < min_y) {
+            // outside of the rectangle
+            continue;
+        }
+
+        // every square still stacked may yet become a range of its own
+        if (level > 0 && num_ranges + num_stack + 4 <= PLACE_MORTON_MAX_RANGES && (x < min_x || y < min_y || x + side - 1 > max_x || y + side - 1 > max_y)) {
+            // partly inside; split it, pushing the last quadrant first,
+            // so that ranges come out in ascending order
+            for (child = 3; child >= 0; child--) {
+                stack_x[num_stack] = x + ((child & 1) << (level - 1));
+                stack_y[num_stack] = y + ((child >> 1) << (level - 1));
+                stack_level[num_stack] = level - 1;
+                num_stack++;
+            }
+
+            continue;
+        }
+
+        lo = _place_morton_spread(x) | (_place_morton_spread(y) << 1);
+        hi = lo + (side * side - 1);
+
+        if (num_ranges > 0 && range_hi[num_ranges - 1] + 1 == lo) {
+            range_hi[num_ranges - 1] = hi;
+        }
+
+        else {
+            range_lo[num_ranges] = lo;
+            range_hi[num_ranges] = hi;
+            num_ranges++;
+        }
+    }
+
+    return num_ranges;
+}
+
+size_t place_morton_find_rect(int min_tile_x, int min_tile_y, int max_tile_x, int max_tile_y, spot_handle_t *found, size_t max_found) {
+    unsigned int range_lo[PLACE_MORTON_MAX_RANGES], range_hi[PLACE_MORTON_MAX_RANGES];
+    const unsigned int min_x = min_tile_x + PLACE_MORTON_BIAS, max_x = max_tile_x + PLACE_MORTON_BIAS;
+    const unsigned int min_y = min_tile_y + PLACE_MORTON_BIAS, max_y = max_tile_y + PLACE_MORTON_BIAS;
+    const unsigned int lo_x = _place_morton_spread(min_x), hi_x = _place_morton_spread(max_x);
+    const unsigned int lo_y = _place_morton_spread(min_y) << 1, hi_y = _place_morton_spread(max_y) << 1;
+    size_t num_found = 0, lo, hi, mid;
+    int num_ranges, i;
+    unsigned int key;
+
+    if (min_tile_x > max_tile_x || min_tile_y > max_tile_y) {
+        return 0;
+    }
+
+    num_ranges = _place_morton_ranges(min_x, min_y, max_x, max_y, range_lo, range_hi);
+
+    for (i = 0; i < num_ranges; i++) {
+        // binary search for the first key in the range
+        lo = 0;
+        hi = place_morton_num_spots;
+
+        while (lo < hi) {
+            mid = (lo + hi) / 2;
+
+            if (place_morton[mid].key < range_lo[i]) {
+                lo = mid + 1;
+            }
+
+            else {
+                hi = mid;
+            }
+        }
+
+        for (; lo < place_morton_num_spots && place_morton[lo].key <= range_hi[i]; lo++) {
+            key = place_morton[lo].key;
+
+            // masked compares check each axis of a key without decoding it
+            if ((key & 0x55555555) < lo_x || (key & 0x55555555) > hi_x || (key & 0xAAAAAAAA) < lo_y || (key & 0xAAAAAAAA) > hi_y) {
+                continue;
+            }
+
+            if (num_found >= max_found) {
+                return num_found;
+            }
+
+            found[num_found++] = place_morton[lo].spot;
+        }
+    }
+
+    return num_found;
+}
+
+size_t place_morton_find_spots(float x, float y, float radius, spot_handle_t *found, size_t max_found) {
+    static spot_handle_t candidates[MAX_SPOTS];
+    size_t num_candidates, i, num_found = 0;
+    float dx, dy;
+
+    num_candidates = place_morton_find_rect(
+        floordiv(x - radius, SPOT_TILE_WIDTH), floordiv(y - radius, SPOT_TILE_WIDTH),
+        floordiv(x + radius, SPOT_TILE_WIDTH), floordiv(y + radius, SPOT_TILE_WIDTH),
+        candidates, MAX_SPOTS
+    );
+
+    for (i = 0; i < num_candidates && num_found < max_found; i++) {
+        dx = place_spots[candidates[i]].x - x;
+        dy = place_spots[candidates[i]].y - y;
+
+        if (dx * dx + dy * dy <= radius * radius) {
+            found[num_found++] = candidates[i];
+        }
+    }
+
+    return num_found;
+}
+
+/**
+ * @brief The max number of ranges stacked while walking the KD-tree.
+ *
+ * At most one range more is stacked per level of the tree, and the
+ * tree is balanced, so this is plenty for MAX_SPOTS.
+ */
+#define PLACE_KD_STACK_SIZE 64
+
+/**
+ * @brief A range of place_kd, for walking the KD-tree without recursion.
+ *
+ * The node of a range is the middle item in it; the items before it
+ * are its left subtree, and the items after it its right subtree.
+ */
+struct _place_kd_range_t {
+    size_t lo, hi;
+    int axis;
+
+    /**
+     * @brief The squared distance from the query to this range's half-plane.
+     */
+    float plane_dist;
+};
+
+static float _place_kd_coord(const struct place_kd_node_t *node, int axis) {
+    return axis ? node->y : node->x;
+}
+
+/**
+ * @brief Partially sorts a range of place_kd, so that its middle item is its median.
+ *
+ * Items before the middle are not greater than it along the axis, and
+ * items after it are not smaller.
+ */
+static void _place_kd_select(size_t lo, size_t hi, int axis) {
+    const size_t mid = lo + (hi - lo) / 2;
+    struct place_kd_node_t swap;
+    size_t i, store;
+    float pivot;
+
+    hi--;
+
+    while (lo < hi) {
+        // median of three as the pivot, moved to the end
+        i = lo + (hi - lo) / 2;
+
+        if (_place_kd_coord(&place_kd[i], axis) < _place_kd_coord(&place_kd[lo], axis)) {
+            swap = place_kd[i]; place_kd[i] = place_kd[lo]; place_kd[lo] = swap;
+        }
+
+        if (_place_kd_coord(&place_kd[hi], axis) < _place_kd_coord(&place_kd[lo], axis)) {
+            swap = place_kd[hi]; place_kd[hi] = place_kd[lo]; place_kd[lo] = swap;
+        }
+
+        if (_place_kd_coord(&place_kd[i], axis) < _place_kd_coord(&place_kd[hi], axis)) {
+            swap = place_kd[i]; place_kd[i] = place_kd[hi]; place_kd[hi] = swap;
+        }
+
+        pivot = _place_kd_coord(&place_kd[hi], axis);
+
+        for (i = store = lo; i < hi; i++) {
+            if (_place_kd_coord(&place_kd[i], axis) < pivot) {
+                swap = place_kd[i]; place_kd[i] = place_kd[store]; place_kd[store] = swap;
+                store++;
+            }
+        }
+
+        swap = place_kd[hi]; place_kd[hi] = place_kd[store]; place_kd[store] = swap;
+
+        if (store == mid) {
+            return;
+        }
+
+        if (store < mid) {
+            lo = store + 1;
+        }
+
+        else {
+            hi = store - 1;
+        }
+    }
+}
+
+void place_kd_build(void) {
+    static struct _place_kd_range_t stack[PLACE_KD_STACK_SIZE];
+    struct _place_kd_range_t range;
+    int num_stack = 0;
+    size_t i, mid;
+
+    for (i = 0; i < place_num_spots; i++) {
+        place_kd[i].x = place_spots[i].x;
+        place_kd[i].y = place_spots[i].y;
+        place_kd[i].spot = (spot_index_t) i;
+    }
+
+    place_kd_num_spots = place_num_spots;
+
+    stack[num_stack].lo = 0;
+    stack[num_stack].hi = place_kd_num_spots;
+    stack[num_stack].axis = 0;
+    num_stack++;
+
+    while (num_stack > 0) {
+        range = stack[--num_stack];
+
+        if (range.hi - range.lo < 2) {
+            continue;
+        }
+
+        _place_kd_select(range.lo, range.hi, range.axis);
+        mid = range.lo + (range.hi - range.lo) / 2;
+
+        stack[num_stack].lo = range.lo;
+        stack[num_stack].hi = mid;
+        stack[num_stack].axis = !range.axis;
+        num_stack++;
+
+        stack[num_stack].lo = mid + 1;
+        stack[num_stack].hi = range.hi;
+        stack[num_stack].axis = !range.axis;
+        num_stack++;
+    }
+}
+
+/**
+ * @brief Walks the KD-tree nearest first, pruning by a search radius.
+ *
+ * Calls the visitor on every node within the search radius; the
+ * visitor may shrink the radius as it goes, such as while looking for
+ * the nearest spots.
+ */
+typedef void (*_place_kd_visitor_t)(const struct place_kd_node_t *node, float dist, float *radius_sq, void *data);
+
+static void _place_kd_walk(float x, float y, float radius_sq, _place_kd_visitor_t visitor, void *data) {
+    static struct _place_kd_range_t stack[PLACE_KD_STACK_SIZE];
+    struct _place_kd_range_t range;
+    const struct place_kd_node_t *node;
+    int num_stack = 0;
+    size_t mid;
+    float dx, dy, delta;
+
+    if (place_kd_num_spots == 0) {
+        return;
+    }
+
+    stack[num_stack].lo = 0;
+    stack[num_stack].hi = place_kd_num_spots;
+    stack[num_stack].axis = 0;
+    stack[num_stack].plane_dist = 0.0;
+    num_stack++;
+
+    while (num_stack > 0) {
+        range = stack[--num_stack];
+
+        if (range.plane_dist > radius_sq) {
+            // the search radius shrank since this range was stacked
+            continue;
+        }
+
+        mid = range.lo + (range.hi - range.lo) / 2;
+        node = &place_kd[mid];
+
+        dx = node->x - x;
+        dy = node->y - y;
+
+        if (dx * dx + dy * dy <= radius_sq) {
+            visitor(node, dx * dx + dy * dy, &radius_sq, data);
+        }
+
+        delta = (range.axis ? y - node->y : x - node->x);
+
+        // stack the far side first, so that the near side is walked first
+        if (delta < 0) {
+            if (mid + 1 < range.hi && delta * delta <= radius_sq) {
+                stack[num_stack].lo = mid + 1;
+                stack[num_stack].hi = range.hi;
+                stack[num_stack].axis = !range.axis;
+                stack[num_stack].plane_dist = delta * delta;
+                num_stack++;
+            }
+
+            if (range.lo < mid) {
+                stack[num_stack].lo = range.lo;
+                stack[num_stack].hi = mid;
+                stack[num_stack].axis = !range.axis;
+                stack[num_stack].plane_dist = 0.0;
+                num_stack++;
+            }
+        }
+
+        else {
+            if (range.lo < mid && delta * delta <= radius_sq) {
+                stack[num_stack].lo = range.lo;
+                stack[num_stack].hi = mid;
+                stack[num_stack].axis = !range.axis;
+                stack[num_stack].plane_dist = delta * delta;
+                num_stack++;
+            }
+
+            if (mid + 1 < range.hi) {
+                stack[num_stack].lo = mid + 1;
+                stack[num_stack].hi = range.hi;
+                stack[num_stack].axis = !range.axis;
+                stack[num_stack].plane_dist = 0.0;
+                num_stack++;
+            }
+        }
+    }
+}
+
+/**
+ * @brief The state of a k-nearest search.
+ *
+ * The spots found so far are kept as a max-heap by distance, so that
+ * the farthest one is replaced first.
+ */
+struct _place_kd_nearest_t {
+    spot_handle_t *found;
+    float dist[PLACE_KD_MAX_NEAREST];
+    size_t k, num_found;
+};
+
+static void _place_kd_nearest_visitor(const struct place_kd_node_t *node, float dist, float *radius_sq, void *data) {
+    struct _place_kd_nearest_t *const search = data;
+    size_t i, child;
+
+    if (search->num_found < search->k) {
+        // sift up
+        i = search->num_found++;
+
+        while (i > 0 && search->dist[(i - 1) / 2] < dist) {
+            search->dist[i] = search->dist[(i - 1) / 2];
+            search->found[i] = search->found[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+
+        search->dist[i] = dist;
+        search->found[i] = node->spot;
+    }
+
+    else if (dist < search->dist[0]) {
+        // replace the farthest, then sift down
+        i = 0;
+
+        while ((child = i * 2 + 1) < search->num_found) {
+            if (child + 1 < search->num_found && search->dist[child + 1] > search->dist[child]) {
+                child++;
+            }
+
+            if (search->dist[child] <= dist) {
+                break;
+            }
+
+            search->dist[i] = search->dist[child];
+            search->found[i] = search->found[child];
+            i = child;
+        }
+
+        search->dist[i] = dist;
+        search->found[i] = node->spot;
+    }
+
+    else {
+        return;
+    }
+
+    if (search->num_found == search->k) {
+        // nothing farther than the farthest found can make it anymore
+        *radius_sq = search->dist[0];
+    }
+}
+
+size_t place_kd_find_nearest(float x, float y, size_t k, spot_handle_t *found) {
+    struct _place_kd_nearest_t search;
+    spot_handle_t swap_spot;
+    float swap_dist;
+    size_t i, j;
+
+    if (k > PLACE_KD_MAX_NEAREST) {
+        k = PLACE_KD_MAX_NEAREST;
+    }
+
+    if (k == 0) {
+        return 0;
+    }
+
+    search.found = found;
+    search.k = k;
+    search.num_found = 0;
+
+    _place_kd_walk(x, y, FLT_MAX, _place_kd_nearest_visitor, &search);
+
+    // sort the heap, nearest first
+    for (i = 1; i < search.num_found; i++) {
+        swap_dist = search.dist[i];
+        swap_spot = found[i];
+
+        for (j = i; j > 0 && search.dist[j - 1] > swap_dist; j--) {
+            search.dist[j] = search.dist[j - 1];
+            found[j] = found[j - 1];
+        }
+
+        search.dist[j] = swap_dist;
+        found[j] = swap_spot;
+    }
+
+    return search.num_found;
+}
+
+spot_handle_t place_kd_nearest(float x, float y) {
+    spot_handle_t nearest;
+
+    if (place_kd_find_nearest(x, y, 1, &nearest) == 0) {
+        return -1;
+    }
+
+    return nearest;
+}
+
+/**
+ * @brief The state of a radius search.
+ */
+struct _place_kd_radius_t {
+    spot_handle_t *found;
+    size_t max_found, num_found;
+};
+
+static void _place_kd_radius_visitor(const struct place_kd_node_t *node, float dist, float *radius_sq, void *data) {
+    struct _place_kd_radius_t *const search = data;
+
+    if (search->num_found >= search->max_found) {
+        // stop looking
+        *radius_sq = -1.0;
+        return;
+    }
+
+    search->found[search->num_found++] = node->spot;
+}
+
+size_t place_kd_find_spots(float x, float y, float radius, spot_handle_t *found, size_t max_found) {
+    struct _place_kd_radius_t search;
+
+    search.found = found;
+    search.max_found = max_found;
+    search.num_found = 0;
+
+    _place_kd_walk(x, y, radius * radius, _place_kd_radius_visitor, &search);
+
+    return search.num_found;
+}
+
+/**
+ * @brief The size of the table the tiles of a batch are grouped in.
+ *
+ * A power of two, at least twice PLACE_BATCH_MAX_TILES, so that probes
+ * stay short.
+ */
+#define PLACE_BATCH_TABLE_SIZE 8192
+
+#if PLACE_BATCH_TABLE_SIZE < PLACE_BATCH_MAX_TILES * 2
+#error "PLACE_BATCH_TABLE_SIZE is too small for PLACE_BATCH_MAX_TILES"
+#endif
+
+/**
+ * @brief A spotmap tile covered by the queries of a batch.
+ */
+struct _place_batch_tile_t {
+    int x, y;
+
+    /**
+     * @brief The last item over this tile, or -1; the rest follow
+     * through the next field of each item.
+     */
+    int first;
+};
+
+/**
+ * @brief A query of a batch over one of the tiles it covers.
+ */
+struct _place_batch_item_t {
+    int next;
+    unsigned short query;
+};
+
+/**
+ * @brief A spot within the radius of a query of a batch.
+ */
+struct _place_batch_hit_t {
+    unsigned short query;
+    spot_index_t spot;
+};
+
+static struct _place_batch_tile_t place_batch_tiles[PLACE_BATCH_MAX_TILES];
+static struct _place_batch_item_t place_batch_items[PLACE_BATCH_MAX_TILES];
+
+/**
+ * @brief The index in place_batch_tiles of each tile in the table.
+ */
+static int place_batch_table[PLACE_BATCH_TABLE_SIZE];
+
+/**
+ * @brief The batch in which each table slot was last filled.
+ *
+ * Compared against place_batch_id instead of clearing the table
+ * before each batch.
+ */
+static unsigned int place_batch_table_seen[PLACE_BATCH_TABLE_SIZE];
+static unsigned int place_batch_id = 0;
+
+
+/**
+ * @brief Finds the entry of a tile in the current batch, adding it if new.
+ *
+ * @return int The index of the tile in place_batch_tiles.
+ */
+static int _place_batch_tile(int tile_x, int tile_y, int *num_tiles) {
+    unsigned int slot = ((unsigned int) tile_x * 73856093u ^ (unsigned int) tile_y * 19349663u) & (PLACE_BATCH_TABLE_SIZE - 1);
+    struct _place_batch_tile_t *tile;
+
+    while (place_batch_table_seen[slot] == place_batch_id) {
+        tile = &place_batch_tiles[place_batch_table[slot]];
+
+        if (tile->x == tile_x && tile->y == tile_y) {
+            return place_batch_table[slot];
+        }
+
+        slot = (slot + 1) & (PLACE_BATCH_TABLE_SIZE - 1);
+    }
+
+    tile = &place_batch_tiles[*num_tiles];
+
+    tile->x = tile_x;
+    tile->y = tile_y;
+    tile->first = -1;
+
+    place_batch_table_seen[slot] = place_batch_id;
+    place_batch_table[slot] = *num_tiles;
+
+    return (*num_tiles)++;
+}
+
+error_return_t spot_find_near_batch(struct spot_query_t *queries, size_t num_queries, spot_handle_t *found, size_t max_found) {
+    static struct _place_batch_hit_t hits[PLACE_BATCH_MAX_HITS];
+    static struct _place_batch_hit_t hits_by_query[PLACE_BATCH_MAX_HITS];
+    static size_t query_hits[PLACE_BATCH_MAX_QUERIES + 1];
+
+    struct _place_batch_tile_t *batch_tile;
+    const struct spotmap_tile_t *tile;
+    const struct spot_t *spot;
+    struct spot_query_t *query;
+    size_t num_hits = 0, num_found = 0, i, k;
+    int num_tiles = 0, num_items = 0, t, m;
+    int tile_x, tile_y, min_x, max_x, min_y, max_y, overflowed = 0;
+    float dx, dy;
+
+    if (num_queries > PLACE_BATCH_MAX_QUERIES) {
+        erroric(ERR_PLACE_BATCH_TOO_LARGE, "spot_find_near_batch");
+    }
+
+    place_batch_id++;
+
+    // group the queries of the batch by the tiles they cover
+    for (i = 0; i < num_queries; i++) {
+        query = &queries[i];
+        query->first = 0;
+        query->num_found = 0;
+
+        min_x = floordiv(query->x - query->radius, SPOT_TILE_WIDTH);
+        max_x = floordiv(query->x + query->radius, SPOT_TILE_WIDTH);
+        min_y = floordiv(query->y - query->radius, SPOT_TILE_WIDTH);
+        max_y = floordiv(query->y + query->radius, SPOT_TILE_WIDTH);
+
+        for (tile_y = min_y; tile_y <= max_y; tile_y++) {
+            for (tile_x = min_x; tile_x <= max_x; tile_x++) {
+                if (num_items >= PLACE_BATCH_MAX_TILES) {
+                    erroric(ERR_PLACE_BATCH_TOO_LARGE, "spot_find_near_batch");
+                }
+
+                batch_tile = &place_batch_tiles[_place_batch_tile(tile_x, tile_y, &num_tiles)];
+
+                place_batch_items[num_items].query = (unsigned short) i;
+                place_batch_items[num_items].next = batch_tile->first;
+                batch_tile->first = num_items++;
+            }
+        }
+    }
+
+    // walk each tile once, testing its spots against every query over it
+    for (t = 0; t < num_tiles; t++) {
+        tile = spot_lookup_tile(place_batch_tiles[t].x, place_batch_tiles[t].y);
+
+        if (tile == NULL) {
+            continue;
+        }
+
+        for (k = 0; k < tile->num_spots; k++) {
+            spot = &place_spots[tile->spots[k]];
+
+            for (m = place_batch_tiles[t].first; m != -1; m = place_batch_items[m].next) {
+                query = &queries[place_batch_items[m].query];
+
+                dx = spot->x - query->x;
+                dy = spot->y - query->y;
+
+                if (dx * dx + dy * dy > query->radius * query->radius) {
+                    continue;
+                }
+
+                if (num_hits >= PLACE_BATCH_MAX_HITS) {
+                    erroric(ERR_PLACE_BATCH_TOO_LARGE, "spot_find_near_batch");
+                }
+
+                hits[num_hits].query = place_batch_items[m].query;
+                hits[num_hits].spot = tile->spots[k];
+                num_hits++;
+            }
+        }
+    }
+
+    // group the hits by query, with a counting sort
+    for (i = 0; i <= num_queries; i++) {
+        query_hits[i] = 0;
+    }
+
+    for (i = 0; i < num_hits; i++) {
+        query_hits[hits[i].query + 1]++;
+    }
+
+    for (i = 0; i < num_queries; i++) {
+        query_hits[i + 1] += query_hits[i];
+    }
+
+    for (i = 0; i < num_hits; i++) {
+        hits_by_query[query_hits[hits[i].query]++] = hits[i];
+    }
+
+    // query_hits[i] now is where the hits of query i end
+    for (i = 0, k = 0; i < num_queries; i++) {
+        query = &queries[i];
+        query->first = num_found;
+
+        place_search_id++;
+
+        for (; k < query_hits[i]; k++) {
+            // spots linked with a radius may be in several tiles
+            if (place_seen[hits_by_query[k].spot] == place_search_id) {
+                continue;
+            }
+
+            place_seen[hits_by_query[k].spot] = place_search_id;
+
+            if (num_found >= max_found) {
+                overflowed = 1;
+                continue;
+            }
+
+            found[num_found++] = hits_by_query[k].spot;
+            query->num_found++;
+        }
+    }
+
+    if (overflowed) {
+        erroric(ERR_PLACE_BATCH_TOO_LARGE, "spot_find_near_batch");
+    }
+
+    return 0;
+}
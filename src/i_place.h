@@ -44,18 +44,31 @@ struct spot_t {
 
 /**
  * @brief The max number of spots that can be defined within the world.
+ *
+ * May be overridden when building, such as by host tools that
+ * simulate larger worlds.
  */
+#ifndef MAX_SPOTS
 #define MAX_SPOTS 512
+#endif
 
 /**
  * @brief The max number of spots that can be linked to a single tile.
+ *
+ * May be overridden when building, like MAX_SPOTS.
  */
+#ifndef MAX_SPOTS_PER_TILE
 #define MAX_SPOTS_PER_TILE 4
+#endif
 
 /**
  * @brief The max number of spotmap tiles that can be in a bucket.
+ *
+ * May be overridden when building, like MAX_SPOTS.
  */
+#ifndef MAX_SPOT_TILES_PER_BUCKET
 #define MAX_SPOT_TILES_PER_BUCKET 64
+#endif
 
 /**
  * @brief The number of spotmap buckets in a spotmap.
@@ -67,6 +80,132 @@ struct spot_t {
  */
 #define SPOT_TILE_WIDTH 1024
 
+/**
+ * @brief The width of the place grid, along the X and Y axes, in tiles.
+ *
+ * May be overridden when building, like MAX_SPOTS; 64 tiles span a
+ * whole Doom map.
+ *
+ * @see place_grid_fit
+ */
+#ifndef PLACE_GRID_WIDTH
+#define PLACE_GRID_WIDTH 32
+#endif
+
+/**
+ * @brief The number of tiles in the place grid.
+ */
+#define PLACE_GRID_TILES (PLACE_GRID_WIDTH * PLACE_GRID_WIDTH)
+
+/**
+ * @brief The number of levels in the spot index.
+ *
+ * @see place_find_spots
+ */
+#define PLACE_NUM_LEVELS 4
+
+/**
+ * @brief The cell width of the finest level of the spot index.
+ *
+ * Each level's cells are twice as wide as the previous level's.
+ */
+#define PLACE_LEVEL_BASE_WIDTH 256
+
+/**
+ * @brief The number of hash buckets in each level of the spot index.
+ *
+ * Every spot is chained into a bucket at every level, so this defaults
+ * to the first power of two of at least twice MAX_SPOTS, to keep the
+ * chains short. May be overridden when building, but must be a power
+ * of two.
+ */
+#ifndef PLACE_LEVEL_BUCKETS
+#if MAX_SPOTS <= 512
+#define PLACE_LEVEL_BUCKETS 1024
+#elif MAX_SPOTS <= 2048
+#define PLACE_LEVEL_BUCKETS 4096
+#elif MAX_SPOTS <= 8192
+#define PLACE_LEVEL_BUCKETS 16384
+#elif MAX_SPOTS <= 32768
+#define PLACE_LEVEL_BUCKETS 65536
+#else
+#define PLACE_LEVEL_BUCKETS 262144
+#endif
+#endif
+
+#if PLACE_LEVEL_BUCKETS & (PLACE_LEVEL_BUCKETS - 1)
+#error PLACE_LEVEL_BUCKETS must be a power of two
+#endif
+
+/**
+ * @brief The max number of key ranges a Morton query is split into.
+ *
+ * @see place_morton_find_rect
+ */
+#define PLACE_MORTON_MAX_RANGES 16
+
+/**
+ * @brief Added to tile coordinates before making Morton keys of them.
+ *
+ * Tile coordinates must be within -PLACE_MORTON_BIAS and
+ * PLACE_MORTON_BIAS - 1.
+ */
+#define PLACE_MORTON_BIAS 0x8000
+
+/**
+ * @brief The max number of spots a k-nearest KD-tree query can find.
+ *
+ * @see place_kd_find_nearest
+ */
+#define PLACE_KD_MAX_NEAREST 32
+
+/**
+ * @brief The max number of queries in a single batch.
+ *
+ * @see spot_find_near_batch
+ */
+#define PLACE_BATCH_MAX_QUERIES 256
+
+/**
+ * @brief The max number of spotmap tiles a single batch can cover, summed over its queries.
+ *
+ * @see spot_find_near_batch
+ */
+#define PLACE_BATCH_MAX_TILES (PLACE_BATCH_MAX_QUERIES * 16)
+
+/**
+ * @brief The max number of hits in a single batch, before spots found
+ * in several tiles of the same query are dropped.
+ *
+ * @see spot_find_near_batch
+ */
+#define PLACE_BATCH_MAX_HITS (PLACE_BATCH_MAX_QUERIES * 64)
+
+/**
+ * @brief An index handle to a spot.
+ */
+typedef size_t spot_handle_t;
+
+/**
+ * @brief A compact index to a spot, for storing in tables.
+ *
+ * The narrowest unsigned type holding every index below MAX_SPOTS,
+ * with the all-ones value left over as SPOT_INDEX_NONE. Handles are
+ * still passed around as spot_handle_t; narrow them with spot_index.
+ */
+#if MAX_SPOTS < 0xFF
+typedef unsigned char spot_index_t;
+#elif MAX_SPOTS < 0xFFFF
+typedef unsigned short spot_index_t;
+#else
+typedef unsigned int spot_index_t;
+#endif
+
+/**
+ * @brief Denotes the absence of a spot, in a spot_index_t.
+ */
+#define SPOT_INDEX_NONE ((spot_index_t) -1)
+
 /**
  * @brief A tile subdivision of a spotmap.
  *
@@ -91,7 +230,7 @@ struct spotmap_tile_t {
     /**
      * @brief Spots linked to in this spotmap tile.
      */
-    size_t spots[MAX_SPOTS_PER_TILE];
+    spot_index_t spots[MAX_SPOTS_PER_TILE];
 
     /**
      * @brief The number of spots in this spotmap tile.
@@ -129,15 +268,160 @@ struct spotmap_t {
     struct spotmap_bucket_t buckets[NUM_SPOT_BUCKETS_PER_MAP];
 };
 
+/**
+ * @brief A spot in the Morton-ordered spot array.
+ */
+struct place_morton_entry_t {
+    /**
+     * @brief The Morton (Z-order) key of the spot's tile.
+     *
+     * The bits of the tile's X and Y coordinates, interleaved, so that
+     * nearby tiles tend to have nearby keys.
+     */
+    unsigned int key;
+
+    /**
+     * @brief The spot itself.
+     */
+    spot_index_t spot;
+};
+
+/**
+ * @brief A node of the spot KD-tree.
+ */
+struct place_kd_node_t {
+    /**
+     * @brief X coordinate of the spot, copied for locality.
+     */
+    float x;
+
+    /**
+     * @brief Y coordinate of the spot, copied for locality.
+     */
+    float y;
+
+    /**
+     * @brief The spot itself.
+     */
+    spot_index_t spot;
+};
+
+/**
+ * @brief A radius query, as part of a batch.
+ *
+ * @see spot_find_near_batch
+ */
+struct spot_query_t {
+    /**
+     * @brief X location of the center of the query.
+     */
+    float x;
+
+    /**
+     * @brief Y location of the center of the query.
+     */
+    float y;
+
+    /**
+     * @brief The radius of the query.
+     */
+    float radius;
+
+    /**
+     * @brief Where the spots found by this query start in the found array.
+     *
+     * Set by spot_find_near_batch.
+     */
+    size_t first;
+
+    /**
+     * @brief The number of spots found by this query.
+     *
+     * Set by spot_find_near_batch.
+     */
+    size_t num_found;
+};
+
+/**
+ * @brief All spots defined in the world.
+ *
+ * @note Only items up to (place_num_spots - 1) should be iterated.
+ */
+extern struct spot_t place_spots[MAX_SPOTS];
+
 /**
  * @brief The number of all spots defined in the world.
  */
 extern size_t place_num_spots;
 
 /**
- * @brief An index handle to a spot.
+ * @brief Narrows a handle to a spot into a compact index.
+ *
+ * @param spot The handle to narrow.
+ * @return spot_index_t The index, or SPOT_INDEX_NONE if no such spot exists.
  */
-typedef size_t spot_handle_t;
+spot_index_t spot_index(spot_handle_t spot);
+
+/**
+ * @brief All spots, sorted by the Morton key of their tile.
+ *
+ * An immutable alternative to the spotmap, built once all spots are
+ * defined by place_morton_build.
+ *
+ * @note Only items up to (place_morton_num_spots - 1) should be iterated.
+ */
+extern struct place_morton_entry_t place_morton[MAX_SPOTS];
+
+/**
+ * @brief The number of spots in place_morton.
+ */
+extern size_t place_morton_num_spots;
+
+/**
+ * @brief All spots, as a balanced 2D KD-tree embedded in an array.
+ *
+ * The root of any range of this array is its middle item, splitting
+ * it along X at even depths and along Y at odd depths; the items
+ * before the root are its left subtree, and the items after it its
+ * right subtree. No links are stored at all.
+ *
+ * Unlike the spotmap, query costs do not depend on a tile size, and
+ * stay predictable no matter how unevenly spots are spread. Built
+ * once all spots are defined by place_kd_build.
+ *
+ * @note Only items up to (place_kd_num_spots - 1) should be iterated.
+ */
+extern struct place_kd_node_t place_kd[MAX_SPOTS];
+
+/**
+ * @brief The number of spots in place_kd.
+ */
+extern size_t place_kd_num_spots;
+
+/**
+ * @brief The X coordinate of the first tile of the place grid.
+ *
+ * The place grid is a fixed-size square window of spotmap tiles,
+ * PLACE_GRID_WIDTH tiles wide, placed over the part of the map where
+ * spots are. Unlike the spotmap, it can be indexed directly, and is
+ * thus used by any per-tile table that must be looked up in O(1).
+ */
+extern int place_grid_x;
+
+/**
+ * @brief The Y coordinate of the first tile of the place grid.
+ *
+ * @see place_grid_x
+ */
+extern int place_grid_y;
+
+/**
+ * @brief The version of the place grid.
+ *
+ * Bumped every time the place grid is moved. Per-tile tables built
+ * for an older version must be rebuilt.
+ */
+extern unsigned int place_grid_version;
 
 /**
  * @brief Define a new spot.
@@ -156,6 +440,20 @@ spot_handle_t make_spot(float x, float y);
  */
 error_return_t spot_link(spot_handle_t ind_spot, float radius);
 
+/**
+ * @brief Checks whether a spot could be linked, without making it.
+ *
+ * Fails exactly where spot_link would, for a new spot at the same
+ * position; meant for checking before making a spot, since spots can
+ * not be removed.
+ *
+ * @param x X location of the would-be spot.
+ * @param y Y location of the would-be spot.
+ * @param radius The radius around it within which tiles would be linked.
+ * @return error_return_t 0 if it could be linked, an error code otherwise.
+ */
+error_return_t spot_can_link(float x, float y, float radius);
+
 /**
  * @brief Unlinks a spot from all tiles within a radius from it.
  *
@@ -165,4 +463,193 @@ error_return_t spot_link(spot_handle_t ind_spot, float radius);
 error_return_t spot_unlink(spot_handle_t ind_spot, float radius);
 
 
+/**
+ * @brief Finds all spots within a radius from a position, in the spotmap.
+ *
+ * Only finds spots that were linked to the spotmap; see spot_link.
+ *
+ * @param x X location of the center of the query.
+ * @param y Y location of the center of the query.
+ * @param radius The radius of the query.
+ * @param found A pointer to an array in the which to store the spots found.
+ * @param max_found The max number of spots to store in found.
+ * @return size_t The number of spots stored in found.
+ */
+size_t spot_find_near(float x, float y, float radius, spot_handle_t *found, size_t max_found);
+
+/**
+ * @brief Answers a batch of radius queries in the spotmap at once.
+ *
+ * The queries are grouped by the tiles they cover, which are then
+ * walked tile-major: each tile is looked up in the spotmap once, and
+ * each of its spots is tested against every query covering that tile. Queries
+ * close to each other thus share both the lookup and the scan of their
+ * common tiles. Meant for per-tic systems that issue many queries.
+ *
+ * The spots found by each query are stored contiguously in found; see
+ * the first and num_found fields of each query.
+ *
+ * @param queries The queries to answer.
+ * @param num_queries The number of queries, at most PLACE_BATCH_MAX_QUERIES.
+ * @param found A pointer to an array in the which to store the spots found.
+ * @param max_found The max number of spots to store in found, in total.
+ * @return error_return_t 0 if successful, an error code otherwise. If the
+ * queries cover more than PLACE_BATCH_MAX_TILES tiles, or hit more than
+ * PLACE_BATCH_MAX_HITS spots, nothing is found; if they find more than
+ * max_found spots, found is filled up, and ERR_PLACE_BATCH_TOO_LARGE is
+ * returned all the same.
+ */
+error_return_t spot_find_near_batch(struct spot_query_t *queries, size_t num_queries, spot_handle_t *found, size_t max_found);
+
+/**
+ * @brief Gets the spot index level best suited for a query radius.
+ *
+ * Estimates, for each level, how many cells a query of this radius
+ * spans, and what scanning each costs: a fixed cost per cell, plus
+ * the spots chained in its bucket, which are those of the average
+ * occupied cell and those of other cells hashed to the same bucket.
+ * The level with the lowest estimate wins.
+ *
+ * @param radius The radius of the query.
+ * @return int The level.
+ */
+int place_level_for_radius(float radius);
+
+/**
+ * @brief Finds all spots within a radius from a position.
+ *
+ * Every spot is indexed at every level of a multi-resolution spot
+ * index, each a hashed grid of a different cell width; the query is
+ * answered from whichever level suits its radius best. Small radii,
+ * such as pickup ranges, thus test few irrelevant spots, while large
+ * radii, such as industry reaches, still only scan a few cells.
+ *
+ * @param x X location of the center of the query.
+ * @param y Y location of the center of the query.
+ * @param radius The radius of the query.
+ * @param found A pointer to an array in the which to store the spots found.
+ * @param max_found The max number of spots to store in found.
+ * @return size_t The number of spots stored in found.
+ */
+size_t place_find_spots(float x, float y, float radius, spot_handle_t *found, size_t max_found);
+
+/**
+ * @brief Finds all spots within a radius, from a specific level.
+ *
+ * @see place_find_spots
+ *
+ * @param level The spot index level to query.
+ * @param x X location of the center of the query.
+ * @param y Y location of the center of the query.
+ * @param radius The radius of the query.
+ * @param found A pointer to an array in the which to store the spots found.
+ * @param max_found The max number of spots to store in found.
+ * @return size_t The number of spots stored in found.
+ */
+size_t place_find_spots_at_level(int level, float x, float y, float radius, spot_handle_t *found, size_t max_found);
+
+/**
+ * @brief Builds the Morton-ordered spot array.
+ *
+ * Should be called once all spots are defined, after map load. Spots
+ * defined afterwards are left out until it is called again.
+ */
+void place_morton_build(void);
+
+/**
+ * @brief Finds all spots within a rectangle of tiles.
+ *
+ * The rectangle is split into a few contiguous ranges of Morton keys,
+ * each found by binary search in place_morton and then read in order.
+ *
+ * @param min_tile_x X coordinate of the first tile of the rectangle.
+ * @param min_tile_y Y coordinate of the first tile of the rectangle.
+ * @param max_tile_x X coordinate of the last tile of the rectangle.
+ * @param max_tile_y Y coordinate of the last tile of the rectangle.
+ * @param found A pointer to an array in the which to store the spots found.
+ * @param max_found The max number of spots to store in found.
+ * @return size_t The number of spots stored in found.
+ */
+size_t place_morton_find_rect(int min_tile_x, int min_tile_y, int max_tile_x, int max_tile_y, spot_handle_t *found, size_t max_found);
+
+/**
+ * @brief Finds all spots within a radius from a position, in place_morton.
+ *
+ * @param x X location of the center of the query.
+ * @param y Y location of the center of the query.
+ * @param radius The radius of the query.
+ * @param found A pointer to an array in the which to store the spots found.
+ * @param max_found The max number of spots to store in found.
+ * @return size_t The number of spots stored in found.
+ */
+size_t place_morton_find_spots(float x, float y, float radius, spot_handle_t *found, size_t max_found);
+
+/**
+ * @brief Builds the spot KD-tree.
+ *
+ * Should be called once all spots are defined, after map load. Spots
+ * defined afterwards are left out until it is called again.
+ */
+void place_kd_build(void);
+
+/**
+ * @brief Finds the spot nearest to a position, in the KD-tree.
+ *
+ * @param x X location in the world.
+ * @param y Y location in the world.
+ * @return spot_handle_t The nearest spot, or -1 if there are no spots.
+ */
+spot_handle_t place_kd_nearest(float x, float y);
+
+/**
+ * @brief Finds the k spots nearest to a position, in the KD-tree.
+ *
+ * @param x X location in the world.
+ * @param y Y location in the world.
+ * @param k The number of spots to find, at most PLACE_KD_MAX_NEAREST.
+ * @param found A pointer to an array in the which to store the spots found, nearest first.
+ * @return size_t The number of spots stored in found.
+ */
+size_t place_kd_find_nearest(float x, float y, size_t k, spot_handle_t *found);
+
+/**
+ * @brief Finds all spots within a radius from a position, in the KD-tree.
+ *
+ * @param x X location of the center of the query.
+ * @param y Y location of the center of the query.
+ * @param radius The radius of the query.
+ * @param found A pointer to an array in the which to store the spots found.
+ * @param max_found The max number of spots to store in found.
+ * @return size_t The number of spots stored in found.
+ */
+size_t place_kd_find_spots(float x, float y, float radius, spot_handle_t *found, size_t max_found);
+
+/**
+ * @brief Moves the place grid over all spots defined.
+ *
+ * Should be called once all spots are defined, after map load. If the
+ * spots span more than PLACE_GRID_WIDTH tiles, the outermost ones are
+ * left out of the place grid.
+ */
+void place_grid_fit(void);
+
+/**
+ * @brief Gets the place grid index of a tile.
+ *
+ * @param tile_x X coordinate of the tile.
+ * @param tile_y Y coordinate of the tile.
+ * @return int The index of the tile in the place grid, or -1 if outside.
+ */
+int place_grid_tile_index(int tile_x, int tile_y);
+
+/**
+ * @brief Gets the place grid index of the tile under a position.
+ *
+ * @param x X location in the world.
+ * @param y Y location in the world.
+ * @return int The index of the tile in the place grid, or -1 if outside.
+ */
+int place_grid_index(float x, float y);
+
+
 #endif //PLACE_H
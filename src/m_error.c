@@ -16,7 +16,7 @@
 /**
  * @brief The last error value stored from an iferr macro call.
  */
-error_return_t _err;
+M_SIM_STATE error_return_t _err;
 
 
 static const char *const error_strings[] = {
@@ -34,7 +34,33 @@ static const char *const error_strings[] = {
     "Spot index not found in tile for unlinking; probably incorrect" \
         "radius value passed",
     "Too many spots defined",
-    "Invalid cargo type index passed"
+    "Invalid cargo type index passed",
+    "Too many waypoint links from a single spot",
+    "No route exists between the spots passed",
+    "Route has too many waypoints to be stored",
+    "All cached routes are held; cannot store another",
+    "No cached route exists with handle passed",
+    "No vehicle exists with index passed",
+    "Too many vehicles defined",
+    "Vehicle is already moving",
+    "Too many vehicle orders defined",
+    "Too many stations defined",
+    "Station cannot hold any more distinct cargo loads",
+    "No flow field source exists with index passed",
+    "Too many flow field sources defined",
+    "No trap exists with index passed",
+    "Too many traps defined",
+    "Too many spots linked to a single spotmap tile",
+    "Too many industries defined",
+    "Too many spatial queries or hits in a single batch",
+    "No cargo type exists with index passed",
+    "Invalid player number passed",
+    "Industry does not have supplied-cargo type passed",
+    "Too many spotmap tiles in a single spotmap bucket",
+    "Too many cargo types in a single batch",
+    "Trap must process at least one kill every tic",
+    "Origin station does not fit in a cargo load",
+    "Vehicle found no route to its next order; retrying later"
 };
 
 
@@ -23,6 +23,8 @@
 #ifndef ERROR_H
 #define ERROR_H
 
+#include "m_util.h"
+
 /**
  * @brief A list of error codes.
  *
@@ -60,7 +62,33 @@ enum error_code_t {
     ERR_PLACE_BAD_SPOT_INDEX,
     ERR_PLACE_UNLINK_SPOT_NOT_FOUND,
     ERR_PLACE_MAXED_SPOTS,
-    ERR_BAD_MATERIAL
+    ERR_BAD_MATERIAL,
+    ERR_PATH_MAXED_LINKS,
+    ERR_PATH_NO_ROUTE,
+    ERR_PATH_TOO_LONG,
+    ERR_PATH_CACHE_FULL,
+    ERR_PATH_BAD_ROUTE,
+    ERR_VEHICLE_BAD_INDEX,
+    ERR_VEHICLE_MAXED,
+    ERR_VEHICLE_MOVING,
+    ERR_VEHICLE_MAXED_ORDERS,
+    ERR_STATION_MAXED,
+    ERR_STATION_MAXED_LOADS,
+    ERR_FLOW_BAD_SOURCE,
+    ERR_FLOW_MAXED_SOURCES,
+    ERR_TRAP_BAD_INDEX,
+    ERR_TRAP_MAXED,
+    ERR_PLACE_MAXED_TILE_SPOTS,
+    ERR_INDUSTRY_MAXED,
+    ERR_PLACE_BATCH_TOO_LARGE,
+    ERR_CARGO_BAD_TYPE,
+    ERR_COMPANY_BAD_PLAYER,
+    ERR_INDUSTRY_BAD_SUPPLY,
+    ERR_PLACE_MAXED_BUCKET_TILES,
+    ERR_STATION_BATCH_TOO_LARGE,
+    ERR_TRAP_BAD_RATE,
+    ERR_STATION_BAD_ORIGIN,
+    ERR_VEHICLE_STRANDED
 };
 
 /**
@@ -167,7 +195,7 @@ typedef signed int error_return_t;
 /**
  * @brief The last error value stored from an iferr macro call.
  */
-extern error_return_t _err;
+extern M_SIM_STATE error_return_t _err;
 
 /**
  * @brief Prints an error.
@@ -0,0 +1,234 @@
+/**
+ * @file m_trace.c
+ * @author Gustavo Rehermann (rehermann6046@gmail.com)
+ * @brief Recording of simulation API calls.
+ * @version added in 0.1
+ * @date 2021-03-21
+ *
+ * @copyright Copyright (c)Gustavo Ramos Rehermann 2021. The MIT License.
+ */
+
+#include "m_trace.h"
+
+
+const char *const trace_func_names[NUM_TRACE_FUNCS] = {
+    "(tic)",
+    "make_spot",
+    "spot_link",
+    "spot_unlink",
+    "spot_find_near",
+    "place_find_spots",
+    "industry_make",
+    "industry_make_production",
+    "industry_check_production",
+    "industry_accept_cargo",
+    "industry_get_produced",
+    "industry_check_boosts",
+    "industry_end_period",
+    "industry_total_produced",
+    "industry_clear",
+    "station_make",
+    "station_remove",
+    "station_add_cargo",
+    "station_add_cargo_batch",
+    "station_deposit_cargo",
+    "station_merge_inbox",
+    "station_merge_inboxes",
+    "station_find_nearest",
+    "station_get_cargo_amount",
+    "station_visit",
+    "station_age_cargo",
+    "station_age_all_cargo",
+    "company_found_company",
+    "company_add_to_balance",
+    "company_loan",
+    "company_charge_interest",
+};
+
+const char *const trace_func_args[NUM_TRACE_FUNCS] = {
+    "i",        // tic delta
+    "ff",       // x, y
+    "zf",       // spot, radius
+    "zf",       // spot, radius
+    "fffz",     // x, y, radius, max_found
+    "fffz",     // x, y, radius, max_found
+    "zff",      // type, x, y
+    "zf",       // industry, amount
+    "z",        // industry
+    "zzf",      // industry, accept, amount
+    "zz",       // industry, supply
+    "",
+    "",
+    "",
+    "",
+    "z",        // spot
+    "z",        // station
+    "zzif",     // station, cargo type, origin, amount
+    "zinZF",    // station, origin, count, cargo types, amounts
+    "zzif",     // station, cargo type, origin, amount
+    "z",        // station
+    "",
+    "ff",       // x, y
+    "zz",       // station, cargo type
+    "zzzffii",  // station, then the visit: cargo type, origin, amount, capacity, unload, load
+    "zu",       // station, tics
+    "u",        // tics
+    "sf",       // name, initial loan
+    "zf",       // company, amount
+    "zf",       // company, amount
+    "zu",       // company, periods
+};
+
+
+#if defined(DEBUG) && defined(M_TRACE)
+
+#include <stdarg.h>
+#include <stdio.h>
+
+
+static unsigned char trace_buffer[TRACE_LINE_BYTES];
+static int trace_length = 0;
+
+static unsigned int trace_tic = 0;
+
+
+void trace_flush(void) {
+    static const char digits[] = "0123456789abcdef";
+    static char line[TRACE_LINE_BYTES * 2 + 1];
+    int i;
+
+    if (trace_length == 0) {
+        return;
+    }
+
+    for (i = 0; i < trace_length; i++) {
+        line[i * 2] = digits[trace_buffer[i] >> 4];
+        line[i * 2 + 1] = digits[trace_buffer[i] & 15];
+    }
+
+    line[trace_length * 2] = '\0';
+    trace_length = 0;
+
+    printf("TRACE %s\n", line);
+}
+
+static void _trace_byte(unsigned char byte) {
+    if (trace_length == TRACE_LINE_BYTES) {
+        trace_flush();
+    }
+
+    trace_buffer[trace_length++] = byte;
+}
+
+static void _trace_varint(size_t value) {
+    while (value >= 0x80) {
+        _trace_byte((unsigned char) (value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+
+    _trace_byte((unsigned char) value);
+}
+
+static void _trace_zigzag(int value) {
+    _trace_varint(value < 0 ? ((~(unsigned int) value) << 1) | 1 : (unsigned int) value << 1);
+}
+
+static void _trace_float(float value) {
+    union {
+        float f;
+        unsigned int u;
+    } bits;
+    int i;
+
+    bits.f = value;
+
+    for (i = 0; i < 4; i++) {
+        _trace_byte((unsigned char) (bits.u >> (i * 8)));
+    }
+}
+
+void trace_set_tic(unsigned int tic) {
+    if (tic == trace_tic) {
+        return;
+    }
+
+    // print the last tic's calls, so only the current tic's can be lost
+    trace_flush();
+
+    _trace_byte(TRACE_TIC);
+    _trace_zigzag((int) (tic - trace_tic));
+
+    trace_tic = tic;
+}
+
+void trace_record(enum trace_func_t func, ...) {
+    const char *arg;
+    const char *string;
+    const size_t *sizes;
+    const float *floats;
+    size_t count = 0, length, i;
+    va_list args;
+
+    va_start(args, func);
+    _trace_byte((unsigned char) func);
+
+    for (arg = trace_func_args[func]; *arg; arg++) {
+        switch (*arg) {
+            case 'z':
+                _trace_varint(va_arg(args, size_t));
+                break;
+
+            case 'n':
+                count = va_arg(args, size_t);
+                _trace_varint(count);
+                break;
+
+            case 'u':
+                _trace_varint(va_arg(args, unsigned int));
+                break;
+
+            case 'i':
+                _trace_zigzag(va_arg(args, int));
+                break;
+
+            case 'f':
+                _trace_float((float) va_arg(args, double));
+                break;
+
+            case 's':
+                string = va_arg(args, const char *);
+
+                for (length = 0; string[length]; length++);
+
+                _trace_varint(length);
+
+                for (i = 0; i < length; i++) {
+                    _trace_byte((unsigned char) string[i]);
+                }
+
+                break;
+
+            case 'Z':
+                sizes = va_arg(args, const size_t *);
+
+                for (i = 0; i < count; i++) {
+                    _trace_varint(sizes[i]);
+                }
+
+                break;
+
+            case 'F':
+                floats = va_arg(args, const float *);
+
+                for (i = 0; i < count; i++) {
+                    _trace_float(floats[i]);
+                }
+
+                break;
+        }
+    }
+
+    va_end(args);
+}
+
+#endif // DEBUG && M_TRACE
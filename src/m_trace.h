@@ -0,0 +1,161 @@
+/**
+ * @file m_trace.h
+ * @author Gustavo Rehermann (rehermann6046@gmail.com)
+ * @brief Recording of simulation API calls, for replaying them later.
+ * @version added in 0.1
+ * @date 2021-03-21
+ *
+ * Debug builds with M_TRACE defined record every call to the public
+ * simulation functions listed in trace_func_t, along with its arguments
+ * and the tic it was made in, into a compact binary trace. The trace is
+ * printed in chunks, as lines of the form "TRACE <hex bytes>", so it
+ * ends up in the console log along with everything else; the replay
+ * host tool picks those lines out of a log and runs the calls again,
+ * timing each function.
+ *
+ * Everywhere else, trace_call and friends expand to nothing.
+ *
+ * Only the place, industry, station and company modules are traced.
+ * Paths, vehicles, harvest, traps and flow fields are not; their own
+ * calls are not recorded, but the calls they make into the traced
+ * modules are (e.g. the station_visit of an arriving vehicle, or the
+ * make_spot of a new trap), so a replay still times and checks those.
+ *
+ * The tic is set, and the trace flushed, by sim_run_tic, so at most
+ * the calls of the current tic are still waiting to be printed.
+ *
+ * Each record of the trace is a single byte, the trace_func_t of the
+ * call, followed by its arguments, as told by trace_func_args:
+ *
+ *  - 'z', 'u' and 'n': a size_t, an unsigned int and a size_t count of
+ *    items for the arrays after it, as unsigned LEB128 varints; the
+ *    mod's size_t is 32 bits wide, so the replay tool reads a 'z' of
+ *    0xFFFFFFFF back as all ones, whatever its own size_t;
+ *  - 'i': an int, as a zigzag-encoded varint;
+ *  - 'f': a float, as its 4 bytes, least significant first;
+ *  - 's': a string, as a varint length and then its characters;
+ *  - 'Z' and 'F': arrays of size_t and float, of as many items as the
+ *    last 'n', each item encoded as above.
+ *
+ * TRACE_TIC records are not calls: they carry the difference to the
+ * previous tic, as an int, and are only written when it changes.
+ *
+ * @copyright Copyright (c)Gustavo Ramos Rehermann 2021. The MIT License.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+
+
+/**
+ * @brief Every kind of record in a trace.
+ *
+ * New functions must be added at the end, so that older traces can
+ * still be replayed.
+ */
+enum trace_func_t {
+    TRACE_TIC,
+    TRACE_MAKE_SPOT,
+    TRACE_SPOT_LINK,
+    TRACE_SPOT_UNLINK,
+    TRACE_SPOT_FIND_NEAR,
+    TRACE_PLACE_FIND_SPOTS,
+    TRACE_INDUSTRY_MAKE,
+    TRACE_INDUSTRY_MAKE_PRODUCTION,
+    TRACE_INDUSTRY_CHECK_PRODUCTION,
+    TRACE_INDUSTRY_ACCEPT_CARGO,
+    TRACE_INDUSTRY_GET_PRODUCED,
+    TRACE_INDUSTRY_CHECK_BOOSTS,
+    TRACE_INDUSTRY_END_PERIOD,
+    TRACE_INDUSTRY_TOTAL_PRODUCED,
+    TRACE_INDUSTRY_CLEAR,
+    TRACE_STATION_MAKE,
+    TRACE_STATION_REMOVE,
+    TRACE_STATION_ADD_CARGO,
+    TRACE_STATION_ADD_CARGO_BATCH,
+    TRACE_STATION_DEPOSIT_CARGO,
+    TRACE_STATION_MERGE_INBOX,
+    TRACE_STATION_MERGE_INBOXES,
+    TRACE_STATION_FIND_NEAREST,
+    TRACE_STATION_GET_CARGO_AMOUNT,
+    TRACE_STATION_VISIT,
+    TRACE_STATION_AGE_CARGO,
+    TRACE_STATION_AGE_ALL_CARGO,
+    TRACE_COMPANY_FOUND_COMPANY,
+    TRACE_COMPANY_ADD_TO_BALANCE,
+    TRACE_COMPANY_LOAN,
+    TRACE_COMPANY_CHARGE_INTEREST,
+
+    NUM_TRACE_FUNCS
+};
+
+/**
+ * @brief The name of the function of each kind of record.
+ */
+extern const char *const trace_func_names[NUM_TRACE_FUNCS];
+
+/**
+ * @brief The arguments of each kind of record, one letter each.
+ *
+ * See the top of this file for what each letter means. Arguments are
+ * given to trace_call in this same order, which is not always that of
+ * the traced function's own parameters.
+ */
+extern const char *const trace_func_args[NUM_TRACE_FUNCS];
+
+/**
+ * @brief How many bytes of the trace are printed in each line.
+ */
+#define TRACE_LINE_BYTES 32
+
+
+#if defined(DEBUG) && defined(M_TRACE)
+
+/**
+ * @brief Records a call, if tracing is built in.
+ *
+ * Should be called once at the start of a traced function, before any
+ * of its arguments are checked, so that failed calls are replayed too.
+ * Public functions that call other traced ones must go through their
+ * internal versions instead, lest both calls are recorded.
+ */
+#define trace_call(...) trace_record(__VA_ARGS__)
+
+/**
+ * @brief Records a call.
+ *
+ * @param func The kind of call.
+ * @param ... Its arguments, as told by trace_func_args; floats are
+ * promoted to double, and chars to int, as usual.
+ */
+void trace_record(enum trace_func_t func, ...);
+
+/**
+ * @brief Sets the tic of the calls recorded from now on.
+ *
+ * @param tic The current tic.
+ */
+void trace_set_tic(unsigned int tic);
+
+/**
+ * @brief Prints whatever part of the trace was not printed yet.
+ *
+ * The trace is otherwise printed in whole lines only. It is flushed at
+ * every tic change and at the end of sim_run_tic already; call
+ * this before the log is read, e.g. when the map is exited, to print
+ * the calls made since.
+ */
+void trace_flush(void);
+
+#else
+
+#define trace_call(...) ((void) 0)
+#define trace_set_tic(tic) ((void) 0)
+#define trace_flush() ((void) 0)
+
+#endif // DEBUG && M_TRACE
+
+
+#endif // TRACE_H
@@ -0,0 +1,271 @@
+/**
+ * @file m_util.c
+ * @author Gustavo Rehermann (rehermann6046@gmail.com)
+ * @brief Common, miscellaneous utility functions.
+ * @version added in 0.1
+ * @date 2021-03-20
+ *
+ * @copyright Copyright (c)Gustavo Ramos Rehermann 2021. The MIT License.
+ */
+
+#include "m_util.h"
+
+
+unsigned long long dist_sq(int dx, int dy) {
+    const unsigned long long ax = iabs(dx), ay = iabs(dy);
+
+    return ax * ax + ay * ay;
+}
+
+int dist_within(int dx, int dy, int radius) {
+    int ax = iabs(dx), ay = iabs(dy), tmp;
+
+    if (ax < ay) {
+        tmp = ax;
+        ax = ay;
+        ay = tmp;
+    }
+
+    // the longer side is never longer than the exact length
+    if (ax > radius) {
+        return 0;
+    }
+
+    // and the octagonal length never shorter
+    if (ax + ((ay + 1) >> 1) <= radius) {
+        return 1;
+    }
+
+    // ax <= radius here, and ay <= ax, so checking the radius will do
+    if (radius <= DIST_NARROW_MAX) {
+        return ax * ax + ay * ay <= radius * radius;
+    }
+
+    return dist_sq(ax, ay) <= (unsigned long long) radius * radius;
+}
+
+unsigned int isqrt(unsigned int value) {
+    unsigned int root = 0;
+    unsigned int bit = 1u << 30;
+    unsigned int trial, taken;
+
+    while (bit > value) {
+        bit >>= 2;
+    }
+
+    // branchless; whether each bit is set is as good as random
+    while (bit != 0) {
+        trial = root + bit;
+        taken = -(unsigned int) (value >= trial);
+
+        value -= trial & taken;
+        root = (root >> 1) + (bit & taken);
+        bit >>= 2;
+    }
+
+    return root;
+}
+
+int dist_exact(int dx, int dy) {
+    unsigned int ax = iabs(dx), ay = iabs(dy);
+    int shift = 0;
+
+    // scale down until the squares can no longer overflow
+    while (ax > 46340 || ay > 46340 || ax * ax > 0xFFFFFFFFu - ay * ay) {
+        ax >>= 1;
+        ay >>= 1;
+        shift++;
+    }
+
+    return isqrt(ax * ax + ay * ay) << shift;
+}
+
+int dist_octagonal(int dx, int dy) {
+    const int ax = iabs(dx), ay = iabs(dy);
+
+    // half the shorter side is rounded up, to never fall short
+    return ax > ay ? ax + ((ay + 1) >> 1) : ay + ((ax + 1) >> 1);
+}
+
+int dist_approx(int dx, int dy) {
+    const int ax = iabs(dx), ay = iabs(dy);
+    const int big = ax > ay ? ax : ay, small = ax > ay ? ay : ax;
+
+    return (123 * big + 51 * small) >> 7;
+}
+
+fixed_t fixed_mul(fixed_t a, fixed_t b) {
+    const int negative = (a < 0) != (b < 0);
+    const unsigned int ua = a < 0 ? -(unsigned int) a : (unsigned int) a;
+    const unsigned int ub = b < 0 ? -(unsigned int) b : (unsigned int) b;
+    const unsigned int ah = ua >> FIXED_SHIFT, al = ua & (FIXED_ONE - 1);
+    const unsigned int bh = ub >> FIXED_SHIFT, bl = ub & (FIXED_ONE - 1);
+
+    // (ah + al) * (bh + bl), each term shifted into place
+    const unsigned int product = ((ah * bh) << FIXED_SHIFT) + ah * bl + al * bh + ((al * bl + (FIXED_ONE >> 1)) >> FIXED_SHIFT);
+
+    return negative ? -(fixed_t) product : (fixed_t) product;
+}
+
+fixed_t fixed_pow(fixed_t base, unsigned int exponent) {
+    fixed_t result = FIXED_ONE;
+
+    while (exponent != 0) {
+        if (exponent & 1) {
+            result = fixed_mul(result, base);
+        }
+
+        exponent >>= 1;
+
+        if (exponent != 0) {
+            base = fixed_mul(base, base);
+        }
+    }
+
+    return result;
+}
+
+/**
+ * @brief Multiplies two non-negative fixed-point numbers, saturating.
+ *
+ * Rounds just as fixed_mul does, but products that do not fit a
+ * fixed_t come out as the largest fixed_t, rather than wrapping.
+ */
+static fixed_t _fixed_mul_saturate(fixed_t a, fixed_t b) {
+    const unsigned int ah = (unsigned int) a >> FIXED_SHIFT, al = (unsigned int) a & (FIXED_ONE - 1);
+    const unsigned int bh = (unsigned int) b >> FIXED_SHIFT, bl = (unsigned int) b & (FIXED_ONE - 1);
+    unsigned int high, low;
+
+    // the integer parts alone already overflow
+    if (ah != 0 && bh > 0x7FFF / ah) {
+        return 2147483647;
+    }
+
+    high = (ah * bh) << FIXED_SHIFT;
+
+    // each term is below 2^31, so their sum still fits an unsigned int
+    low = ah * bl + al * bh + ((al * bl + (FIXED_ONE >> 1)) >> FIXED_SHIFT);
+
+    return low > 2147483647u - high ? 2147483647 : (fixed_t) (high + low);
+}
+
+/**
+ * @brief Rounds a double to the nearest fixed-point number, saturating.
+ */
+static fixed_t _double_to_fixed(double value) {
+    value = value * FIXED_ONE + 0.5;
+
+    return value >= 2147483647.0 ? 2147483647 : (fixed_t) value;
+}
+
+void decay_table_build(struct decay_table_t *table, fixed_t rate) {
+    // compounded in doubles, since rounding errors would double with
+    // every squaring otherwise; this is only done once per rate
+    double compound = (double) rate / FIXED_ONE;
+    double power = 1.0;
+    int i;
+
+    table->rate = rate;
+
+    for (i = 0; i < DECAY_TABLE_STEPS; i++) {
+        table->steps[i] = _double_to_fixed(power);
+        power *= compound;
+    }
+
+    for (i = 0; i < DECAY_TABLE_BITS; i++) {
+        table->powers[i] = _double_to_fixed(power);
+        power *= power;
+    }
+
+    table->span = _double_to_fixed(power);
+}
+
+fixed_t decay_table_factor(const struct decay_table_t *table, unsigned int steps) {
+    fixed_t factor = table->steps[steps % DECAY_TABLE_STEPS];
+    unsigned int chunks = (steps / DECAY_TABLE_STEPS) % (1 << DECAY_TABLE_BITS);
+    int bit;
+
+    for (bit = 0; chunks != 0; bit++, chunks >>= 1) {
+        if (chunks & 1) {
+            factor = _fixed_mul_saturate(factor, table->powers[bit]);
+        }
+    }
+
+    // rare; longer than the table spans
+    for (steps /= DECAY_TABLE_SPAN; steps > 0 && factor != 0 && factor != 2147483647; steps--) {
+        factor = _fixed_mul_saturate(factor, table->span);
+    }
+
+    return factor;
+}
+
+M_SIM_STATE struct rng_t rng_streams[NUM_RNG_STREAMS];
+
+/**
+ * @brief Scrambles a 32-bit number (lowbias32).
+ */
+static unsigned int _rng_hash(unsigned int x) {
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+
+    return x;
+}
+
+static unsigned int _rng_rotl(unsigned int x, int k) {
+    return (x << k) | (x >> (32 - k));
+}
+
+void rng_seed(struct rng_t *rng, unsigned int seed, unsigned int stream) {
+    int i;
+
+    // the hash is a bijection, so the four words are never all zero
+    for (i = 0; i < 4; i++) {
+        rng->state[i] = _rng_hash(_rng_hash(seed) + 0x9E3779B9u * (stream * 4 + i + 1));
+    }
+}
+
+void rng_seed_streams(unsigned int seed) {
+    int stream;
+
+    for (stream = 0; stream < NUM_RNG_STREAMS; stream++) {
+        rng_seed(&rng_streams[stream], seed, stream);
+    }
+}
+
+unsigned int rng_next(struct rng_t *rng) {
+    unsigned int *const s = rng->state;
+    const unsigned int result = _rng_rotl(s[1] * 5, 7) * 9;
+    const unsigned int t = s[1] << 9;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = _rng_rotl(s[3], 11);
+
+    return result;
+}
+
+unsigned int rng_below(struct rng_t *rng, unsigned int bound) {
+    // the lowest (2^32 % bound) numbers would make some results likelier
+    const unsigned int threshold = -bound % bound;
+    unsigned int value;
+
+    do {
+        value = rng_next(rng);
+    } while (value < threshold);
+
+    return value % bound;
+}
+
+fixed_t rng_fixed(struct rng_t *rng) {
+    return (fixed_t) (rng_next(rng) >> (32 - FIXED_SHIFT));
+}
+
+float rng_unit(struct rng_t *rng) {
+    return (float) (rng_next(rng) >> 8) * (1.0f / 16777216.0f);
+}
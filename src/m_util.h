@@ -12,14 +12,378 @@
 #define UTIL_H
 
 
+/**
+ * @brief Storage class of mutable simulation state.
+ *
+ * Empty in the mod. Host tools that run a whole simulation per thread
+ * build the simulation modules with M_SIM_THREADED defined, which makes
+ * every piece of simulation state marked with this thread-local
+ * instead, so that each thread gets a world of its own.
+ */
+#ifdef M_SIM_THREADED
+#define M_SIM_STATE __thread
+#else
+#define M_SIM_STATE
+#endif
+
+/**
+ * @brief Storage class of simulation tables that tools may tune.
+ *
+ * Constant in the mod. Thread-local and writable with M_SIM_THREADED,
+ * so that each thread can try its own parameters; every thread starts
+ * off with a copy of the table's initial values.
+ */
+#ifdef M_SIM_THREADED
+#define M_SIM_TUNABLE __thread
+#else
+#define M_SIM_TUNABLE const
+#endif
+
+
+/**
+ * @brief Floors a number to an int.
+ *
+ * Unlike a cast, which truncates towards zero, this always rounds
+ * towards negative infinity; e.g. -0.5 becomes -1.
+ */
+#define floorint(a) ( (int) (a) - ((a) < (int) (a)) )
+
 /**
  * @brief A division whose return value is always floored.
  *
  * C's standard division operator truncates the return value towards
  * zero, instead of flooring it toward negative infinity as may be
- * desirable sometimes.
+ * desirable sometimes. The dividend may be an int or a float; the
+ * divisor must be a positive int.
+ */
+#define floordiv(a, b) ( (floorint(a) - (floorint(a) < 0 ? (b) - 1 : 0)) / (b) )
+
+
+// -- Fixed-point geometry
+//
+// Distances in map units, over int deltas, without ever taking a float
+// square root; gdcc has no FPU to take one with, only soft floats.
+
+/**
+ * @brief The largest absolute delta whose square still fits an int
+ * when summed with another.
+ *
+ * Squares of deltas up to this are summed in plain ints; anything
+ * larger is widened to long long first.
+ */
+#define DIST_NARROW_MAX 32767
+
+/**
+ * @brief Gets the absolute value of an int.
+ */
+#define iabs(a) ( (a) < 0 ? -(a) : (a) )
+
+/**
+ * @brief The exact squared length of a delta.
+ *
+ * @param dx The X delta, in map units.
+ * @param dy The Y delta, in map units.
+ * @return unsigned long long dx * dx + dy * dy, which never overflows.
+ */
+unsigned long long dist_sq(int dx, int dy);
+
+/**
+ * @brief Compares the length of a delta to a radius, exactly.
+ *
+ * Deltas and radii up to DIST_NARROW_MAX are compared in plain ints;
+ * either way, a radius of 0 or more is never overflowed. Most pairs
+ * are told apart by cheap bounds (see dist_octagonal) before any
+ * square is taken.
+ *
+ * @param dx The X delta, in map units.
+ * @param dy The Y delta, in map units.
+ * @param radius The radius, in map units.
+ * @return int Whether the delta is no longer than the radius.
+ */
+int dist_within(int dx, int dy, int radius);
+
+/**
+ * @brief The floored square root of an unsigned int.
+ *
+ * Computed bit by bit, with shifts and additions only.
+ */
+unsigned int isqrt(unsigned int value);
+
+/**
+ * @brief The floored length of a delta, exactly.
+ *
+ * Deltas too long for their squares to fit an unsigned int are scaled
+ * down first, by as few bits as needed; lengths over 46340 map units
+ * are thus off by less than 0.01%.
+ *
+ * @param dx The X delta, in map units.
+ * @param dy The Y delta, in map units.
+ * @return int The length of the delta, in map units.
+ */
+int dist_exact(int dx, int dy);
+
+/**
+ * @brief The octagonal length of a delta: the longer side, plus half the shorter.
+ *
+ * Never shorter than the exact length, and at most 11.8% longer
+ * (along a 26.6 degree diagonal), plus a map unit of rounding; so a
+ * delta whose octagonal length is within a radius is surely within it.
+ * Its lower counterpart is the longer side alone, never longer than
+ * the exact length, and at most 29.3% shorter.
+ *
+ * @param dx The X delta, in map units.
+ * @param dy The Y delta, in map units.
+ * @return int The octagonal length of the delta, in map units.
+ */
+int dist_octagonal(int dx, int dy);
+
+/**
+ * @brief The alpha max plus beta min approximate length of a delta.
+ *
+ * (123 * max + 51 * min) / 128, with max and min the longer and
+ * shorter sides. These weights, close to the ideal 0.960 and 0.398,
+ * keep the result from 4.0% below to 4.1% above the exact length, for
+ * lengths of 1024 map units or more; shorter ones may be off by one
+ * more map unit, from rounding. Use it where the length only needs to
+ * be close, such as for payments and heuristics, and dist_within where
+ * a bound must hold exactly.
+ *
+ * @note Deltas must be shorter than 12 million map units, so as not to
+ * overflow.
+ *
+ * @param dx The X delta, in map units.
+ * @param dy The Y delta, in map units.
+ * @return int The approximate length of the delta, in map units.
+ */
+int dist_approx(int dx, int dy);
+
+
+// -- Power-of-two tiles
+
+/**
+ * @brief The tile a coordinate is in, for tiles (1 << shift) map units wide.
+ *
+ * An arithmetic shift, so it floors negative coordinates correctly,
+ * like floordiv, but without a division. The coordinate must be an
+ * int; floor floats with floorint first.
+ */
+#define tile_of(coord, shift) ( (coord) >> (shift) )
+
+/**
+ * @brief The lowest coordinate of a tile, for tiles (1 << shift) map units wide.
+ */
+#define tile_origin(tile, shift) ( (tile) * (1 << (shift)) )
+
+/**
+ * @brief How far a coordinate is into its tile, for tiles (1 << shift) map units wide.
+ *
+ * Always from 0 to (1 << shift) - 1, for negative coordinates too.
+ */
+#define tile_offset(coord, shift) ( (coord) & ((1 << (shift)) - 1) )
+
+
+// -- Fixed-point growth and decay
+//
+// Compounding a rate over many periods or tics takes a pow, which is
+// a long chain of soft float calls under gdcc. These take the rate as
+// a 16.16 fixed-point number instead, and compound it by squaring.
+
+/**
+ * @brief A 16.16 fixed-point number, as in Doom.
+ */
+typedef int fixed_t;
+
+#define FIXED_SHIFT 16
+#define FIXED_ONE   (1 << FIXED_SHIFT)
+
+/**
+ * @brief Converts an int to a fixed-point number.
+ */
+#define int_to_fixed(a) ( (fixed_t) ((a) * FIXED_ONE) )
+
+/**
+ * @brief Multiplies two fixed-point numbers, rounding to nearest.
+ *
+ * Done in 32-bit halves, so no wider type is needed. Either operand
+ * may also be a plain int, e.g. a cargo amount; the result is then of
+ * the same kind.
+ *
+ * @param a The first number.
+ * @param b The second number.
+ * @return fixed_t The product; undefined if it does not fit a fixed_t.
+ */
+fixed_t fixed_mul(fixed_t a, fixed_t b);
+
+/**
+ * @brief Raises a fixed-point number to an int power, by squaring.
+ *
+ * Takes O(log exponent) multiplications, each rounded; each squaring
+ * doubles the relative error of the last, so rates close to 1 drift
+ * over long exponents (about 1% over 100000). Prefer a decay table
+ * for applying the same rate over and over.
+ *
+ * @param base The base.
+ * @param exponent The exponent.
+ * @return fixed_t The power; undefined if it does not fit a fixed_t.
+ */
+fixed_t fixed_pow(fixed_t base, unsigned int exponent);
+
+/**
+ * @brief How many steps of a rate a decay table holds directly.
+ */
+#define DECAY_TABLE_STEPS 16
+
+/**
+ * @brief How many powers of two of DECAY_TABLE_STEPS steps a decay table holds.
+ */
+#define DECAY_TABLE_BITS 12
+
+/**
+ * @brief The number of steps past which a decay table starts over.
+ */
+#define DECAY_TABLE_SPAN (DECAY_TABLE_STEPS << DECAY_TABLE_BITS)
+
+/**
+ * @brief A rate of growth or decay, compounded ahead of time.
+ *
+ * Holds the rate compounded over every step count below
+ * DECAY_TABLE_STEPS, and over DECAY_TABLE_STEPS times every power of
+ * two up to DECAY_TABLE_SPAN; applying it over any number of steps
+ * then takes one multiplication per set bit of the count, and none at
+ * all below DECAY_TABLE_STEPS.
+ */
+struct decay_table_t {
+    /**
+     * @brief The rate the table was built for, per step.
+     */
+    fixed_t rate;
+
+    /**
+     * @brief The rate compounded over n steps, for n below DECAY_TABLE_STEPS.
+     */
+    fixed_t steps[DECAY_TABLE_STEPS];
+
+    /**
+     * @brief The rate compounded over DECAY_TABLE_STEPS << k steps, for each k.
+     */
+    fixed_t powers[DECAY_TABLE_BITS];
+
+    /**
+     * @brief The rate compounded over DECAY_TABLE_SPAN steps.
+     */
+    fixed_t span;
+};
+
+/**
+ * @brief Builds a decay table for a rate.
+ *
+ * The table is compounded in doubles, so that every item of it is
+ * rounded only once; it should thus be built once, ahead of time,
+ * rather than every tic. Items that do not fit a fixed_t saturate.
+ *
+ * @param table The table to build.
+ * @param rate The rate of growth or decay per step; e.g. 1.05 grows 5% a step.
+ */
+void decay_table_build(struct decay_table_t *table, fixed_t rate);
+
+/**
+ * @brief Compounds the rate of a decay table over a number of steps.
+ *
+ * Growth rates soon outgrow a fixed_t; e.g. 5% a step does within
+ * about 213 steps. Factors that do not fit saturate, as in the table.
+ *
+ * @param table The table to use.
+ * @param steps The number of steps.
+ * @return fixed_t The rate, raised to the number of steps.
+ */
+fixed_t decay_table_factor(const struct decay_table_t *table, unsigned int steps);
+
+
+// -- Random numbers
+//
+// xoshiro128**, seeded through a 32-bit integer hash. Only 32-bit
+// unsigned arithmetic is used, so the mod and host tools draw the very
+// same sequences from the same seeds, and a game can be replayed or
+// checked for desyncs anywhere; ZDoom's Random() allows neither.
+
+/**
+ * @brief The independent random number streams of the simulation.
+ *
+ * Each subsystem draws from a stream of its own, so that drawing more
+ * or fewer numbers in one never shifts the sequence of another.
+ */
+enum rng_stream_t {
+    RNG_PLACEMENT,
+    RNG_PRODUCTION,
+    RNG_AI,
+
+    NUM_RNG_STREAMS
+};
+
+/**
+ * @brief The state of a random number generator.
+ */
+struct rng_t {
+    unsigned int state[4];
+};
+
+/**
+ * @brief The generator of each stream.
+ *
+ * @see rng_seed_streams
+ */
+extern M_SIM_STATE struct rng_t rng_streams[NUM_RNG_STREAMS];
+
+/**
+ * @brief Gets the generator of a stream.
+ */
+#define rng_stream(stream) (&rng_streams[(stream)])
+
+/**
+ * @brief Seeds a generator.
+ *
+ * Generators seeded with the same seed but different stream numbers
+ * draw unrelated sequences.
+ *
+ * @param rng The generator to seed.
+ * @param seed The seed.
+ * @param stream The stream number, such as an rng_stream_t.
+ */
+void rng_seed(struct rng_t *rng, unsigned int seed, unsigned int stream);
+
+/**
+ * @brief Seeds every stream in rng_streams from a single seed.
+ *
+ * @param seed The seed, e.g. of the game.
+ */
+void rng_seed_streams(unsigned int seed);
+
+/**
+ * @brief Draws a random 32-bit number.
+ */
+unsigned int rng_next(struct rng_t *rng);
+
+/**
+ * @brief Draws a random number from 0 to bound - 1, without bias.
+ *
+ * @param rng The generator to draw from.
+ * @param bound The number of possible results; must not be 0.
+ * @return unsigned int The number drawn.
+ */
+unsigned int rng_below(struct rng_t *rng, unsigned int bound);
+
+/**
+ * @brief Draws a random fixed-point number from 0 to just under 1.
+ */
+fixed_t rng_fixed(struct rng_t *rng);
+
+/**
+ * @brief Draws a random float from 0 to just under 1.
+ *
+ * Built from 24 random bits, which a float holds exactly, so it is the
+ * same on every target.
  */
-#define floordiv(a, b) ( (int) ((a) > 0 ? (a) : ((a) - (b))) / (b) )
+float rng_unit(struct rng_t *rng);
 
 
 #endif // UTIL_H
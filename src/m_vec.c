@@ -0,0 +1,137 @@
+/**
+ * @file m_vec.c
+ * @author Gustavo Rehermann (rehermann6046@gmail.com)
+ * @brief Scalar and vectorized sweep kernels.
+ * @version added in 0.1
+ * @date 2021-03-20
+ *
+ * @copyright Copyright (c)Gustavo Ramos Rehermann 2021. The MIT License.
+ */
+
+#include "m_vec.h"
+
+#if !defined(M_VEC_SCALAR) && defined(__AVX2__)
+#define M_VEC_AVX2
+#include <immintrin.h>
+#elif !defined(M_VEC_SCALAR) && defined(__SSE2__)
+#define M_VEC_SSE2
+#include <emmintrin.h>
+#endif
+
+
+#if defined(M_VEC_AVX2)
+const char *const vec_path = "avx2";
+#elif defined(M_VEC_SSE2)
+const char *const vec_path = "sse2";
+#else
+const char *const vec_path = "scalar";
+#endif
+
+
+void vec_zero(float *dst, size_t count) {
+    size_t i = 0;
+
+#if defined(M_VEC_AVX2)
+    const __m256 zero = _mm256_setzero_ps();
+
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(dst + i, zero);
+    }
+#elif defined(M_VEC_SSE2)
+    const __m128 zero = _mm_setzero_ps();
+
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(dst + i, zero);
+    }
+#endif
+
+    for (; i < count; i++) {
+        dst[i] = 0.0;
+    }
+}
+
+float vec_sum(const float *src, size_t count) {
+    float total = 0.0;
+    size_t i = 0;
+
+#if defined(M_VEC_AVX2)
+    __m256 lanes_a = _mm256_setzero_ps(), lanes_b = _mm256_setzero_ps();
+    __m128 half;
+
+    // two accumulators, to hide the latency of each addition
+    for (; i + 16 <= count; i += 16) {
+        lanes_a = _mm256_add_ps(lanes_a, _mm256_loadu_ps(src + i));
+        lanes_b = _mm256_add_ps(lanes_b, _mm256_loadu_ps(src + i + 8));
+    }
+
+    lanes_a = _mm256_add_ps(lanes_a, lanes_b);
+    half = _mm_add_ps(_mm256_castps256_ps128(lanes_a), _mm256_extractf128_ps(lanes_a, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+    total = _mm_cvtss_f32(half);
+#elif defined(M_VEC_SSE2)
+    __m128 lanes_a = _mm_setzero_ps(), lanes_b = _mm_setzero_ps();
+
+    for (; i + 8 <= count; i += 8) {
+        lanes_a = _mm_add_ps(lanes_a, _mm_loadu_ps(src + i));
+        lanes_b = _mm_add_ps(lanes_b, _mm_loadu_ps(src + i + 4));
+    }
+
+    lanes_a = _mm_add_ps(lanes_a, lanes_b);
+    lanes_a = _mm_add_ps(lanes_a, _mm_movehl_ps(lanes_a, lanes_a));
+    lanes_a = _mm_add_ss(lanes_a, _mm_shuffle_ps(lanes_a, lanes_a, 1));
+    total = _mm_cvtss_f32(lanes_a);
+#endif
+
+    for (; i < count; i++) {
+        total += src[i];
+    }
+
+    return total;
+}
+
+size_t vec_ge_bits(const float *a, const float *b, unsigned int *bits, size_t count) {
+    size_t i = 0, num_set = 0;
+    unsigned int word;
+    int j;
+
+#if defined(M_VEC_AVX2)
+    for (; i + 32 <= count; i += 32) {
+        word = 0;
+
+        for (j = 0; j < 32; j += 8) {
+            word |= (unsigned int) _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(a + i + j), _mm256_loadu_ps(b + i + j), _CMP_GE_OQ)) << j;
+        }
+
+        bits[i / 32] = word;
+        num_set += __builtin_popcount(word);
+    }
+#elif defined(M_VEC_SSE2)
+    for (; i + 32 <= count; i += 32) {
+        word = 0;
+
+        for (j = 0; j < 32; j += 4) {
+            word |= (unsigned int) _mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(a + i + j), _mm_loadu_ps(b + i + j))) << j;
+        }
+
+        bits[i / 32] = word;
+        num_set += __builtin_popcount(word);
+    }
+#endif
+
+    // whole words at a time, then the last, partial one
+    for (; i < count; i += 32) {
+        word = 0;
+
+        for (j = 0; j < 32 && i + j < count; j++) {
+            if (a[i + j] >= b[i + j]) {
+                word |= 1u << j;
+                num_set++;
+            }
+        }
+
+        bits[i / 32] = word;
+    }
+
+    return num_set;
+}
@@ -0,0 +1,67 @@
+/**
+ * @file m_vec.h
+ * @author Gustavo Rehermann (rehermann6046@gmail.com)
+ * @brief Sweeps over plain arrays of floats.
+ * @version added in 0.1
+ * @date 2021-03-20
+ *
+ * Kernels for the few sweeps the simulation makes over every industry
+ * at once, kept over flat arrays so that they can be vectorized.
+ *
+ * In the mod, and wherever M_VEC_SCALAR is defined, all kernels are
+ * plain loops. Host builds use AVX2 or SSE2 instead, whichever the
+ * compiler targets (e.g. with -march=native); vec_path tells which.
+ *
+ * @copyright Copyright (c)Gustavo Ramos Rehermann 2021. The MIT License.
+ */
+
+#ifndef VEC_H
+#define VEC_H
+
+#include <stddef.h>
+
+
+/**
+ * @brief The name of the kernels in use: "avx2", "sse2" or "scalar".
+ */
+extern const char *const vec_path;
+
+/**
+ * @brief Sets every item of an array to zero.
+ *
+ * @param dst The array to clear.
+ * @param count The number of items in the array.
+ */
+void vec_zero(float *dst, size_t count);
+
+/**
+ * @brief Sums up every item of an array.
+ *
+ * @note The vectorized kernels add items up in a different order than
+ * the scalar one, so the last bits of the result may differ between
+ * builds.
+ *
+ * @param src The array to sum up.
+ * @param count The number of items in the array.
+ * @return float The sum of all items.
+ */
+float vec_sum(const float *src, size_t count);
+
+/**
+ * @brief Compares two arrays, item by item, into a bit set.
+ *
+ * Bit i of the set, that is, bit (i % 32) of word (i / 32), is set if
+ * item i of the first array is no less than item i of the second, and
+ * cleared otherwise. Bits past the last item, up to the end of the
+ * last word, are cleared.
+ *
+ * @param a The first array.
+ * @param b The second array.
+ * @param bits The bit set, of at least (count + 31) / 32 words.
+ * @param count The number of items in either array.
+ * @return size_t The number of bits set.
+ */
+size_t vec_ge_bits(const float *a, const float *b, unsigned int *bits, size_t count);
+
+
+#endif // VEC_H
@@ -0,0 +1,484 @@
+/**
+ * @file balance.c
+ * @author Gustavo Rehermann (rehermann6046@gmail.com)
+ * @brief Monte Carlo balancing sweep of the industry types.
+ * @version added in 0.1
+ * @date 2021-03-19
+ *
+ * A host program, not part of the mod itself. Runs many headless
+ * simulations of the production chain, each with a small world of
+ * industries fed random, bursty deliveries of raw cargo, and with all
+ * produced cargo carried on (with some loss) to industries accepting
+ * it. Every configuration perturbs the weights, boost rates and boost
+ * thresholds of industry_types by a random amount; configuration 0 is
+ * left untouched, as the reference.
+ *
+ * Runs are spread over a pool of threads, each simulating a world of
+ * its own (h_industry is built with M_SIM_THREADED), and idle threads
+ * steal half of the remaining runs of the busiest one. Every run has
+ * a seed of its own, derived from its index, and results are gathered
+ * in run order, so the report is the same for any number of threads.
+ *
+ * @copyright Copyright (c)Gustavo Ramos Rehermann 2021. The MIT License.
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "h_industry.h"
+#include "m_util.h"
+
+
+#define MAX_WORKERS 64
+#define MAX_CONFIGS 1024
+
+/**
+ * @brief The number of industries of each type in a simulated world.
+ */
+#define COPIES_PER_TYPE 2
+
+/**
+ * @brief The length of every simulation, in periods.
+ */
+#define NUM_PERIODS 64
+
+/**
+ * @brief The number of raw cargo deliveries in every period.
+ */
+#define DELIVERIES_PER_PERIOD 8
+
+/**
+ * @brief The mean amount of a raw cargo delivery, in Cargo Units.
+ */
+#define DELIVERY_MEAN 40.0
+
+/**
+ * @brief The least share of produced cargo that gets transported on.
+ */
+#define MIN_TRANSPORTED 0.6
+
+
+/**
+ * @brief What a single run ended up with.
+ */
+struct run_result_t {
+    /**
+     * @brief Cargo produced that no industry accepts, in Cargo Units.
+     */
+    double output;
+
+    /**
+     * @brief All cargo produced, in Cargo Units.
+     */
+    double produced;
+
+    /**
+     * @brief The number of industry periods without any production.
+     */
+    int idle;
+};
+
+/**
+ * @brief A worker thread, and the runs it has left to do.
+ *
+ * next and end may only be touched with lock held, by the worker
+ * itself or by another one stealing from it.
+ */
+struct worker_t {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    size_t next, end;
+    size_t done, steals;
+};
+
+static struct worker_t workers[MAX_WORKERS];
+static int num_workers;
+
+static struct run_result_t *results;
+static int num_configs, runs_per_config;
+static float spread;
+static unsigned int base_seed = 0x5B6A7988;
+
+/**
+ * @brief The pristine tables, as copied before any perturbation.
+ */
+static struct industry_type_t initial_types[MAX_INDUS_TYPES];
+static struct industry_mat_t initial_mats[MAX_INDUS_TYPES * 8];
+static int num_types, num_mats;
+
+/**
+ * @brief Cargo accepted by some industry type, but supplied by none.
+ */
+static cargo_handle_t raw_cargos[MAX_CARGO_TYPES];
+static int num_raw_cargos;
+
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Whether an item of industry_mats is a supplied cargo.
+ */
+static int is_supply(int mat) {
+    int i;
+
+    for (i = 0; i < num_types; i++) {
+        if (mat >= industry_types[i].first_supply && mat < industry_types[i].first_supply + industry_types[i].num_supplies) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Sets this thread's tables to those of a configuration.
+ */
+static void apply_config(int config) {
+    struct rng_t rng;
+    int i;
+
+    memcpy(industry_types, initial_types, sizeof(initial_types));
+    memcpy(industry_mats, initial_mats, num_mats * sizeof(*initial_mats));
+
+    if (config == 0) {
+        return;
+    }
+
+    // a stream of this tool's own, past those of the simulation
+    rng_seed(&rng, base_seed + config, NUM_RNG_STREAMS);
+
+    for (i = 0; i < num_types; i++) {
+        industry_types[i].boost_rate *= 1.0 + spread * (2.0 * rng_unit(&rng) - 1.0);
+        industry_types[i].boost_threshold *= 1.0 + spread * (2.0 * rng_unit(&rng) - 1.0);
+    }
+
+    for (i = 0; i < num_mats; i++) {
+        industry_mats[i].weight *= 1.0 + spread * (2.0 * rng_unit(&rng) - 1.0);
+    }
+}
+
+/**
+ * @brief Every industry accepting each cargo type, and at which slot.
+ *
+ * The same in every run, as every world is laid out alike.
+ */
+static industry_handle_t acceptors[MAX_CARGO_TYPES][MAX_INDUSTRIES];
+static int acceptor_slots[MAX_CARGO_TYPES][MAX_INDUSTRIES];
+static int num_acceptors[MAX_CARGO_TYPES];
+
+/**
+ * @brief Delivers cargo to a random industry accepting it.
+ *
+ * @return int 1 if delivered, 0 if no industry accepts it.
+ */
+static int deliver(cargo_handle_t cargo, float amount, struct rng_t *rng) {
+    const struct industry_type_t *indtype;
+    int i;
+
+    if (num_acceptors[cargo] == 0) {
+        return 0;
+    }
+
+    i = rng_below(rng, num_acceptors[cargo]);
+    indtype = &industry_types[acceptors[cargo][i] / COPIES_PER_TYPE];
+
+    industry_accept_cargo(acceptors[cargo][i], acceptor_slots[cargo][i], amount * industry_mats[indtype->first_accept + acceptor_slots[cargo][i]].weight);
+
+    return 1;
+}
+
+/**
+ * @brief Simulates a single run.
+ */
+static void simulate(size_t run) {
+    static __thread float last_produced[MAX_INDUS_SLOTS];
+    struct run_result_t *const result = &results[run];
+    const struct industry_type_t *indtype;
+    struct rng_t rng;
+    int period, delivery, slot, i, j, any;
+    float amount, delta;
+
+    industry_clear();
+    rng_seed(&rng, base_seed + run, RNG_PRODUCTION);
+
+    for (i = 0; i < num_types * COPIES_PER_TYPE; i++) {
+        industry_make(i / COPIES_PER_TYPE, 0.0, 0.0);
+    }
+
+    for (i = 0; i < MAX_INDUS_SLOTS; i++) {
+        last_produced[i] = 0.0;
+    }
+
+    result->output = 0.0;
+    result->produced = 0.0;
+    result->idle = 0;
+
+    for (period = 0; period < NUM_PERIODS; period++) {
+        for (delivery = 0; delivery < DELIVERIES_PER_PERIOD; delivery++) {
+            // bursty: exponentially distributed amounts
+            amount = -DELIVERY_MEAN * log(1.0 - rng_unit(&rng));
+            deliver(raw_cargos[rng_below(&rng, num_raw_cargos)], amount, &rng);
+        }
+
+        // carry all cargo produced this period on, in industry order
+        for (i = 0, slot = 0; i < num_industries; i++) {
+            indtype = &industry_types[i / COPIES_PER_TYPE];
+
+            if (indtype->supply_type == ISUPTYPE_BOOST) {
+                industry_check_production(i);
+            }
+
+            any = 0;
+
+            for (j = 0; j < indtype->num_supplies; j++, slot++) {
+                industry_get_produced(i, j, &amount);
+
+                delta = amount - last_produced[slot];
+                last_produced[slot] = amount;
+
+                if (delta <= 0.0) {
+                    continue;
+                }
+
+                any = 1;
+                result->produced += delta;
+                delta *= MIN_TRANSPORTED + (1.0 - MIN_TRANSPORTED) * rng_unit(&rng);
+
+                if (!deliver(industry_mats[indtype->first_supply + j].cargo, delta, &rng)) {
+                    result->output += delta;
+                }
+            }
+
+            if (!any) {
+                result->idle++;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Takes the next run off a worker, or steals some if it has none.
+ *
+ * @return int 1 if a run was taken, 0 if there are none left at all.
+ */
+static int take_run(struct worker_t *self, size_t *run) {
+    struct worker_t *victim;
+    size_t remaining, best, mid;
+    int i;
+
+    for (;;) {
+        pthread_mutex_lock(&self->lock);
+
+        if (self->next < self->end) {
+            *run = self->next++;
+            pthread_mutex_unlock(&self->lock);
+
+            return 1;
+        }
+
+        pthread_mutex_unlock(&self->lock);
+
+        // steal the upper half of the busiest worker's runs
+        victim = NULL;
+        best = 0;
+
+        for (i = 0; i < num_workers; i++) {
+            pthread_mutex_lock(&workers[i].lock);
+            remaining = workers[i].end - workers[i].next;
+            pthread_mutex_unlock(&workers[i].lock);
+
+            if (remaining > best) {
+                best = remaining;
+                victim = &workers[i];
+            }
+        }
+
+        if (victim == NULL) {
+            return 0;
+        }
+
+        pthread_mutex_lock(&victim->lock);
+
+        if (victim->next >= victim->end) {
+            // beaten to it; look again
+            pthread_mutex_unlock(&victim->lock);
+            continue;
+        }
+
+        mid = victim->next + (victim->end - victim->next) / 2;
+        *run = mid;
+
+        pthread_mutex_lock(&self->lock);
+        self->next = mid + 1;
+        self->end = victim->end;
+        pthread_mutex_unlock(&self->lock);
+
+        victim->end = mid;
+        pthread_mutex_unlock(&victim->lock);
+
+        self->steals++;
+
+        return 1;
+    }
+}
+
+static void *work(void *arg) {
+    struct worker_t *const self = arg;
+    int config = -1;
+    size_t run;
+
+    while (take_run(self, &run)) {
+        if ((int) (run / runs_per_config) != config) {
+            config = run / runs_per_config;
+            apply_config(config);
+        }
+
+        simulate(run);
+        self->done++;
+    }
+
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    const long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t num_runs, run;
+    double start, elapsed, mean, var, produced, best_mean = 0.0;
+    int config, best = 0, i, j;
+
+    num_configs = argc > 1 ? atoi(argv[1]) : 64;
+    runs_per_config = argc > 2 ? atoi(argv[2]) : 256;
+    num_workers = argc > 3 ? atoi(argv[3]) : (int) num_cpus;
+    spread = argc > 4 ? atof(argv[4]) : 0.25;
+
+    if (num_configs < 1 || num_configs > MAX_CONFIGS || runs_per_config < 1 || num_workers < 1 || num_workers > MAX_WORKERS) {
+        fprintf(stderr, "usage: %s [configs (1-%d)] [runs per config] [threads (1-%d)] [spread]\n", argv[0], MAX_CONFIGS, MAX_WORKERS);
+        return 1;
+    }
+
+    // this thread's tables still hold their initial values
+    for (num_types = 0; num_types < MAX_INDUS_TYPES && industry_types[num_types].supply_type != ISUPTYPE_UNKNOWN; num_types++) {
+        initial_types[num_types] = industry_types[num_types];
+
+        if (industry_types[num_types].first_supply + industry_types[num_types].num_supplies > num_mats) {
+            num_mats = industry_types[num_types].first_supply + industry_types[num_types].num_supplies;
+        }
+    }
+
+    memcpy(initial_mats, industry_mats, num_mats * sizeof(*initial_mats));
+
+    for (i = 0; i < num_types * COPIES_PER_TYPE; i++) {
+        const struct industry_type_t *const indtype = &industry_types[i / COPIES_PER_TYPE];
+
+        for (j = 0; j < indtype->num_accepts; j++) {
+            const cargo_handle_t cargo = industry_mats[indtype->first_accept + j].cargo;
+            int k, supplied = 0;
+
+            acceptors[cargo][num_acceptors[cargo]] = i;
+            acceptor_slots[cargo][num_acceptors[cargo]++] = j;
+
+            for (k = 0; k < num_mats; k++) {
+                supplied |= industry_mats[k].cargo == cargo && is_supply(k);
+            }
+
+            for (k = 0; k < num_raw_cargos && raw_cargos[k] != cargo; k++);
+
+            if (!supplied && k == num_raw_cargos) {
+                raw_cargos[num_raw_cargos++] = cargo;
+            }
+        }
+    }
+
+    num_runs = (size_t) num_configs * runs_per_config;
+    results = calloc(num_runs, sizeof(*results));
+
+    for (i = 0; i < num_workers; i++) {
+        pthread_mutex_init(&workers[i].lock, NULL);
+        workers[i].next = num_runs * i / num_workers;
+        workers[i].end = num_runs * (i + 1) / num_workers;
+    }
+
+    start = now();
+
+    for (i = 0; i < num_workers; i++) {
+        pthread_create(&workers[i].thread, NULL, work, &workers[i]);
+    }
+
+    for (i = 0; i < num_workers; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    elapsed = now() - start;
+
+    printf("%zu runs of %d periods, %d configs, spread %.2f, %d threads: %.2f s, %.0f runs/s\n\n",
+        num_runs, NUM_PERIODS, num_configs, spread, num_workers, elapsed, num_runs / elapsed);
+
+    printf("%6s  %12s  %10s  %12s  %6s\n", "config", "output", "stddev", "produced", "idle");
+
+    for (config = 0; config < num_configs; config++) {
+        mean = var = produced = 0.0;
+        j = 0;
+
+        for (run = (size_t) config * runs_per_config; run < (size_t) (config + 1) * runs_per_config; run++) {
+            mean += results[run].output;
+            produced += results[run].produced;
+            j += results[run].idle;
+        }
+
+        mean /= runs_per_config;
+        produced /= runs_per_config;
+
+        for (run = (size_t) config * runs_per_config; run < (size_t) (config + 1) * runs_per_config; run++) {
+            var += (results[run].output - mean) * (results[run].output - mean);
+        }
+
+        printf("%6d  %12.1f  %10.1f  %12.1f  %5.1f%%\n", config, mean, sqrt(var / runs_per_config), produced,
+            100.0 * j / ((double) runs_per_config * NUM_PERIODS * num_types * COPIES_PER_TYPE));
+
+        if (config == 0 || mean > best_mean) {
+            best = config;
+            best_mean = mean;
+        }
+    }
+
+    apply_config(best);
+
+    printf("\nbest config %d:\n", best);
+
+    for (i = 0; i < num_types; i++) {
+        printf("  %-24s boost %5.2f over %6.2f, accepts", industry_types[i].label, industry_types[i].boost_rate, industry_types[i].boost_threshold);
+
+        for (j = 0; j < industry_types[i].num_accepts; j++) {
+            printf(" %.2f", industry_mats[industry_types[i].first_accept + j].weight);
+        }
+
+        printf(", supplies");
+
+        for (j = 0; j < industry_types[i].num_supplies; j++) {
+            printf(" %.2f", industry_mats[industry_types[i].first_supply + j].weight);
+        }
+
+        printf("\n");
+    }
+
+    printf("\nsteals:");
+
+    for (i = 0; i < num_workers; i++) {
+        printf(" %zu", workers[i].steals);
+    }
+
+    printf("\n");
+
+    return 0;
+}
@@ -0,0 +1,215 @@
+/**
+ * @file bench_geom.c
+ * @author Gustavo Rehermann (rehermann6046@gmail.com)
+ * @brief Benchmark of the fixed-point geometry of m_util.
+ * @version added in 0.1
+ * @date 2021-03-20
+ *
+ * A host program, not part of the mod itself. Times the int distance
+ * functions and tile helpers of m_util against the float code they
+ * stand in for, over random deltas as long as industry reaches and
+ * vehicle trips, and measures the actual error of each approximation.
+ *
+ * On the host, floats are as fast as ints, so this mostly shows the
+ * int versions cost no more; in the mod, every float operation is a
+ * soft float call, and the int versions avoid them altogether.
+ *
+ * @copyright Copyright (c)Gustavo Ramos Rehermann 2021. The MIT License.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "m_util.h"
+
+
+#define NUM_DELTAS 4096
+#define NUM_RUNS 2000
+
+
+static int delta_x[NUM_DELTAS], delta_y[NUM_DELTAS], radii[NUM_DELTAS];
+static float delta_fx[NUM_DELTAS], delta_fy[NUM_DELTAS], fradii[NUM_DELTAS];
+
+/**
+ * @brief Keeps results alive, so that no timed work is optimized out.
+ */
+static volatile int sink;
+
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Fills the deltas, up to a max length along either axis.
+ */
+static void make_deltas(int max_length) {
+    int i;
+
+    for (i = 0; i < NUM_DELTAS; i++) {
+        delta_x[i] = rand() % (2 * max_length + 1) - max_length;
+        delta_y[i] = rand() % (2 * max_length + 1) - max_length;
+        radii[i] = rand() % (max_length + 1);
+
+        delta_fx[i] = delta_x[i];
+        delta_fy[i] = delta_y[i];
+        fradii[i] = radii[i];
+    }
+}
+
+static void report(const char *label, double float_time, double int_time) {
+    const double scale = 1e9 / NUM_RUNS / NUM_DELTAS;
+
+    printf("  %-22s  %10.2f  %10.2f  %7.2fx\n", label, float_time * scale, int_time * scale, float_time / int_time);
+}
+
+static void bench(int max_length) {
+    double start, float_time;
+    int run, i, total;
+
+    make_deltas(max_length);
+
+    printf("deltas up to %d map units\n", max_length);
+    printf("  %-22s  %10s  %10s  %8s\n", "", "float ns", "int ns", "speedup");
+
+    // reach checks
+    start = now();
+
+    for (run = 0; run < NUM_RUNS; run++) {
+        for (total = 0, i = 0; i < NUM_DELTAS; i++) {
+            total += delta_fx[i] * delta_fx[i] + delta_fy[i] * delta_fy[i] <= fradii[i] * fradii[i];
+        }
+
+        sink = total;
+    }
+
+    float_time = now() - start;
+    start = now();
+
+    for (run = 0; run < NUM_RUNS; run++) {
+        for (total = 0, i = 0; i < NUM_DELTAS; i++) {
+            total += dist_within(delta_x[i], delta_y[i], radii[i]);
+        }
+
+        sink = total;
+    }
+
+    report("within radius", float_time, now() - start);
+
+    // lengths, exact and approximate, all against a float square root
+    start = now();
+
+    for (run = 0; run < NUM_RUNS; run++) {
+        for (total = 0, i = 0; i < NUM_DELTAS; i++) {
+            total += (int) sqrtf(delta_fx[i] * delta_fx[i] + delta_fy[i] * delta_fy[i]);
+        }
+
+        sink = total;
+    }
+
+    float_time = now() - start;
+    start = now();
+
+    for (run = 0; run < NUM_RUNS; run++) {
+        for (total = 0, i = 0; i < NUM_DELTAS; i++) {
+            total += dist_exact(delta_x[i], delta_y[i]);
+        }
+
+        sink = total;
+    }
+
+    report("length (exact)", float_time, now() - start);
+    start = now();
+
+    for (run = 0; run < NUM_RUNS; run++) {
+        for (total = 0, i = 0; i < NUM_DELTAS; i++) {
+            total += dist_approx(delta_x[i], delta_y[i]);
+        }
+
+        sink = total;
+    }
+
+    report("length (approx)", float_time, now() - start);
+    start = now();
+
+    for (run = 0; run < NUM_RUNS; run++) {
+        for (total = 0, i = 0; i < NUM_DELTAS; i++) {
+            total += dist_octagonal(delta_x[i], delta_y[i]);
+        }
+
+        sink = total;
+    }
+
+    report("length (octagonal)", float_time, now() - start);
+
+    // tiles, against flooring a float division
+    start = now();
+
+    for (run = 0; run < NUM_RUNS; run++) {
+        for (total = 0, i = 0; i < NUM_DELTAS; i++) {
+            total += (int) floorf(delta_fx[i] / 1024.0f);
+        }
+
+        sink = total;
+    }
+
+    float_time = now() - start;
+    start = now();
+
+    for (run = 0; run < NUM_RUNS; run++) {
+        for (total = 0, i = 0; i < NUM_DELTAS; i++) {
+            total += tile_of(delta_x[i], 10);
+        }
+
+        sink = total;
+    }
+
+    report("tile of coordinate", float_time, now() - start);
+    printf("\n");
+}
+
+/**
+ * @brief Measures the error of the approximate lengths, over a grid of deltas.
+ */
+static void measure_error(void) {
+    double exact, ratio, approx_low = 1.0, approx_high = 1.0, octa_low = 1.0, octa_high = 1.0;
+    int dx, dy;
+
+    for (dx = 0; dx <= 8192; dx += 3) {
+        for (dy = 0; dy <= 8192; dy += 5) {
+            exact = sqrt((double) dx * dx + (double) dy * dy);
+
+            if (exact < 1024.0) {
+                continue;
+            }
+
+            ratio = dist_approx(dx, dy) / exact;
+            approx_low = ratio < approx_low ? ratio : approx_low;
+            approx_high = ratio > approx_high ? ratio : approx_high;
+
+            ratio = dist_octagonal(dx, dy) / exact;
+            octa_low = ratio < octa_low ? ratio : octa_low;
+            octa_high = ratio > octa_high ? ratio : octa_high;
+        }
+    }
+
+    printf("error, for lengths of 1024 map units or more:\n");
+    printf("  approx     %+6.2f%% to %+6.2f%%\n", (approx_low - 1.0) * 100, (approx_high - 1.0) * 100);
+    printf("  octagonal  %+6.2f%% to %+6.2f%%\n", (octa_low - 1.0) * 100, (octa_high - 1.0) * 100);
+}
+
+int main(void) {
+    srand(1);
+
+    bench(1200);
+    bench(60000);
+    measure_error();
+
+    return 0;
+}
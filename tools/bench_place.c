@@ -0,0 +1,277 @@
+/**
+ * @file bench_place.c
+ * @author Gustavo Rehermann (rehermann6046@gmail.com)
+ * @brief Benchmark of the spot indices.
+ * @version added in 0.1
+ * @date 2021-03-18
+ *
+ * A host program, not part of the mod itself. Fills the world with
+ * clustered spots, then times radius queries against every level of
+ * the multi-resolution spot index, against the level place_find_spots
+ * picks, and against the spotmap, the Morton-ordered spot array and
+ * the spot KD-tree, for a few realistic radius distributions. Spotmap
+ * queries are also timed in batches, as per-tic systems issue them.
+ * Both need every spot linked into the spotmap; build.ninja gives the
+ * clustered world enough MAX_SPOTS_PER_TILE for that, and the benchmark
+ * fails if any spot is left out.
+ *
+ * @copyright Copyright (c)Gustavo Ramos Rehermann 2021. The MIT License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "i_place.h"
+
+
+#define NUM_QUERIES 200000
+#define NUM_RUNS 5
+#define NUM_CLUSTERS 24
+
+/**
+ * @brief Query methods other than a specific level.
+ */
+#define METHOD_PICKED  -1
+#define METHOD_SPOTMAP -2
+#define METHOD_MORTON  -3
+#define METHOD_KD      -4
+#define METHOD_BATCH   -5
+
+/**
+ * @brief The number of queries batched together, as a tic would.
+ */
+#define BATCH_SIZE 64
+
+
+/**
+ * @brief A distribution of query radii.
+ */
+struct radius_mix_t {
+    const char *label;
+    int num_radii;
+    float radii[8];
+};
+
+static const struct radius_mix_t mixes[] = {
+    // pickup and drop ranges
+    { "pickup (64-256)", 4, { 64.0, 96.0, 128.0, 256.0 } },
+
+    // industry reaches, weighted as in industry_types
+    { "reach (512-1200)", 8, { 512.0, 512.0, 512.0, 512.0, 600.0, 700.0, 768.0, 1200.0 } },
+
+    // both, as a tic would issue them
+    { "mixed", 8, { 64.0, 128.0, 256.0, 512.0, 512.0, 768.0, 1200.0, 96.0 } }
+};
+
+
+static float query_x[NUM_QUERIES], query_y[NUM_QUERIES];
+
+
+static float frand(void) {
+    return (float) rand() / RAND_MAX;
+}
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Fills the world with spots.
+ *
+ * @return int Whether all spots fit in the spotmap.
+ */
+static int make_world(float world_width, int clustered) {
+    float cluster_x[NUM_CLUSTERS], cluster_y[NUM_CLUSTERS];
+    int i, fits = 1;
+
+    for (i = 0; i < NUM_CLUSTERS; i++) {
+        cluster_x[i] = (frand() - 0.5) * world_width;
+        cluster_y[i] = (frand() - 0.5) * world_width;
+    }
+
+    // most spots gather around a few clusters, like rooms in a map
+    for (i = 0; i < MAX_SPOTS; i++) {
+        if (!clustered || i % 4 == 0) {
+            make_spot((frand() - 0.5) * world_width, (frand() - 0.5) * world_width);
+        }
+
+        else {
+            make_spot(cluster_x[i % NUM_CLUSTERS] + (frand() - 0.5) * 2048.0, cluster_y[i % NUM_CLUSTERS] + (frand() - 0.5) * 2048.0);
+        }
+
+        if (spot_link(i, 0.0) < 0) {
+            fits = 0;
+        }
+    }
+
+    place_morton_build();
+    place_kd_build();
+
+    return fits;
+}
+
+static size_t bench_batch(const struct radius_mix_t *mix, int first) {
+    static struct spot_query_t queries[BATCH_SIZE];
+    static spot_handle_t found[BATCH_SIZE * MAX_SPOTS];
+    size_t total = 0;
+    int i;
+
+    for (i = 0; i < BATCH_SIZE; i++) {
+        queries[i].x = query_x[first + i];
+        queries[i].y = query_y[first + i];
+        queries[i].radius = mix->radii[(first + i) % mix->num_radii];
+    }
+
+    if (spot_find_near_batch(queries, BATCH_SIZE, found, BATCH_SIZE * MAX_SPOTS) < 0) {
+        return 0;
+    }
+
+    for (i = 0; i < BATCH_SIZE; i++) {
+        total += queries[i].num_found;
+    }
+
+    return total;
+}
+
+static double bench_once(const struct radius_mix_t *mix, int method, size_t *total) {
+    static spot_handle_t found[MAX_SPOTS];
+    const double start = now();
+    float radius;
+    int i;
+
+    *total = 0;
+
+    if (method == METHOD_BATCH) {
+        for (i = 0; i + BATCH_SIZE <= NUM_QUERIES; i += BATCH_SIZE) {
+            *total += bench_batch(mix, i);
+        }
+
+        return (now() - start) / NUM_QUERIES * 1e9;
+    }
+
+    for (i = 0; i < NUM_QUERIES; i++) {
+        radius = mix->radii[i % mix->num_radii];
+
+        switch (method) {
+            case METHOD_PICKED:
+                *total += place_find_spots(query_x[i], query_y[i], radius, found, MAX_SPOTS);
+                break;
+
+            case METHOD_SPOTMAP:
+                *total += spot_find_near(query_x[i], query_y[i], radius, found, MAX_SPOTS);
+                break;
+
+            case METHOD_MORTON:
+                *total += place_morton_find_spots(query_x[i], query_y[i], radius, found, MAX_SPOTS);
+                break;
+
+            case METHOD_KD:
+                *total += place_kd_find_spots(query_x[i], query_y[i], radius, found, MAX_SPOTS);
+                break;
+
+            default:
+                *total += place_find_spots_at_level(method, query_x[i], query_y[i], radius, found, MAX_SPOTS);
+        }
+    }
+
+    return (now() - start) / NUM_QUERIES * 1e9;
+}
+
+/**
+ * @brief Times a radius mix against a level, or another query method.
+ *
+ * Takes the best of a few runs, to weed out noise.
+ */
+static double bench(const struct radius_mix_t *mix, int method, size_t *total) {
+    double ns, best = 0.0;
+    int run;
+
+    for (run = 0; run < NUM_RUNS; run++) {
+        ns = bench_once(mix, method, total);
+
+        if (run == 0 || ns < best) {
+            best = ns;
+        }
+    }
+
+    return best;
+}
+
+int main(int argc, char **argv) {
+    const float world_width = argc > 1 ? atof(argv[1]) : 32768.0;
+    size_t total, expected;
+    spot_handle_t spot;
+    int i, m, level, spotmap_fits;
+    double ns;
+
+    srand(6046);
+    spotmap_fits = make_world(world_width, argc <= 2 || strcmp(argv[2], "uniform") != 0);
+
+    // query around spots, as stations and industries are placed on them
+    for (i = 0; i < NUM_QUERIES; i++) {
+        spot = rand() % MAX_SPOTS;
+
+        query_x[i] = place_spots[spot].x + (frand() - 0.5) * 512.0;
+        query_y[i] = place_spots[spot].y + (frand() - 0.5) * 512.0;
+    }
+
+    printf("%d spots over %.0f units, %d queries per run; ns per query\n", MAX_SPOTS, world_width, NUM_QUERIES);
+    printf("\nmulti-resolution spot index, by level:\n");
+
+    for (m = 0; m < sizeof(mixes) / sizeof(*mixes); m++) {
+        printf("%-18s", mixes[m].label);
+
+        bench_once(&mixes[m], 0, &expected);
+
+        for (level = 0; level < PLACE_NUM_LEVELS; level++) {
+            ns = bench(&mixes[m], level, &total);
+            printf("  %5d: %7.1f%s", PLACE_LEVEL_BASE_WIDTH << level, ns, total != expected ? " (MISMATCH)" : "");
+        }
+
+        ns = bench(&mixes[m], METHOD_PICKED, &total);
+        printf("  picked: %7.1f%s\n", ns, total != expected ? " (MISMATCH)" : "");
+    }
+
+    printf("\nby index:\n");
+
+    for (m = 0; m < sizeof(mixes) / sizeof(*mixes); m++) {
+        printf("%-18s", mixes[m].label);
+
+        bench_once(&mixes[m], 0, &expected);
+
+        if (spotmap_fits) {
+            ns = bench(&mixes[m], METHOD_SPOTMAP, &total);
+            printf("  spotmap: %7.1f%s", ns, total != expected ? " (MISMATCH)" : "");
+
+            ns = bench(&mixes[m], METHOD_BATCH, &total);
+            printf("  batched: %7.1f%s", ns, total != expected ? " (MISMATCH)" : "");
+        }
+
+        else {
+            // too many spots in a tile to be linked
+            printf("  spotmap:     n/a  batched:     n/a");
+        }
+
+        ns = bench(&mixes[m], METHOD_MORTON, &total);
+        printf("  morton: %7.1f%s", ns, total != expected ? " (MISMATCH)" : "");
+
+        ns = bench(&mixes[m], METHOD_KD, &total);
+        printf("  kd-tree: %7.1f%s", ns, total != expected ? " (MISMATCH)" : "");
+
+        ns = bench(&mixes[m], METHOD_PICKED, &total);
+        printf("  multi-resolution: %7.1f%s\n", ns, total != expected ? " (MISMATCH)" : "");
+    }
+
+    if (!spotmap_fits) {
+        printf("\nspots crowd past MAX_SPOTS_PER_TILE (%d) in a tile; spotmap and batched queries not timed\n", MAX_SPOTS_PER_TILE);
+        return 1;
+    }
+
+    return 0;
+}
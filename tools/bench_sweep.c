@@ -0,0 +1,157 @@
+/**
+ * @file bench_sweep.c
+ * @author Gustavo Rehermann (rehermann6046@gmail.com)
+ * @brief Benchmark of the industry sweeps.
+ * @version added in 0.1
+ * @date 2021-03-20
+ *
+ * A host program, not part of the mod itself. Fills the world with
+ * industries of every type, feeds them, then times boost checks,
+ * period rollover and production summation over all of them, both
+ * through the per-industry calls and through the single sweeps of
+ * h_industry, at a few world sizes.
+ *
+ * The simulation modules are built with a larger MAX_INDUSTRIES. It is
+ * built twice, with the vectorized and scalar sweep kernels of m_vec;
+ * each prints which one it uses.
+ *
+ * @copyright Copyright (c)Gustavo Ramos Rehermann 2021. The MIT License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "h_industry.h"
+#include "m_vec.h"
+
+
+/**
+ * @brief How many sweeps over every industry are timed, per world size.
+ */
+#define NUM_SWEEPS (1 << 24)
+
+static const int world_sizes[] = { 128, 4096, 65536 };
+
+
+static industry_set_t boosted;
+
+/**
+ * @brief Keeps results alive, so that no timed work is optimized out.
+ */
+static volatile float sink;
+
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void make_world(int size, int num_types) {
+    int i, j;
+
+    industry_clear();
+    srand(size);
+
+    for (i = 0; i < size; i++) {
+        industry_make(i % num_types, 0.0, 0.0);
+
+        for (j = 0; j < industry_types[i % num_types].num_accepts; j++) {
+            industry_accept_cargo(i, j, (float) rand() / RAND_MAX * 2.0 * industry_types[i % num_types].boost_threshold);
+        }
+    }
+}
+
+int main(void) {
+    double start, calls[3], sweeps[3];
+    int num_types, size, runs, run, i, j, w, count, num_supplies;
+    float total, amount;
+
+    for (num_types = 0; num_types < MAX_INDUS_TYPES && industry_types[num_types].supply_type != ISUPTYPE_UNKNOWN; num_types++);
+
+    printf("sweep kernels: %s\n\n", vec_path);
+    printf("%10s  %-8s  %14s  %14s  %8s\n", "industries", "sweep", "calls ns/ind", "sweep ns/ind", "speedup");
+
+    for (w = 0; w < sizeof(world_sizes) / sizeof(*world_sizes); w++) {
+        size = world_sizes[w];
+
+        if (size > MAX_INDUSTRIES) {
+            continue;
+        }
+
+        make_world(size, num_types);
+        runs = NUM_SWEEPS / size;
+
+        // boost checks
+        start = now();
+
+        for (run = 0; run < runs; run++) {
+            for (count = 0, i = 0; i < size; i++) {
+                count += industry_types[i % num_types].supply_type == ISUPTYPE_BOOST && industry_is_boosted(i);
+            }
+
+            sink = count;
+        }
+
+        calls[0] = now() - start;
+        start = now();
+
+        for (run = 0; run < runs; run++) {
+            sink = industry_check_boosts(boosted);
+        }
+
+        sweeps[0] = now() - start;
+
+        // production summation
+        start = now();
+
+        for (run = 0; run < runs; run++) {
+            for (total = 0.0, i = 0; i < size; i++) {
+                num_supplies = industry_types[i % num_types].num_supplies;
+
+                for (j = 0; j < num_supplies; j++) {
+                    industry_get_produced(i, j, &amount);
+                    total += amount;
+                }
+            }
+
+            sink = total;
+        }
+
+        calls[1] = now() - start;
+        start = now();
+
+        for (run = 0; run < runs; run++) {
+            sink = industry_total_produced();
+        }
+
+        sweeps[1] = now() - start;
+
+        // period rollover, which has no per-industry call to compare to
+        calls[2] = 0.0;
+        start = now();
+
+        for (run = 0; run < runs; run++) {
+            industry_end_period();
+        }
+
+        sweeps[2] = now() - start;
+
+        for (i = 0; i < 3; i++) {
+            printf("%10d  %-8s  ", size, (const char *[]) { "boost", "produced", "rollover" }[i]);
+
+            if (calls[i] > 0.0) {
+                printf("%14.3f  %14.3f  %7.1fx\n", calls[i] * 1e9 / runs / size, sweeps[i] * 1e9 / runs / size, calls[i] / sweeps[i]);
+            }
+
+            else {
+                printf("%14s  %14.3f  %8s\n", "-", sweeps[i] * 1e9 / runs / size, "-");
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,246 @@
+/**
+ * @file bench_world.c
+ * @author Gustavo Rehermann (rehermann6046@gmail.com)
+ * @brief Benchmark of spatial queries and production over synthetic worlds.
+ * @version added in 0.1
+ * @date 2021-03-21
+ *
+ * A host program, not part of the mod itself. Makes worlds of 10^2,
+ * 10^3 and 10^4 industries with worldgen, in every layout, and times,
+ * in each of them:
+ *
+ *  - making the world, spots, industries and stations alike;
+ *  - radius queries at every industry's reach, through the level
+ *    place_find_spots picks, the spotmap and the spot KD-tree;
+ *  - nearest station lookups at every industry;
+ *  - the delivery schedule, unloaded at stations and handed over to
+ *    industries, with station inboxes merged every tic;
+ *  - boost checks and period rollover over every industry.
+ *
+ * The simulation modules are built with larger capacities, as for
+ * stress_tick. Each world is made in a forked child, since spots can
+ * not be removed. A world with spots left out of the spotmap, which
+ * radius queries then miss, fails the benchmark, as does a world that
+ * does not fit at all.
+ *
+ * @copyright Copyright (c)Gustavo Ramos Rehermann 2021. The MIT License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "worldgen.h"
+
+
+/**
+ * @brief About how many queries of each kind are timed, per world.
+ */
+#define NUM_QUERIES 200000
+
+#define NUM_RUNS 3
+
+static const int world_sizes[] = { 100, 1000, 10000 };
+
+
+static spot_handle_t found[MAX_SPOTS];
+static industry_set_t boosted;
+
+/**
+ * @brief Keeps results alive, so that no timed work is optimized out.
+ */
+static volatile size_t sink;
+
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Query methods to time.
+ */
+enum query_method_t {
+    QUERY_PICKED,
+    QUERY_SPOTMAP,
+    QUERY_KD,
+    QUERY_NEAREST,
+
+    NUM_QUERY_METHODS
+};
+
+/**
+ * @brief Times a query method at every industry, taking the best of a few runs.
+ *
+ * @return double The time per query, in nanoseconds.
+ */
+static double bench_queries(const struct worldgen_world_t *world, enum query_method_t method, size_t *total) {
+    const int repeats = NUM_QUERIES / world->num_industries + 1;
+    double start, ns, best = 0.0;
+    const struct spot_t *spot;
+    float reach;
+    int run, r, i;
+
+    for (run = 0; run < NUM_RUNS; run++) {
+        *total = 0;
+        start = now();
+
+        for (r = 0; r < repeats; r++) {
+            for (i = 0; i < world->num_industries; i++) {
+                // the spot of industry i is spot i
+                spot = &place_spots[i];
+                reach = industry_types[world->types[i]].reach;
+
+                switch (method) {
+                    case QUERY_PICKED:
+                        *total += place_find_spots(spot->x, spot->y, reach, found, MAX_SPOTS);
+                        break;
+
+                    case QUERY_SPOTMAP:
+                        *total += spot_find_near(spot->x, spot->y, reach, found, MAX_SPOTS);
+                        break;
+
+                    case QUERY_KD:
+                        *total += place_kd_find_spots(spot->x, spot->y, reach, found, MAX_SPOTS);
+                        break;
+
+                    default:
+                        *total += station_find_nearest(spot->x, spot->y) != (station_handle_t) -1;
+                }
+            }
+        }
+
+        ns = (now() - start) * 1e9 / repeats / world->num_industries;
+        best = run == 0 || ns < best ? ns : best;
+    }
+
+    *total /= repeats;
+
+    return best;
+}
+
+/**
+ * @brief Runs the delivery schedule once.
+ *
+ * @return double The time per delivery, in nanoseconds.
+ */
+static double bench_deliveries(const struct worldgen_world_t *world) {
+    const struct worldgen_delivery_t *delivery;
+    const double start = now();
+    unsigned int tic = 0;
+    int i;
+
+    for (i = 0; i < world->num_deliveries; i++) {
+        delivery = &world->deliveries[i];
+
+        if (delivery->tic != tic) {
+            station_merge_inboxes();
+            tic = delivery->tic;
+        }
+
+        station_deposit_cargo(delivery->station, delivery->cargo_type, -1, delivery->amount);
+        industry_accept_cargo(delivery->industry, delivery->accept, delivery->amount);
+    }
+
+    station_merge_inboxes();
+
+    return world->num_deliveries > 0 ? (now() - start) * 1e9 / world->num_deliveries : 0.0;
+}
+
+/**
+ * @brief Times a boost check and a period rollover over every industry.
+ *
+ * @return double The time per industry, in nanoseconds.
+ */
+static double bench_sweeps(const struct worldgen_world_t *world) {
+    const int repeats = NUM_QUERIES / world->num_industries + 1;
+    const double start = now();
+    int r;
+
+    for (r = 0; r < repeats; r++) {
+        sink = industry_check_boosts(boosted);
+        industry_end_period();
+    }
+
+    return (now() - start) * 1e9 / repeats / world->num_industries;
+}
+
+/**
+ * @brief Makes a world and times everything in it, printing a row.
+ *
+ * Meant to run in a child process of its own.
+ *
+ * @return int 0 on success, or 1 if the world does not fit, or not
+ * every spot of it could be linked.
+ */
+static int bench_world(enum worldgen_layout_t layout, int size, unsigned int seed) {
+    struct worldgen_params_t params;
+    struct worldgen_world_t world;
+    double start, make_time, times[NUM_QUERY_METHODS];
+    size_t num_found = 0, total;
+    int method;
+
+    worldgen_default_params(&params, layout, size, seed);
+
+    start = now();
+
+    if (worldgen_make(&params, &world) != 0) {
+        printf("%-9s  %7d  world does not fit\n", worldgen_layout_names[layout], size);
+        return 1;
+    }
+
+    make_time = now() - start;
+
+    for (method = 0; method < NUM_QUERY_METHODS; method++) {
+        times[method] = bench_queries(&world, method, &total);
+
+        if (method == QUERY_PICKED) {
+            num_found = total;
+        }
+    }
+
+    printf("%-9s  %7d  %8.2f  %7zu  %8d  %8.1f  %8.1f  %8.1f  %8.1f  %8.1f  %8.2f\n", worldgen_layout_names[layout], size, make_time * 1e3, num_found / world.num_industries, world.num_unlinked, times[QUERY_PICKED], times[QUERY_SPOTMAP], times[QUERY_KD], times[QUERY_NEAREST], bench_deliveries(&world), bench_sweeps(&world));
+
+    worldgen_free(&world);
+
+    if (world.num_unlinked > 0) {
+        printf("%-9s  %7d  %d spots unlinked; queries through the spotmap miss them\n", worldgen_layout_names[layout], size, world.num_unlinked);
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const unsigned int seed = argc > 1 ? (unsigned int) strtoul(argv[1], NULL, 0) : 1;
+    int layout, w, status, failed = 0;
+
+    printf("seed %u; times in ns per query, delivery or industry, unless noted\n\n", seed);
+    printf("%-9s  %7s  %8s  %7s  %8s  %8s  %8s  %8s  %8s  %8s  %8s\n", "layout", "indus", "make ms", "found", "unlinked", "picked", "spotmap", "kd", "nearest", "deliver", "sweep");
+
+    for (w = 0; w < sizeof(world_sizes) / sizeof(*world_sizes); w++) {
+        for (layout = 0; layout < NUM_WORLDGEN_LAYOUTS; layout++) {
+            fflush(stdout);
+
+            if (fork() == 0) {
+                // every world starts off empty
+                w = bench_world(layout, world_sizes[w], seed);
+                fflush(stdout);
+                _exit(w);
+            }
+
+            wait(&status);
+
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                failed = 1;
+            }
+        }
+    }
+
+    return failed;
+}
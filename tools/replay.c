@@ -0,0 +1,664 @@
+/**
+ * @file replay.c
+ * @author Gustavo Rehermann (rehermann6046@gmail.com)
+ * @brief Replays a trace of simulation API calls, timing each function.
+ * @version added in 0.1
+ * @date 2021-03-21
+ *
+ * A host program, not part of the mod itself. Reads a log with the
+ * "TRACE" lines a debug build with M_TRACE prints (see m_trace.h),
+ * ignoring any other lines, and calls every traced function again
+ * with the same arguments, in the same order, against the simulation
+ * modules built for the host. A recorded play session thus becomes a
+ * benchmark with the access patterns of actual play.
+ *
+ * The whole trace is decoded before it is replayed, so decoding is not
+ * timed. The replay is run several times, each forked off a fresh
+ * world; for every function, the best of all runs is reported, less
+ * the cost of timing a call, which is measured beforehand. The longest
+ * tic of the best run is reported too.
+ *
+ * Every result of every call is hashed along the way, into a checksum
+ * printed at the end. Replays of the same trace should always give the
+ * same checksum; if a change to the simulation modules changes it, it
+ * also changed their behaviour.
+ *
+ * @copyright Copyright (c)Gustavo Ramos Rehermann 2021. The MIT License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "h_company.h"
+#include "h_industry.h"
+#include "h_station.h"
+#include "i_place.h"
+#include "m_trace.h"
+
+
+#define DEFAULT_RUNS 5
+
+
+/**
+ * @brief A decoded argument of a call.
+ */
+union replay_arg_t {
+    size_t z;
+    unsigned int u;
+    int i;
+    float f;
+    char *s;
+    size_t *sizes;
+    float *floats;
+};
+
+/**
+ * @brief A decoded call.
+ */
+struct replay_call_t {
+    enum trace_func_t func;
+    unsigned int tic;
+    size_t first_arg;
+};
+
+/**
+ * @brief The results of a single run of the replay.
+ */
+struct replay_result_t {
+    double times[NUM_TRACE_FUNCS];
+    double worst_tic;
+    unsigned long long sum;
+};
+
+
+static unsigned char *trace = NULL;
+static size_t trace_length = 0, trace_capacity = 0;
+
+static struct replay_call_t *calls = NULL;
+static size_t num_calls = 0, calls_capacity = 0;
+
+static union replay_arg_t *args = NULL;
+static size_t num_args = 0, args_capacity = 0;
+
+static size_t call_counts[NUM_TRACE_FUNCS];
+static unsigned int num_tics = 0;
+
+static spot_handle_t found[MAX_SPOTS];
+static industry_set_t boosted;
+
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Grows an array to hold at least one more item.
+ */
+static void *grow(void *items, size_t item_size, size_t length, size_t *capacity) {
+    if (length < *capacity) {
+        return items;
+    }
+
+    *capacity = *capacity ? *capacity * 2 : 1024;
+    items = realloc(items, item_size * *capacity);
+
+    if (items == NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    return items;
+}
+
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Reads the bytes of every TRACE line of a log.
+ */
+static int read_log(FILE *log) {
+    char line[1024];
+    const char *hex;
+    int high, low;
+
+    while (fgets(line, sizeof(line), log) != NULL) {
+        hex = strstr(line, "TRACE ");
+
+        if (hex == NULL) {
+            continue;
+        }
+
+        for (hex += 6; (high = hex_digit(hex[0])) >= 0 && (low = hex_digit(hex[1])) >= 0; hex += 2) {
+            trace = grow(trace, 1, trace_length, &trace_capacity);
+            trace[trace_length++] = (unsigned char) (high << 4 | low);
+        }
+    }
+
+    return trace_length > 0;
+}
+
+/**
+ * @brief Reads an unsigned LEB128 varint off the trace.
+ *
+ * @return int 0 on success, -1 if the trace ends first.
+ */
+static int read_varint(size_t *pos, size_t *value) {
+    int shift = 0;
+
+    *value = 0;
+
+    while (*pos < trace_length) {
+        *value |= (size_t) (trace[*pos] & 0x7F) << shift;
+        shift += 7;
+
+        if (!(trace[(*pos)++] & 0x80)) {
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Reads a size_t off the trace.
+ *
+ * The mod is built for 32 bits, so a size_t of all ones, like the -1
+ * of a missing handle, is recorded as 0xFFFFFFFF; it is widened back
+ * to all ones here, so that a 64-bit host still sees it as -1.
+ *
+ * @return int 0 on success, -1 if the trace ends first.
+ */
+static int read_size(size_t *pos, size_t *value) {
+    if (read_varint(pos, value) != 0) {
+        return -1;
+    }
+
+    if (*value == 0xFFFFFFFFu) {
+        *value = (size_t) -1;
+    }
+
+    return 0;
+}
+
+static int read_float(size_t *pos, float *value) {
+    union {
+        float f;
+        unsigned int u;
+    } bits;
+    int i;
+
+    if (*pos + 4 > trace_length) {
+        return -1;
+    }
+
+    bits.u = 0;
+
+    for (i = 0; i < 4; i++) {
+        bits.u |= (unsigned int) trace[(*pos)++] << (i * 8);
+    }
+
+    *value = bits.f;
+
+    return 0;
+}
+
+/**
+ * @brief Decodes the arguments of a single record, after its function byte.
+ */
+static int decode_args(size_t *pos, enum trace_func_t func) {
+    const char *arg;
+    size_t value, count = 0, i;
+    union replay_arg_t *item;
+
+    for (arg = trace_func_args[func]; *arg; arg++) {
+        args = grow(args, sizeof(*args), num_args, &args_capacity);
+        item = &args[num_args++];
+
+        switch (*arg) {
+            case 'z':
+                if (read_size(pos, &item->z) != 0) {
+                    return -1;
+                }
+
+                break;
+
+            case 'n':
+            case 'u':
+                if (read_varint(pos, &value) != 0) {
+                    return -1;
+                }
+
+                if (*arg == 'u') {
+                    item->u = (unsigned int) value;
+                }
+
+                else {
+                    item->z = value;
+                }
+
+                if (*arg == 'n') {
+                    count = value;
+                }
+
+                break;
+
+            case 'i':
+                if (read_varint(pos, &value) != 0) {
+                    return -1;
+                }
+
+                item->i = (int) ((value >> 1) ^ -(value & 1));
+                break;
+
+            case 'f':
+                if (read_float(pos, &item->f) != 0) {
+                    return -1;
+                }
+
+                break;
+
+            case 's':
+                if (read_varint(pos, &value) != 0 || *pos + value > trace_length) {
+                    return -1;
+                }
+
+                item->s = malloc(value + 1);
+                memcpy(item->s, trace + *pos, value);
+                item->s[value] = '\0';
+                *pos += value;
+                break;
+
+            case 'Z':
+                item->sizes = malloc(sizeof(size_t) * (count + 1));
+
+                for (i = 0; i < count; i++) {
+                    if (read_size(pos, &item->sizes[i]) != 0) {
+                        return -1;
+                    }
+                }
+
+                break;
+
+            case 'F':
+                item->floats = malloc(sizeof(float) * (count + 1));
+
+                for (i = 0; i < count; i++) {
+                    if (read_float(pos, &item->floats[i]) != 0) {
+                        return -1;
+                    }
+                }
+
+                break;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Decodes the whole trace into calls.
+ *
+ * @return int 0 on success, -1 if the trace is cut short or malformed;
+ * every call decoded before that is kept either way.
+ */
+static int decode(void) {
+    size_t pos = 0, first_arg;
+    unsigned int tic = 0, last_tic = 0;
+    enum trace_func_t func;
+
+    while (pos < trace_length) {
+        func = trace[pos++];
+
+        if (func >= NUM_TRACE_FUNCS) {
+            return -1;
+        }
+
+        first_arg = num_args;
+
+        if (decode_args(&pos, func) != 0) {
+            return -1;
+        }
+
+        if (func == TRACE_TIC) {
+            tic += args[first_arg].i;
+            num_args = first_arg;
+            continue;
+        }
+
+        if (num_calls == 0 || tic != last_tic) {
+            num_tics++;
+            last_tic = tic;
+        }
+
+        calls = grow(calls, sizeof(*calls), num_calls, &calls_capacity);
+        calls[num_calls].func = func;
+        calls[num_calls].tic = tic;
+        calls[num_calls].first_arg = first_arg;
+        num_calls++;
+
+        call_counts[func]++;
+    }
+
+    return 0;
+}
+
+static unsigned long long hash(unsigned long long sum, unsigned long long value) {
+    return (sum ^ value) * 0x100000001B3ull;
+}
+
+static unsigned long long hash_float(unsigned long long sum, float value) {
+    union {
+        float f;
+        unsigned int u;
+    } bits;
+
+    bits.f = value;
+
+    return hash(sum, bits.u);
+}
+
+/**
+ * @brief Makes a single call, and hashes its results.
+ */
+static unsigned long long call(const struct replay_call_t *rc, unsigned long long sum) {
+    const union replay_arg_t *const a = &args[rc->first_arg];
+    struct station_visit_t visit;
+    size_t num_found, i;
+    float amount = 0.0;
+
+    switch (rc->func) {
+        case TRACE_MAKE_SPOT:
+            return hash(sum, make_spot(a[0].f, a[1].f));
+
+        case TRACE_SPOT_LINK:
+            return hash(sum, spot_link(a[0].z, a[1].f));
+
+        case TRACE_SPOT_UNLINK:
+            return hash(sum, spot_unlink(a[0].z, a[1].f));
+
+        case TRACE_SPOT_FIND_NEAR:
+        case TRACE_PLACE_FIND_SPOTS:
+            num_found = a[3].z < MAX_SPOTS ? a[3].z : MAX_SPOTS;
+
+            if (rc->func == TRACE_SPOT_FIND_NEAR) {
+                num_found = spot_find_near(a[0].f, a[1].f, a[2].f, found, num_found);
+            }
+
+            else {
+                num_found = place_find_spots(a[0].f, a[1].f, a[2].f, found, num_found);
+            }
+
+            // in no particular order
+            for (sum = hash(sum, num_found), i = 0; i < num_found; i++) {
+                sum += found[i] * 0x9E3779B97F4A7C15ull;
+            }
+
+            return sum;
+
+        case TRACE_INDUSTRY_MAKE:
+            return hash(sum, industry_make(a[0].z, a[1].f, a[2].f));
+
+        case TRACE_INDUSTRY_MAKE_PRODUCTION:
+            return hash(sum, industry_make_production(a[0].z, a[1].f));
+
+        case TRACE_INDUSTRY_CHECK_PRODUCTION:
+            return hash(sum, industry_check_production(a[0].z));
+
+        case TRACE_INDUSTRY_ACCEPT_CARGO:
+            return hash(sum, industry_accept_cargo(a[0].z, a[1].z, a[2].f));
+
+        case TRACE_INDUSTRY_GET_PRODUCED:
+            sum = hash(sum, industry_get_produced(a[0].z, a[1].z, &amount));
+            return hash_float(sum, amount);
+
+        case TRACE_INDUSTRY_CHECK_BOOSTS:
+            return hash(sum, industry_check_boosts(boosted));
+
+        case TRACE_INDUSTRY_END_PERIOD:
+            industry_end_period();
+            return sum;
+
+        case TRACE_INDUSTRY_TOTAL_PRODUCED:
+            return hash_float(sum, industry_total_produced());
+
+        case TRACE_INDUSTRY_CLEAR:
+            industry_clear();
+            return sum;
+
+        case TRACE_STATION_MAKE:
+            return hash(sum, station_make(a[0].z));
+
+        case TRACE_STATION_REMOVE:
+            return hash(sum, station_remove(a[0].z));
+
+        case TRACE_STATION_ADD_CARGO:
+            return hash(sum, station_add_cargo(a[0].z, a[1].z, a[2].i, a[3].f));
+
+        case TRACE_STATION_ADD_CARGO_BATCH:
+            return hash(sum, station_add_cargo_batch(a[0].z, a[1].i, a[3].sizes, a[4].floats, a[2].z));
+
+        case TRACE_STATION_DEPOSIT_CARGO:
+            return hash(sum, station_deposit_cargo(a[0].z, a[1].z, a[2].i, a[3].f));
+
+        case TRACE_STATION_MERGE_INBOX:
+            return hash(sum, station_merge_inbox(a[0].z));
+
+        case TRACE_STATION_MERGE_INBOXES:
+            station_merge_inboxes();
+            return sum;
+
+        case TRACE_STATION_FIND_NEAREST:
+            return hash(sum, station_find_nearest(a[0].f, a[1].f));
+
+        case TRACE_STATION_GET_CARGO_AMOUNT:
+            sum = hash(sum, station_get_cargo_amount(a[0].z, a[1].z, &amount));
+            return hash_float(sum, amount);
+
+        case TRACE_STATION_VISIT:
+            visit.cargo_type = a[1].z;
+            visit.origin = a[2].z;
+            visit.amount = a[3].f;
+            visit.capacity = a[4].f;
+            visit.unload = (unsigned char) a[5].i;
+            visit.load = (unsigned char) a[6].i;
+
+            sum = hash(sum, station_visit(a[0].z, &visit));
+            sum = hash(sum, visit.origin);
+            return hash_float(sum, visit.amount);
+
+        case TRACE_STATION_AGE_CARGO:
+            return hash(sum, station_age_cargo(a[0].z, a[1].u));
+
+        case TRACE_STATION_AGE_ALL_CARGO:
+            station_age_all_cargo(a[0].u);
+            return sum;
+
+        case TRACE_COMPANY_FOUND_COMPANY:
+            if (num_companies >= MAX_COMPANIES) {
+                return sum;
+            }
+
+            return hash(sum, company_found_company(a[0].s, a[1].f));
+
+        case TRACE_COMPANY_ADD_TO_BALANCE:
+            return hash(sum, company_add_to_balance(a[0].z, a[1].f));
+
+        case TRACE_COMPANY_LOAN:
+            return hash(sum, company_loan(a[0].z, a[1].f));
+
+        case TRACE_COMPANY_CHARGE_INTEREST:
+            return hash(sum, company_charge_interest(a[0].z, a[1].u));
+
+        default:
+            return sum;
+    }
+}
+
+/**
+ * @brief Replays every call once, timing each.
+ *
+ * @param overhead The cost of timing a single call, to take off each.
+ */
+static void run(struct replay_result_t *result, double overhead) {
+    double start, elapsed, tic_time = 0.0;
+    unsigned int tic = 0;
+    size_t i;
+
+    memset(result, 0, sizeof(*result));
+    result->sum = 0xCBF29CE484222325ull;
+
+    for (i = 0; i < num_calls; i++) {
+        if (calls[i].tic != tic) {
+            result->worst_tic = tic_time > result->worst_tic ? tic_time : result->worst_tic;
+            tic_time = 0.0;
+            tic = calls[i].tic;
+        }
+
+        start = now();
+        result->sum = call(&calls[i], result->sum);
+        elapsed = now() - start - overhead;
+
+        elapsed = elapsed > 0.0 ? elapsed : 0.0;
+        result->times[calls[i].func] += elapsed;
+        tic_time += elapsed;
+    }
+
+    result->worst_tic = tic_time > result->worst_tic ? tic_time : result->worst_tic;
+}
+
+/**
+ * @brief Measures the cost of timing a single call.
+ */
+static double timing_overhead(void) {
+    volatile double sink;
+    double start, best = 1.0;
+    int run, i;
+
+    for (run = 0; run < 16; run++) {
+        start = now();
+
+        for (i = 0; i < 4096; i++) {
+            sink = now();
+        }
+
+        sink = (now() - start) / 4096;
+        best = sink < best ? sink : best;
+    }
+
+    return best;
+}
+
+int main(int argc, char **argv) {
+    const int runs = argc > 2 ? atoi(argv[2]) : DEFAULT_RUNS;
+    FILE *log = argc > 1 && strcmp(argv[1], "-") != 0 ? fopen(argv[1], "r") : stdin;
+    struct replay_result_t result, best;
+    double overhead, total = 0.0;
+    int fds[2], order[NUM_TRACE_FUNCS], num_order = 0, r, i, j;
+
+    if (argc < 2 || log == NULL || runs < 1) {
+        fprintf(stderr, "usage: %s <log file, or - for stdin> [runs]\n", argv[0]);
+        return 1;
+    }
+
+    if (!read_log(log)) {
+        fprintf(stderr, "no trace found in log\n");
+        return 1;
+    }
+
+    if (decode() != 0) {
+        fprintf(stderr, "warning: trace cut short or malformed; replaying the first %zu calls only\n", num_calls);
+    }
+
+    overhead = timing_overhead();
+    memset(&best, 0, sizeof(best));
+
+    printf("%zu bytes, %zu calls over %u tics, best of %d runs\n", trace_length, num_calls, num_tics, runs);
+    printf("timing overhead: %.1f ns per call, taken off\n\n", overhead * 1e9);
+
+    for (r = 0; r < runs; r++) {
+        fflush(stdout);
+
+        if (pipe(fds) != 0) {
+            return 1;
+        }
+
+        if (fork() == 0) {
+            // every run starts off an empty world
+            run(&result, overhead);
+
+            if (write(fds[1], &result, sizeof(result)) != sizeof(result)) {
+                _exit(1);
+            }
+
+            _exit(0);
+        }
+
+        if (read(fds[0], &result, sizeof(result)) != sizeof(result)) {
+            return 1;
+        }
+
+        wait(NULL);
+        close(fds[0]);
+        close(fds[1]);
+
+        if (r == 0) {
+            best = result;
+            continue;
+        }
+
+        if (result.sum != best.sum) {
+            fprintf(stderr, "warning: run %d gave checksum %016llx, not %016llx\n", r + 1, result.sum, best.sum);
+        }
+
+        for (i = 0; i < NUM_TRACE_FUNCS; i++) {
+            best.times[i] = result.times[i] < best.times[i] ? result.times[i] : best.times[i];
+        }
+
+        best.worst_tic = result.worst_tic < best.worst_tic ? result.worst_tic : best.worst_tic;
+    }
+
+    // functions that were called, most expensive first
+    for (i = 0; i < NUM_TRACE_FUNCS; i++) {
+        if (call_counts[i] == 0) {
+            continue;
+        }
+
+        for (j = num_order; j > 0 && best.times[order[j - 1]] < best.times[i]; j--) {
+            order[j] = order[j - 1];
+        }
+
+        order[j] = i;
+        num_order++;
+        total += best.times[i];
+    }
+
+    printf("%-26s  %10s  %12s  %10s  %6s\n", "function", "calls", "total ms", "ns/call", "share");
+
+    for (i = 0; i < num_order; i++) {
+        j = order[i];
+        printf("%-26s  %10zu  %12.3f  %10.1f  %5.1f%%\n", trace_func_names[j], call_counts[j], best.times[j] * 1e3, best.times[j] * 1e9 / call_counts[j], total > 0.0 ? best.times[j] / total * 100 : 0.0);
+    }
+
+    printf("\n%-26s  %10zu  %12.3f\n", "all", num_calls, total * 1e3);
+    printf("worst tic: %.3f ms, mean tic: %.3f ms\n", best.worst_tic * 1e3, num_tics > 0 ? total * 1e3 / num_tics : 0.0);
+    printf("checksum: %016llx\n", best.sum);
+
+    return 0;
+}
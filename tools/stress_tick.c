@@ -0,0 +1,492 @@
+/**
+ * @file stress_tick.c
+ * @author Gustavo Rehermann (rehermann6046@gmail.com)
+ * @brief Multi-threaded production tic over a large world.
+ * @version added in 0.1
+ * @date 2021-03-19
+ *
+ * A host program, not part of the mod itself. Builds a world far
+ * larger than the mod's (the simulation modules are built with larger
+ * MAX_INDUSTRIES, MAX_STATIONS and MAX_SPOTS), and runs its production
+ * tic on 1 to N threads, timing each.
+ *
+ * The world is split into square partitions at least as wide as the
+ * largest industry reach, so that every industry only reaches stations
+ * in its own partition or the 8 around it. Each thread takes a
+ * contiguous block of partitions. Every tic, each thread feeds and runs
+ * the industries of its partitions, and deposits their production into
+ * reached stations' inboxes: directly if the station is in the same
+ * partition, or else into a buffer of its own for the thread owning
+ * that station. After a barrier, every thread deposits the buffers
+ * meant for it, in thread order, then merges the inboxes of its
+ * stations.
+ *
+ * Since partition blocks are contiguous, thread order is partition
+ * order; every station thus gets its deposits in the same order, for
+ * any number of threads, and the world ends up bit-identical. Each run
+ * prints a checksum of it to show as much.
+ *
+ * Every run is forked off the freshly built world, so all of them start
+ * from the very same state.
+ *
+ * @copyright Copyright (c)Gustavo Ramos Rehermann 2021. The MIT License.
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "h_industry.h"
+#include "h_station.h"
+
+
+#define MAX_THREADS 64
+
+/**
+ * @brief The width of a partition, in map units.
+ *
+ * Must be no less than the largest reach in industry_types.
+ */
+#define PARTITION_WIDTH 2048.0
+
+/**
+ * @brief The average area around each station, in square map units.
+ */
+#define STATION_AREA 500000.0
+
+/**
+ * @brief The max amount of every accepted cargo fed to an industry per tic.
+ */
+#define FEED_AMOUNT 10.0
+
+
+/**
+ * @brief A deposit into a station of another partition.
+ */
+struct deposit_t {
+    unsigned int station;
+    unsigned int cargo;
+    float amount;
+};
+
+/**
+ * @brief A buffer of deposits, from one thread to another.
+ */
+struct outbox_t {
+    struct deposit_t *deposits;
+    size_t num_deposits, max_deposits;
+};
+
+static int num_threads, num_tics, num_types;
+static int partitions_wide, num_partitions;
+static pthread_barrier_t barrier;
+
+/**
+ * @brief The deposits from each thread to each thread.
+ */
+static struct outbox_t outboxes[MAX_THREADS][MAX_THREADS];
+
+/**
+ * @brief The first industry and station of each partition.
+ *
+ * Industries and stations are made in partition order, so those of a
+ * partition are all contiguous.
+ */
+static int *partition_industries, *partition_stations;
+
+/**
+ * @brief The partition of each station.
+ */
+static int *station_partition;
+
+/**
+ * @brief Every station within reach of each industry.
+ *
+ * Those of industry i are items reach_first[i] to reach_first[i + 1] - 1.
+ */
+static int *reach_first, *reach_stations;
+
+/**
+ * @brief The first supply slot of each industry, and what each held last tic.
+ */
+static int *supply_first;
+static float *last_produced;
+
+
+/**
+ * @brief Scrambles a seed (splitmix64).
+ */
+static unsigned long long mix(unsigned long long x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+
+    return x ^ (x >> 31);
+}
+
+/**
+ * @brief Draws a number in [0, 1) from a seed.
+ */
+static double unit(unsigned long long seed) {
+    return (mix(seed) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int partition_of(float x, float y) {
+    return (int) (y / PARTITION_WIDTH) * partitions_wide + (int) (x / PARTITION_WIDTH);
+}
+
+/**
+ * @brief The thread owning a partition.
+ */
+static int thread_of(int partition) {
+    // the inverse of the block split in work()
+    int thread = (int) (((long long) partition * num_threads + num_threads - 1) / num_partitions);
+
+    while (thread > 0 && (long long) num_partitions * thread / num_threads > partition) {
+        thread--;
+    }
+
+    while ((long long) num_partitions * (thread + 1) / num_threads <= partition) {
+        thread++;
+    }
+
+    return thread;
+}
+
+static void post(struct outbox_t *outbox, int station, int cargo, float amount) {
+    if (outbox->num_deposits == outbox->max_deposits) {
+        outbox->max_deposits = outbox->max_deposits ? outbox->max_deposits * 2 : 1024;
+        outbox->deposits = realloc(outbox->deposits, outbox->max_deposits * sizeof(struct deposit_t));
+    }
+
+    outbox->deposits[outbox->num_deposits].station = station;
+    outbox->deposits[outbox->num_deposits].cargo = cargo;
+    outbox->deposits[outbox->num_deposits].amount = amount;
+    outbox->num_deposits++;
+}
+
+/**
+ * @brief Feeds and runs an industry, and deposits its production.
+ */
+static void run_industry(int thread, int partition, int ind_industry, int tic) {
+    const struct industry_type_t *const indtype = &industry_types[ind_industry % num_types];
+    const int num_reached = reach_first[ind_industry + 1] - reach_first[ind_industry];
+    float amount, share;
+    int i, j, station;
+
+    for (i = 0; i < indtype->num_accepts; i++) {
+        industry_accept_cargo(ind_industry, i, FEED_AMOUNT * unit(((unsigned long long) ind_industry << 24) ^ ((unsigned long long) tic << 4) ^ i));
+    }
+
+    if (indtype->supply_type == ISUPTYPE_BOOST) {
+        industry_check_production(ind_industry);
+    }
+
+    for (i = 0; i < indtype->num_supplies; i++) {
+        industry_get_produced(ind_industry, i, &amount);
+
+        share = amount - last_produced[supply_first[ind_industry] + i];
+        last_produced[supply_first[ind_industry] + i] = amount;
+
+        if (share <= 0.0 || num_reached == 0) {
+            continue;
+        }
+
+        share /= num_reached;
+
+        for (j = reach_first[ind_industry]; j < reach_first[ind_industry + 1]; j++) {
+            station = reach_stations[j];
+
+            if (station_partition[station] == partition) {
+                station_deposit_cargo(station, industry_mats[indtype->first_supply + i].cargo, -1, share);
+            }
+
+            else {
+                post(&outboxes[thread][thread_of(station_partition[station])], station, industry_mats[indtype->first_supply + i].cargo, share);
+            }
+        }
+    }
+}
+
+static void *work(void *arg) {
+    const int thread = (int) (size_t) arg;
+    const int first = (long long) num_partitions * thread / num_threads;
+    const int last = (long long) num_partitions * (thread + 1) / num_threads;
+    struct outbox_t *outbox;
+    int tic, partition, ind_industry, from, ind_station;
+    size_t i;
+
+    for (tic = 0; tic < num_tics; tic++) {
+        for (partition = first; partition < last; partition++) {
+            for (ind_industry = partition_industries[partition]; ind_industry < partition_industries[partition + 1]; ind_industry++) {
+                run_industry(thread, partition, ind_industry, tic);
+            }
+        }
+
+        pthread_barrier_wait(&barrier);
+
+        for (from = 0; from < num_threads; from++) {
+            outbox = &outboxes[from][thread];
+
+            for (i = 0; i < outbox->num_deposits; i++) {
+                station_deposit_cargo(outbox->deposits[i].station, outbox->deposits[i].cargo, -1, outbox->deposits[i].amount);
+            }
+
+            outbox->num_deposits = 0;
+        }
+
+        for (ind_station = partition_stations[first]; ind_station < partition_stations[last]; ind_station++) {
+            station_merge_inbox(ind_station);
+        }
+
+        pthread_barrier_wait(&barrier);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Hashes the cargo of every station, in order (FNV-1a).
+ */
+static unsigned long long checksum(void) {
+    unsigned long long hash = 0xCBF29CE484222325ULL;
+    unsigned int bits;
+    station_handle_t ind_station;
+    cargo_handle_t cargo;
+    float amount;
+
+    for (ind_station = 0; ind_station < num_stations; ind_station++) {
+        for (cargo = 0; cargo < MAX_CARGO_TYPES; cargo++) {
+            station_get_cargo_amount(ind_station, cargo, &amount);
+            memcpy(&bits, &amount, sizeof(bits));
+
+            hash = (hash ^ bits) * 0x100000001B3ULL;
+        }
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Makes a world of randomly placed industries and stations.
+ */
+static void make_world(int num_industries_wanted, int num_stations_wanted) {
+    const float world_width = sqrt(num_stations_wanted * STATION_AREA);
+    float *xs, *ys, *station_xs, *station_ys, dx, dy, reach;
+    int *order, *counts, i, j, p, px, py, qx, qy, q, num_reaches = 0, num_slots = 0;
+
+    partitions_wide = (int) ceil(world_width / PARTITION_WIDTH);
+    num_partitions = partitions_wide * partitions_wide;
+
+    xs = malloc(sizeof(float) * (num_industries_wanted > num_stations_wanted ? num_industries_wanted : num_stations_wanted));
+    ys = malloc(sizeof(float) * (num_industries_wanted > num_stations_wanted ? num_industries_wanted : num_stations_wanted));
+    order = malloc(sizeof(int) * (num_industries_wanted > num_stations_wanted ? num_industries_wanted : num_stations_wanted));
+    counts = calloc(num_partitions + 1, sizeof(int));
+
+    partition_industries = calloc(num_partitions + 1, sizeof(int));
+    partition_stations = calloc(num_partitions + 1, sizeof(int));
+    station_partition = malloc(sizeof(int) * num_stations_wanted);
+    station_xs = malloc(sizeof(float) * num_stations_wanted);
+    station_ys = malloc(sizeof(float) * num_stations_wanted);
+
+    // stations, in partition order (counting sort)
+    for (i = 0; i < num_stations_wanted; i++) {
+        xs[i] = unit(0x5700000000ULL + 2 * i) * world_width;
+        ys[i] = unit(0x5700000000ULL + 2 * i + 1) * world_width;
+        counts[partition_of(xs[i], ys[i]) + 1]++;
+    }
+
+    for (p = 0; p < num_partitions; p++) {
+        counts[p + 1] += counts[p];
+        partition_stations[p + 1] = counts[p + 1];
+    }
+
+    for (i = 0; i < num_stations_wanted; i++) {
+        order[counts[partition_of(xs[i], ys[i])]++] = i;
+    }
+
+    for (i = 0; i < num_stations_wanted; i++) {
+        station_xs[i] = xs[order[i]];
+        station_ys[i] = ys[order[i]];
+        station_partition[i] = partition_of(station_xs[i], station_ys[i]);
+        station_make(make_spot(station_xs[i], station_ys[i]));
+    }
+
+    // industries, likewise; their type is their index modulo num_types
+    memset(counts, 0, (num_partitions + 1) * sizeof(int));
+
+    for (i = 0; i < num_industries_wanted; i++) {
+        xs[i] = unit(0x1D00000000ULL + 2 * i) * world_width;
+        ys[i] = unit(0x1D00000000ULL + 2 * i + 1) * world_width;
+        counts[partition_of(xs[i], ys[i]) + 1]++;
+    }
+
+    for (p = 0; p < num_partitions; p++) {
+        counts[p + 1] += counts[p];
+        partition_industries[p + 1] = counts[p + 1];
+    }
+
+    for (i = 0; i < num_industries_wanted; i++) {
+        order[counts[partition_of(xs[i], ys[i])]++] = i;
+    }
+
+    reach_first = malloc(sizeof(int) * (num_industries_wanted + 1));
+    reach_stations = NULL;
+    supply_first = malloc(sizeof(int) * num_industries_wanted);
+
+    for (i = 0; i < num_industries_wanted; i++) {
+        const float x = xs[order[i]], y = ys[order[i]];
+
+        industry_make(i % num_types, x, y);
+
+        supply_first[i] = num_slots;
+        num_slots += industry_types[i % num_types].num_supplies;
+
+        // find reached stations in this and the 8 partitions around
+        reach = industry_types[i % num_types].reach;
+        reach_first[i] = num_reaches;
+        p = partition_of(x, y);
+        px = p % partitions_wide;
+        py = p / partitions_wide;
+
+        for (qy = py - 1; qy <= py + 1; qy++) {
+            for (qx = px - 1; qx <= px + 1; qx++) {
+                if (qx < 0 || qy < 0 || qx >= partitions_wide || qy >= partitions_wide) {
+                    continue;
+                }
+
+                q = qy * partitions_wide + qx;
+
+                for (j = partition_stations[q]; j < partition_stations[q + 1]; j++) {
+                    dx = station_xs[j] - x;
+                    dy = station_ys[j] - y;
+
+                    if (dx * dx + dy * dy <= reach * reach) {
+                        if ((num_reaches & (num_reaches - 1)) == 0) {
+                            reach_stations = realloc(reach_stations, sizeof(int) * (num_reaches ? num_reaches * 2 : 1));
+                        }
+
+                        reach_stations[num_reaches++] = j;
+                    }
+                }
+            }
+        }
+    }
+
+    reach_first[num_industries_wanted] = num_reaches;
+    last_produced = calloc(num_slots, sizeof(float));
+
+    free(xs);
+    free(ys);
+    free(station_xs);
+    free(station_ys);
+    free(order);
+    free(counts);
+}
+
+/**
+ * @brief Runs all tics on a number of threads.
+ *
+ * @return double The time taken, in seconds.
+ */
+static double run(int threads) {
+    pthread_t handles[MAX_THREADS];
+    double start;
+    int i;
+
+    num_threads = threads;
+    pthread_barrier_init(&barrier, NULL, threads);
+
+    start = now();
+
+    for (i = 0; i < threads; i++) {
+        pthread_create(&handles[i], NULL, work, (void *) (size_t) i);
+    }
+
+    for (i = 0; i < threads; i++) {
+        pthread_join(handles[i], NULL);
+    }
+
+    return now() - start;
+}
+
+int main(int argc, char **argv) {
+    const int num_industries_wanted = argc > 1 ? atoi(argv[1]) : MAX_INDUSTRIES;
+    const int num_stations_wanted = argc > 2 ? atoi(argv[2]) : MAX_STATIONS;
+    const int max_threads = argc > 4 ? atoi(argv[4]) : (int) sysconf(_SC_NPROCESSORS_ONLN);
+    double elapsed, base = 0.0;
+    int fds[2], threads;
+    struct {
+        double elapsed;
+        unsigned long long sum;
+    } result;
+
+    num_tics = argc > 3 ? atoi(argv[3]) : 32;
+
+    if (num_industries_wanted < 1 || num_industries_wanted > MAX_INDUSTRIES || num_tics < 1 || num_stations_wanted < 1 || num_stations_wanted > MAX_STATIONS || num_stations_wanted > MAX_SPOTS || max_threads < 1 || max_threads > MAX_THREADS) {
+        fprintf(stderr, "usage: %s [industries (1-%d)] [stations (1-%d)] [tics] [max threads (1-%d)]\n", argv[0], MAX_INDUSTRIES, MAX_STATIONS < MAX_SPOTS ? MAX_STATIONS : MAX_SPOTS, MAX_THREADS);
+        return 1;
+    }
+
+    for (num_types = 0; num_types < MAX_INDUS_TYPES && industry_types[num_types].supply_type != ISUPTYPE_UNKNOWN; num_types++);
+
+    make_world(num_industries_wanted, num_stations_wanted);
+
+    printf("%d industries, %d stations, %d partitions, %d tics\n\n", num_industries_wanted, num_stations_wanted, num_partitions, num_tics);
+    printf("%7s  %10s  %12s  %8s  %s\n", "threads", "ms/tic", "ns/industry", "speedup", "checksum");
+
+    for (threads = 1; threads <= max_threads; threads = threads < max_threads && threads * 2 > max_threads ? max_threads : threads * 2) {
+        fflush(stdout);
+
+        if (pipe(fds) != 0) {
+            return 1;
+        }
+
+        if (fork() == 0) {
+            // every run starts off the same world
+            result.elapsed = run(threads);
+            result.sum = checksum();
+
+            if (write(fds[1], &result, sizeof(result)) != sizeof(result)) {
+                _exit(1);
+            }
+
+            _exit(0);
+        }
+
+        if (read(fds[0], &result, sizeof(result)) != sizeof(result)) {
+            return 1;
+        }
+
+        wait(NULL);
+        close(fds[0]);
+        close(fds[1]);
+
+        elapsed = result.elapsed;
+
+        if (threads == 1) {
+            base = elapsed;
+        }
+
+        printf("%7d  %10.3f  %12.1f  %7.2fx  %016llx\n", threads, elapsed * 1e3 / num_tics, elapsed * 1e9 / num_tics / num_industries_wanted, base / elapsed, result.sum);
+
+        if (threads == max_threads) {
+            break;
+        }
+    }
+
+    return 0;
+}
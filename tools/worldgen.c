@@ -0,0 +1,334 @@
+/**
+ * @file worldgen.c
+ * @author Gustavo Rehermann (rehermann6046@gmail.com)
+ * @brief Synthetic world generator implementation.
+ * @version added in 0.1
+ * @date 2021-03-21
+ *
+ * @copyright Copyright (c)Gustavo Ramos Rehermann 2021. The MIT License.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "m_util.h"
+#include "worldgen.h"
+
+
+const char *const worldgen_layout_names[NUM_WORLDGEN_LAYOUTS] = {
+    "uniform",
+    "clustered",
+    "corridor",
+};
+
+
+/**
+ * @brief A point, or a cluster center, or a corridor end.
+ */
+struct _worldgen_point_t {
+    float x, y;
+};
+
+
+void worldgen_default_params(struct worldgen_params_t *params, enum worldgen_layout_t layout, int num_industries, unsigned int seed) {
+    params->layout = layout;
+    params->seed = seed;
+    params->num_industries = num_industries;
+    params->num_stations = (num_industries + WORLDGEN_INDUSTRIES_PER_STATION - 1) / WORLDGEN_INDUSTRIES_PER_STATION;
+    params->num_deliveries = num_industries * 8;
+    params->num_tics = 35 * 60;
+    params->world_width = sqrt(num_industries * WORLDGEN_INDUSTRY_AREA);
+
+    if (params->world_width > WORLDGEN_MAX_WIDTH) {
+        params->world_width = WORLDGEN_MAX_WIDTH;
+    }
+}
+
+/**
+ * @brief Draws a random offset, of up to half a width either way.
+ *
+ * The sum of two draws, so that offsets gather towards the middle.
+ */
+static float _worldgen_offset(struct rng_t *rng, float width) {
+    return ((rng_unit(rng) + rng_unit(rng)) * 0.5 - 0.5) * width;
+}
+
+/**
+ * @brief Draws a random point anywhere in the world.
+ */
+static struct _worldgen_point_t _worldgen_anywhere(struct rng_t *rng, float world_width) {
+    struct _worldgen_point_t point;
+
+    point.x = (rng_unit(rng) - 0.5) * world_width;
+    point.y = (rng_unit(rng) - 0.5) * world_width;
+
+    return point;
+}
+
+/**
+ * @brief Moves a point into the world, if it strays out of it.
+ *
+ * The world spans from -width / 2 up to just under width / 2, so that
+ * a world of WORLDGEN_MAX_WIDTH fits the place grid exactly.
+ */
+static struct _worldgen_point_t _worldgen_clamp(struct _worldgen_point_t point, float world_width) {
+    const float low = -world_width * 0.5, high = world_width * 0.5 - 1.0;
+
+    point.x = point.x < low ? low : point.x > high ? high : point.x;
+    point.y = point.y < low ? low : point.y > high ? high : point.y;
+
+    return point;
+}
+
+/**
+ * @brief Lays out the spot of every industry.
+ *
+ * @param rng The generator to draw from.
+ * @param params The parameters of the world.
+ * @param points The position of every industry.
+ * @param anchors The cluster centers, in clustered worlds.
+ * @return int The number of clusters; 0 unless clustered.
+ */
+static int _worldgen_layout(struct rng_t *rng, const struct worldgen_params_t *params, struct _worldgen_point_t *points, struct _worldgen_point_t *anchors) {
+    const int num_industries = params->num_industries;
+    const float width = params->world_width;
+    struct _worldgen_point_t *corridors;
+    float *lengths;
+    int num_anchors = 0, num_corridors, i, c;
+    float t, dx, dy, length, offset, total;
+
+    switch (params->layout) {
+        case WORLDGEN_CLUSTERED:
+            num_anchors = (num_industries + WORLDGEN_INDUSTRIES_PER_CLUSTER - 1) / WORLDGEN_INDUSTRIES_PER_CLUSTER;
+
+            for (c = 0; c < num_anchors; c++) {
+                anchors[c] = _worldgen_anywhere(rng, width);
+            }
+
+            // a quarter of them lie in between, as in bench_place
+            for (i = 0; i < num_industries; i++) {
+                if (i % 4 == 0) {
+                    points[i] = _worldgen_anywhere(rng, width);
+                    continue;
+                }
+
+                c = rng_below(rng, num_anchors);
+                points[i].x = anchors[c].x + _worldgen_offset(rng, WORLDGEN_CLUSTER_WIDTH);
+                points[i].y = anchors[c].y + _worldgen_offset(rng, WORLDGEN_CLUSTER_WIDTH);
+            }
+
+            break;
+
+        case WORLDGEN_CORRIDOR:
+            // a few straight corridors, each from one point of the world to another
+            num_corridors = (int) sqrt(num_industries) / 4 + 1;
+            corridors = malloc(sizeof(*corridors) * num_corridors * 2);
+
+            lengths = malloc(sizeof(*lengths) * num_corridors);
+            total = 0.0;
+
+            for (c = 0; c < num_corridors * 2; c++) {
+                corridors[c] = _worldgen_anywhere(rng, width);
+            }
+
+            for (c = 0; c < num_corridors; c++) {
+                dx = corridors[c * 2 + 1].x - corridors[c * 2].x;
+                dy = corridors[c * 2 + 1].y - corridors[c * 2].y;
+                lengths[c] = sqrt(dx * dx + dy * dy);
+                lengths[c] = lengths[c] > 1.0 ? lengths[c] : 1.0;
+                total += lengths[c];
+            }
+
+            for (i = 0; i < num_industries; i++) {
+                // corridors are picked by length, so every one is as dense
+                t = rng_unit(rng) * total;
+
+                for (c = 0; c < num_corridors - 1 && t >= lengths[c]; c++) {
+                    t -= lengths[c];
+                }
+
+                length = lengths[c];
+                t = t < length ? t / length : 1.0;
+                c *= 2;
+                offset = (rng_unit(rng) - 0.5) * WORLDGEN_CORRIDOR_WIDTH;
+
+                dx = corridors[c + 1].x - corridors[c].x;
+                dy = corridors[c + 1].y - corridors[c].y;
+
+                // along the corridor, then across it
+                points[i].x = corridors[c].x + dx * t - dy / length * offset;
+                points[i].y = corridors[c].y + dy * t + dx / length * offset;
+            }
+
+            free(corridors);
+            free(lengths);
+            break;
+
+        default:
+            for (i = 0; i < num_industries; i++) {
+                points[i] = _worldgen_anywhere(rng, width);
+            }
+    }
+
+    // clusters and corridors may spill over the edges
+    for (i = 0; i < num_industries; i++) {
+        points[i] = _worldgen_clamp(points[i], width);
+    }
+
+    return num_anchors;
+}
+
+/**
+ * @brief Sorts deliveries by tic.
+ */
+static int _worldgen_delivery_compare(const void *a, const void *b) {
+    const unsigned int tic_a = ((const struct worldgen_delivery_t *) a)->tic;
+    const unsigned int tic_b = ((const struct worldgen_delivery_t *) b)->tic;
+
+    return (tic_a > tic_b) - (tic_a < tic_b);
+}
+
+/**
+ * @brief Draws the delivery schedule, once the world is made.
+ */
+static void _worldgen_schedule(const struct worldgen_params_t *params, struct worldgen_world_t *world, const struct _worldgen_point_t *points) {
+    const struct industry_type_t *indtype;
+    struct worldgen_delivery_t *delivery;
+    struct rng_t rng;
+    int *accepting, num_accepting = 0, i, which;
+
+    // only industries that accept any cargo get deliveries
+    accepting = malloc(sizeof(*accepting) * world->num_industries);
+
+    for (i = 0; i < world->num_industries; i++) {
+        if (industry_types[world->types[i]].num_accepts > 0) {
+            accepting[num_accepting++] = i;
+        }
+    }
+
+    world->num_deliveries = num_accepting > 0 && world->num_stations > 0 ? params->num_deliveries : 0;
+
+    rng_seed(&rng, params->seed, RNG_AI);
+
+    for (i = 0; i < world->num_deliveries; i++) {
+        which = accepting[rng_below(&rng, num_accepting)];
+        indtype = &industry_types[world->types[which]];
+
+        delivery = &world->deliveries[i];
+
+        delivery->tic = rng_below(&rng, params->num_tics);
+        delivery->industry = world->industries[which];
+        delivery->accept = rng_below(&rng, indtype->num_accepts);
+        delivery->cargo_type = industry_mats[indtype->first_accept + delivery->accept].cargo;
+        delivery->station = station_find_nearest(points[which].x, points[which].y);
+        delivery->amount = 1.0 + rng_unit(&rng) * (WORLDGEN_MAX_DELIVERY - 1.0);
+    }
+
+    qsort(world->deliveries, world->num_deliveries, sizeof(*world->deliveries), _worldgen_delivery_compare);
+
+    free(accepting);
+}
+
+int worldgen_make(const struct worldgen_params_t *params, struct worldgen_world_t *world) {
+    const int num_industries = params->num_industries;
+    const int num_stations = params->num_stations;
+    struct _worldgen_point_t *points, *anchors;
+    struct _worldgen_point_t station_point;
+    struct rng_t rng;
+    spot_handle_t spot;
+    int num_types, num_anchors, i;
+
+    if (num_industries < 1 || num_industries > MAX_INDUSTRIES || num_stations < 0 || num_stations > MAX_STATIONS || num_industries + num_stations > MAX_SPOTS || params->num_deliveries < 0 || params->num_tics < 1 || params->world_width > WORLDGEN_MAX_WIDTH) {
+        return -1;
+    }
+
+    for (num_types = 0; num_types < MAX_INDUS_TYPES && industry_types[num_types].supply_type != ISUPTYPE_UNKNOWN; num_types++);
+
+    points = malloc(sizeof(*points) * num_industries);
+    anchors = malloc(sizeof(*anchors) * num_industries);
+
+    world->industries = malloc(sizeof(*world->industries) * num_industries);
+    world->types = malloc(sizeof(*world->types) * num_industries);
+    world->stations = malloc(sizeof(*world->stations) * (num_stations + 1));
+    world->deliveries = malloc(sizeof(*world->deliveries) * (params->num_deliveries + 1));
+    world->num_industries = 0;
+    world->num_stations = 0;
+    world->num_deliveries = 0;
+    world->num_unlinked = 0;
+
+    rng_seed(&rng, params->seed, RNG_PLACEMENT);
+    num_anchors = _worldgen_layout(&rng, params, points, anchors);
+
+    // spots first, so the place indices can be built before stations look them up
+    for (i = 0; i < num_industries; i++) {
+        spot = make_spot(points[i].x, points[i].y);
+
+        if (spot_link(spot, 0.0) < 0) {
+            world->num_unlinked++;
+        }
+    }
+
+    for (i = 0; i < num_stations; i++) {
+        // stations gather where industries do
+        station_point = num_anchors > 0 ? anchors[i % num_anchors] : points[rng_below(&rng, num_industries)];
+        station_point.x += _worldgen_offset(&rng, WORLDGEN_STATION_SPREAD * 2);
+        station_point.y += _worldgen_offset(&rng, WORLDGEN_STATION_SPREAD * 2);
+        station_point = _worldgen_clamp(station_point, params->world_width);
+
+        spot = make_spot(station_point.x, station_point.y);
+
+        if (spot_link(spot, 0.0) < 0) {
+            world->num_unlinked++;
+        }
+
+        world->stations[i] = spot;
+    }
+
+    place_grid_fit();
+    place_morton_build();
+    place_kd_build();
+
+    for (i = 0; i < num_industries; i++) {
+        world->types[i] = rng_below(&rng, num_types);
+        world->industries[i] = industry_make(world->types[i], points[i].x, points[i].y);
+
+        if (world->industries[i] == (industry_handle_t) -1) {
+            free(points);
+            free(anchors);
+            return -1;
+        }
+
+        world->num_industries++;
+    }
+
+    for (i = 0; i < num_stations; i++) {
+        world->stations[i] = station_make(world->stations[i]);
+
+        if (world->stations[i] == (station_handle_t) -1) {
+            free(points);
+            free(anchors);
+            return -1;
+        }
+
+        world->num_stations++;
+    }
+
+    _worldgen_schedule(params, world, points);
+
+    free(points);
+    free(anchors);
+
+    return 0;
+}
+
+void worldgen_free(struct worldgen_world_t *world) {
+    free(world->industries);
+    free(world->types);
+    free(world->stations);
+    free(world->deliveries);
+
+    world->industries = NULL;
+    world->types = NULL;
+    world->stations = NULL;
+    world->deliveries = NULL;
+}
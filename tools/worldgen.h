@@ -0,0 +1,237 @@
+/**
+ * @file worldgen.h
+ * @author Gustavo Rehermann (rehermann6046@gmail.com)
+ * @brief Synthetic worlds, for benchmarks at any size.
+ * @version added in 0.1
+ * @date 2021-03-21
+ *
+ * A host-side generator, not part of the mod itself. Builds a whole
+ * world through the i_place, h_industry and h_station APIs: spots laid
+ * out uniformly, in clusters or along corridors, an industry of a
+ * random type on each, stations near the clusters, and a schedule of
+ * cargo deliveries to industries over a number of tics.
+ *
+ * The world only depends on the parameters, seed included; every tool
+ * using the same parameters benchmarks the very same world. Spots have
+ * no removal, so each world should be made in a fresh process, e.g. a
+ * forked child.
+ *
+ * @copyright Copyright (c)Gustavo Ramos Rehermann 2021. The MIT License.
+ */
+
+#ifndef WORLDGEN_H
+#define WORLDGEN_H
+
+#include <stddef.h>
+
+#include "h_industry.h"
+#include "h_station.h"
+#include "i_place.h"
+
+
+/**
+ * @brief The area of the world per industry, in square map units.
+ *
+ * Worlds grow with the number of industries, so that every size has
+ * about the same density, as far as the layout allows, up to
+ * WORLDGEN_MAX_WIDTH; larger worlds are only made denser.
+ */
+#define WORLDGEN_INDUSTRY_AREA 1000000.0
+
+/**
+ * @brief The widest a world gets, in map units.
+ *
+ * Doom maps span 65536 units at most, from -32768 to 32767, and every
+ * spot should be on the place grid, so worlds fit in both.
+ */
+#define WORLDGEN_MAX_WIDTH (PLACE_GRID_WIDTH * SPOT_TILE_WIDTH < 65536 ? PLACE_GRID_WIDTH * SPOT_TILE_WIDTH : 65536)
+
+/**
+ * @brief How many industries there are per station.
+ */
+#define WORLDGEN_INDUSTRIES_PER_STATION 4
+
+/**
+ * @brief How many industries there are per cluster, in clustered worlds.
+ */
+#define WORLDGEN_INDUSTRIES_PER_CLUSTER 48
+
+/**
+ * @brief The width of a cluster, in map units.
+ */
+#define WORLDGEN_CLUSTER_WIDTH 4096.0
+
+/**
+ * @brief The width of a corridor, in map units.
+ */
+#define WORLDGEN_CORRIDOR_WIDTH 512.0
+
+/**
+ * @brief The max distance from a station to its anchor, in map units.
+ */
+#define WORLDGEN_STATION_SPREAD 512.0
+
+/**
+ * @brief The max amount of cargo in a single delivery.
+ */
+#define WORLDGEN_MAX_DELIVERY 20.0
+
+
+/**
+ * @brief How spots are laid out in the world.
+ */
+enum worldgen_layout_t {
+    /**
+     * @brief Spread evenly over the whole world.
+     */
+    WORLDGEN_UNIFORM,
+
+    /**
+     * @brief Mostly gathered around a few clusters, like rooms in a map.
+     */
+    WORLDGEN_CLUSTERED,
+
+    /**
+     * @brief Strung along a few long, narrow corridors, like hallways.
+     */
+    WORLDGEN_CORRIDOR,
+
+    NUM_WORLDGEN_LAYOUTS
+};
+
+/**
+ * @brief The name of each layout.
+ */
+extern const char *const worldgen_layout_names[NUM_WORLDGEN_LAYOUTS];
+
+/**
+ * @brief The parameters of a world.
+ *
+ * @see worldgen_default_params
+ */
+struct worldgen_params_t {
+    enum worldgen_layout_t layout;
+
+    /**
+     * @brief The seed every random choice is drawn from.
+     */
+    unsigned int seed;
+
+    int num_industries;
+    int num_stations;
+
+    /**
+     * @brief The length of the delivery schedule.
+     */
+    int num_deliveries;
+
+    /**
+     * @brief The number of tics the delivery schedule spans.
+     */
+    unsigned int num_tics;
+
+    /**
+     * @brief The width of the square world, centered on the origin, in map units.
+     *
+     * Up to WORLDGEN_MAX_WIDTH; every spot is kept within it.
+     */
+    float world_width;
+};
+
+/**
+ * @brief A delivery of cargo to an industry, through a station.
+ *
+ * The cargo is unloaded at the station, then handed to the industry.
+ */
+struct worldgen_delivery_t {
+    unsigned int tic;
+    industry_handle_t industry;
+
+    /**
+     * @brief The index of the cargo among the accepted cargo types of the industry.
+     */
+    size_t accept;
+
+    /**
+     * @brief The type of the cargo; the accepted one at that index.
+     */
+    cargo_handle_t cargo_type;
+
+    /**
+     * @brief The station nearest the industry.
+     */
+    station_handle_t station;
+
+    float amount;
+};
+
+/**
+ * @brief A world made by worldgen_make.
+ */
+struct worldgen_world_t {
+    /**
+     * @brief The industry on each spot, in the order they were made.
+     *
+     * The spots of the industries come first, then the stations'.
+     */
+    industry_handle_t *industries;
+
+    /**
+     * @brief The industry_types index of each industry.
+     */
+    size_t *types;
+
+    station_handle_t *stations;
+
+    /**
+     * @brief The delivery schedule, ordered by tic.
+     */
+    struct worldgen_delivery_t *deliveries;
+
+    int num_industries;
+    int num_stations;
+    int num_deliveries;
+
+    /**
+     * @brief The number of spots that could not be linked into the spotmap.
+     *
+     * The spotmap only holds a few spots per tile; dense worlds
+     * overflow it, and radius queries through it then miss spots.
+     */
+    int num_unlinked;
+};
+
+/**
+ * @brief Fills in the default parameters for a world of a given size.
+ *
+ * @param params The parameters to fill in.
+ * @param layout How spots are laid out.
+ * @param num_industries The number of industries; the number of
+ * stations, the schedule and the size of the world follow from it.
+ * @param seed The seed of the world.
+ */
+void worldgen_default_params(struct worldgen_params_t *params, enum worldgen_layout_t layout, int num_industries, unsigned int seed);
+
+/**
+ * @brief Makes a world, in the current, empty one.
+ *
+ * The place grid, the Morton-ordered spot array and the spot KD-tree
+ * are all built once every spot is made.
+ *
+ * @param params The parameters of the world.
+ * @param world The world made.
+ * @return int 0 on success, or -1 if the world does not fit in the
+ * capacities of the simulation modules, or is wider than
+ * WORLDGEN_MAX_WIDTH.
+ */
+int worldgen_make(const struct worldgen_params_t *params, struct worldgen_world_t *world);
+
+/**
+ * @brief Frees the lists of a world made by worldgen_make.
+ *
+ * The world itself stays in the simulation modules.
+ */
+void worldgen_free(struct worldgen_world_t *world);
+
+
+#endif // WORLDGEN_H